@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "decode_arena.h"
+
+#define TAG "DECODE_ARENA"
+
+#define ARENA_ALIGN	8
+
+static struct {
+	uint8_t *base;			// NULL while no decoder holds a block
+	size_t size;			// 0 until decode_arena_init()
+	size_t top;				// first free byte
+	size_t last;			// start of the most recent block
+	int blocks;				// blocks handed out and not yet freed
+	SemaphoreHandle_t lock;
+} arena;
+
+esp_err_t decode_arena_init(size_t size)
+{
+	if (arena.size) return ESP_ERR_INVALID_STATE;
+	arena.lock = xSemaphoreCreateMutex();
+	if (!arena.lock) return ESP_ERR_NO_MEM;
+	arena.size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	ESP_LOGI(TAG, "%u bytes, taken per decode", (unsigned)arena.size);
+	return ESP_OK;
+}
+
+bool decode_arena_owns(const void *ptr)
+{
+	return arena.base && (const uint8_t *)ptr >= arena.base && (const uint8_t *)ptr < arena.base + arena.size;
+}
+
+void *decode_arena_alloc(size_t size, const char *name)
+{
+	void *ptr = NULL;
+	const char *why = "not initialised";
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+	if (arena.size) {
+		xSemaphoreTake(arena.lock, portMAX_DELAY);
+		if (!arena.base) {
+			// the decoders only touch it from the CPU, so it does not need DMA-capable
+			// memory, but it must stay in internal RAM for speed
+			arena.base = heap_caps_malloc(arena.size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+		}
+		if (arena.base && size <= arena.size - arena.top) {
+			ptr = arena.base + arena.top;
+			arena.last = arena.top;
+			arena.top += size;
+			arena.blocks++;
+		} else if (!arena.base) {
+			why = "cannot be allocated";
+		} else {
+			why = "full";
+			if (arena.blocks == 0) {
+				heap_caps_free(arena.base);	// too large for an idle arena: do not keep it taken
+				arena.base = NULL;
+			}
+		}
+		xSemaphoreGive(arena.lock);
+	}
+	if (ptr) {
+		ESP_LOGD(TAG, "%s: %u bytes from arena", name, (unsigned)size);
+		return ptr;
+	}
+
+	ESP_LOGW(TAG, "%s: %u bytes from heap (arena %s)", name, (unsigned)size, why);
+	return malloc(size);
+}
+
+void *decode_arena_calloc(size_t size, const char *name)
+{
+	void *ptr = decode_arena_alloc(size, name);
+	if (ptr) memset(ptr, 0, size);
+	return ptr;
+}
+
+void decode_arena_free(void *ptr)
+{
+	if (!ptr) return;
+	if (!decode_arena_owns(ptr)) {
+		free(ptr);
+		return;
+	}
+
+	xSemaphoreTake(arena.lock, portMAX_DELAY);
+	size_t offset = (uint8_t *)ptr - arena.base;
+	if (--arena.blocks == 0) {
+		// idle: hand the whole block back to the heap until the next decode
+		heap_caps_free(arena.base);
+		arena.base = NULL;
+		arena.top = arena.last = 0;
+	} else if (offset == arena.last) {
+		arena.top = offset;		// most recent block: give the space back now
+	}
+	xSemaphoreGive(arena.lock);
+}
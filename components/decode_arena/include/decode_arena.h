@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * Decoder arena.
+ *
+ * One block of internal RAM shared by the image decoders (tjpgd work
+ * buffers, the pngle inflate state) instead of a static buffer per decoder
+ * plus a separate heap allocation for each of their structures.
+ *
+ * The block is taken from the heap by the first decode_arena_alloc() and
+ * given back when its last block is freed, so no RAM is held between
+ * decodes. Whatever else is allocated in between can fragment the heap;
+ * if the whole block cannot be had at the next decode, the borrowers get
+ * plain heap allocations instead.
+ *
+ * Allocation is a bump pointer: blocks are carved from the top. Freeing the
+ * most recent block returns its space immediately. A freed block below the
+ * top is only reclaimed once every block has been freed. When the arena is
+ * not initialised or has no room (another decoder holds it),
+ * decode_arena_alloc() falls back to the heap, and decode_arena_free()
+ * accepts both kinds of pointers.
+ */
+
+/**
+ * @brief Set the arena size. Call once, before the first decode.
+ *
+ * @param size Size of the largest decoder workspace that has to fit
+ * @return - ESP_OK on success
+ *         - ESP_ERR_INVALID_STATE if already initialised
+ *         - ESP_ERR_NO_MEM if the lock cannot be created
+ */
+esp_err_t decode_arena_init(size_t size);
+
+/**
+ * @brief Borrow size bytes (8-byte aligned), from the arena when it has room, otherwise from the heap.
+ *
+ * @param name Borrower, for the log
+ * @return NULL only if the heap fallback fails too
+ */
+void *decode_arena_alloc(size_t size, const char *name);
+
+/**
+ * @brief Same as decode_arena_alloc() but zero-filled.
+ */
+void *decode_arena_calloc(size_t size, const char *name);
+
+/**
+ * @brief Return a block from decode_arena_alloc(). NULL is ignored.
+ */
+void decode_arena_free(void *ptr);
+
+/**
+ * @brief Whether ptr lies inside the arena.
+ */
+bool decode_arena_owns(const void *ptr);
@@ -1,8 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "decode_jpeg.h"
+#include "decode_arena.h"
 #include "esp_rom_caps.h"
 #include "esp_log.h"
 
@@ -22,9 +26,8 @@
 
 #define TAG __FUNCTION__
 
-// 작업 버퍼 크기: 필요에 따라 조정 가능 (예: 8192, 16384 등)
-#define JD_WORKSZ 50000
-static uint8_t jd_workbuf[JD_WORKSZ];
+// 작업 버퍼는 디코딩할 때만 디코더 아레나에서 빌림
+#define JD_WORKSZ DECODE_JPEG_WORKSZ
 
 // 디코더에 전달할 컨텍스트 구조체
 typedef struct {
@@ -35,9 +38,9 @@ typedef struct {
 } JpegDev;
 
 // 입력 콜백: 파일에서 len 바이트 읽거나 건너뛰기
-static unsigned int infunc(JDEC *decoder, uint8_t *buf, unsigned int len) {
+static size_t infunc(JDEC *decoder, uint8_t *buf, size_t len) {
     JpegDev *jd = (JpegDev *)decoder->device;
-    ESP_LOGD(TAG, "infunc len=%u fp=%p", len, jd->fp);
+    ESP_LOGD(TAG, "infunc len=%u fp=%p", (unsigned)len, jd->fp);
     if (buf) {
         return fread(buf, 1, len, jd->fp);
     } else {
@@ -75,7 +78,7 @@ static uint8_t getScale(int sw, int sh, uint16_t dw, uint16_t dh) {
 }
 
 esp_err_t decode_jpeg(pixel_jpeg ***pixels, char *file, int screenWidth, int screenHeight, int *imageWidth, int *imageHeight) {
-    char *work = (char*)jd_workbuf;
+    char *work = NULL;
     uint32_t work_size = JD_WORKSZ;
     JDEC decoder;
     JpegDev jd = { 0 };
@@ -110,6 +113,11 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char *file, int screenWidth, int scr
     }
 
     // 3) 디코더 준비
+    work = decode_arena_alloc(work_size, "tjpgd");
+    if (!work) {
+        ret = ESP_ERR_NO_MEM;
+        goto err;
+    }
     JRESULT res = jd_prepare(&decoder, infunc, work, work_size, &jd);
     if (res != JDR_OK) {
         ESP_LOGE(TAG, "jd_prepare failed (%d)", res);
@@ -132,9 +140,11 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char *file, int screenWidth, int scr
     }
 
     fclose(jd.fp);
+    decode_arena_free(work);
     return ESP_OK;
 
 err:
+    decode_arena_free(work);
     if (jd.fp) fclose(jd.fp);
     if (*pixels) {
         for (int i = 0; i < screenHeight; i++) {
@@ -154,3 +164,701 @@ esp_err_t release_image(pixel_jpeg ***pixels, int screenWidth, int screenHeight)
     }
     return ESP_OK;
 }
+
+// --------------------------------------------------
+// 스트리밍 디코딩: 프레임 버퍼 없이 MCU 한 줄(밴드)씩 콜백으로 전달
+// --------------------------------------------------
+#define MCU_MAX_HEIGHT 16
+
+typedef struct JpegSplice JpegSplice;
+
+// 병렬 디코딩에서 두 작업자가 공유하는 상태
+typedef struct {
+    SemaphoreHandle_t io;       // 같은 FILE을 번갈아 읽음
+    SemaphoreHandle_t turn[2];  // 밴드 전달 차례
+    SemaphoreHandle_t done;     // 두 번째 작업자 종료
+    volatile bool abort;        // 한쪽이 실패하거나 band_cb가 중단 요청
+} JpegParallel;
+
+typedef struct {
+    jpeg_stream_t *js;
+    size_t remain;          // 남은 입력 바이트 (length 제한)
+    JpegSplice *splice;     // 재시작 구간을 이어 붙인 가상 스트림, NULL = 파일 그대로
+    JpegParallel *par;      // 병렬 디코딩 중이면 공유 상태, NULL = 단독
+    void *work;             // tjpgd 작업 버퍼 (아레나에서 빌림)
+    int worker;             // 병렬 디코딩의 작업자 번호 (0, 1)
+    int planFirst;          // 병렬: 가상 이미지의 줄 묶음(planH 행)을 실제 위치로 옮기는 값
+    int planH;              //   planH 행마다 planStep 행씩 건너뜀, 0 = 그대로
+    int planStep;
+    int vHeight;            //   가상 이미지 높이 (스케일 적용 후)
+    bool holding;           //   밴드 전달 차례를 가지고 있음
+    bool bandRowEnd;        //   모으는 밴드가 줄 묶음의 마지막 밴드
+    pixel_jpeg *band;       // bandWidth x MCU_MAX_HEIGHT
+    int clipX, clipY;       // 디코딩되는 이미지 안에서 출력 영역의 위치 (스케일 적용 후)
+    int limit;              // 출력할 행 수 = min(imageHeight, screenHeight)
+    bool pending;           // band에 모으고 있는 밴드가 있음
+    int bandTop;            // 모으고 있는 밴드의 시작 행 (출력 영역 기준, 음수 = 위쪽이 잘림)
+    int bandHeight;
+    bool stop;              // 화면 아래에 도달했거나 band_cb가 중단 요청
+} JpegStream;
+
+static size_t stream_infunc(JDEC *decoder, uint8_t *buf, size_t len) {
+    JpegStream *st = (JpegStream *)decoder->device;
+    if (len > st->remain) len = st->remain;
+    if (st->js->read) {
+        len = st->js->read(st->js->read_arg, buf, len);
+    } else if (buf) {
+        len = fread(buf, 1, len, st->js->fp);
+    } else {
+        fseek(st->js->fp, len, SEEK_CUR);
+    }
+    st->remain -= len;
+    return len;
+}
+
+static void parallel_pass_turn(JpegStream *st);
+
+static bool stream_flush(JpegStream *st) {
+    if (!st->pending) return true;
+    jpeg_stream_t *js = st->js;
+    int skip = st->bandTop < 0 ? -st->bandTop : 0;
+    int height = st->bandHeight - skip;
+    if (st->bandTop + st->bandHeight > st->limit) height = st->limit - st->bandTop - skip;
+    st->pending = false;
+    if (height <= 0) return true;
+
+    // 병렬: 밴드는 위에서부터 순서대로 한 작업자씩 전달
+    if (st->par && !st->holding) {
+        xSemaphoreTake(st->par->turn[st->worker], portMAX_DELAY);
+        st->holding = true;
+    }
+    if (st->par && st->par->abort) {
+        st->stop = true;
+        return false;
+    }
+    bool cont = js->band_cb(js, st->bandTop + skip, height, st->band + skip * js->bandWidth);
+    if (!cont) {
+        st->stop = true;
+        if (st->par) st->par->abort = true;
+    }
+    if (st->par && st->bandRowEnd) parallel_pass_turn(st);
+    return cont;
+}
+
+static jpeg_decode_out_t stream_outfunc(JDEC *decoder, void *bitmap, JRECT *rect) {
+    JpegStream *st = (JpegStream *)decoder->device;
+    jpeg_stream_t *js = st->js;
+    int shift = st->planH ? st->planFirst + (rect->top / st->planH) * (st->planStep - st->planH) : 0;
+    int top = rect->top + shift - st->clipY;
+    int left = rect->left - st->clipX;
+    int width = rect->right - rect->left + 1;
+
+    if (st->par && st->par->abort) {
+        st->stop = true;    // 다른 작업자가 실패하거나 중단됨
+        return 0;
+    }
+    // 출력 영역 위쪽이나 좌우 바깥의 MCU는 버림
+    if (rect->bottom + shift < st->clipY || left + width <= 0 || left >= js->bandWidth) return 1;
+
+    // 새 MCU 줄이 시작되면 이전 밴드를 내보냄
+    if (!st->pending || st->bandTop != top) {
+        if (!stream_flush(st)) return 0;
+        if (top >= st->limit) {
+            st->stop = true;  // 화면 아래는 디코딩할 필요 없음
+            return 0;
+        }
+        st->pending = true;
+        st->bandTop = top;
+        st->bandHeight = rect->bottom - rect->top + 1;
+        st->bandRowEnd = st->planH &&
+                         ((rect->bottom + 1) % st->planH == 0 || rect->bottom + 1 >= st->vHeight);
+    }
+
+    uint8_t *in = (uint8_t *)bitmap;
+    int x0 = left < 0 ? -left : 0;
+    int x1 = js->bandWidth - left < width ? js->bandWidth - left : width;
+    for (int y = 0; y < st->bandHeight; y++) {
+        pixel_jpeg *dst = st->band + y * js->bandWidth + left;
+        for (int x = x0; x < x1; x++) {
+            dst[x] = rgb565(in[x * 3], in[x * 3 + 1], in[x * 3 + 2]);
+        }
+        in += width * 3;
+    }
+
+    // 출력 영역 오른쪽 끝 MCU면 다음 줄을 기다리지 않고 바로 내보냄
+    if (left + width >= js->bandWidth) {
+        if (!stream_flush(st)) return 0;
+    }
+    return 1;
+}
+
+// 헤더만 읽고 스케일·출력 크기 계산 (decoder는 jd_decomp 직전 상태)
+static esp_err_t stream_prepare(JDEC *decoder, JpegStream *st, jpeg_stream_t *js) {
+    if (!js->fp && !js->read) return ESP_ERR_INVALID_ARG;
+    if (!js->read && fseek(js->fp, js->offset, SEEK_SET) != 0) return ESP_ERR_NOT_FOUND;
+    st->js = js;
+    st->remain = js->length ? js->length : SIZE_MAX;
+    st->work = decode_arena_alloc(JD_WORKSZ, "tjpgd");
+    if (!st->work) return ESP_ERR_NO_MEM;
+
+    JRESULT res = jd_prepare(decoder, stream_infunc, st->work, JD_WORKSZ, st);
+    if (res != JDR_OK) {
+        ESP_LOGE(TAG, "jd_prepare failed (%d)", res);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    js->sourceWidth = decoder->width;
+    js->sourceHeight = decoder->height;
+    if (js->scale < 0 || js->scale > 3) {
+        js->scale = getScale(js->screenWidth, js->screenHeight, decoder->width, decoder->height);
+    }
+    js->imageWidth = decoder->width >> js->scale;
+    js->imageHeight = decoder->height >> js->scale;
+    js->bandWidth = js->imageWidth < js->screenWidth ? js->imageWidth : js->screenWidth;
+    return ESP_OK;
+}
+
+// jd_prepare 이후: 밴드 버퍼를 잡고 끝까지(또는 출력 영역 아래까지) 디코딩
+static esp_err_t stream_run(JDEC *decoder, JpegStream *st) {
+    jpeg_stream_t *js = st->js;
+    st->limit = js->imageHeight < js->screenHeight ? js->imageHeight : js->screenHeight;
+    st->band = malloc(js->bandWidth * MCU_MAX_HEIGHT * sizeof(pixel_jpeg));
+    if (!st->band) {
+        ESP_LOGE(TAG, "Memory alloc for band failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    JRESULT res = jd_decomp(decoder, stream_outfunc, js->scale);
+    if (res == JDR_OK) stream_flush(st);
+    free(st->band);
+
+    if (res != JDR_OK && !(res == JDR_INTR && st->stop)) {
+        ESP_LOGE(TAG, "jd_decomp failed (%d)", res);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t decode_jpeg_info(jpeg_stream_t *js) {
+    JDEC decoder;
+    JpegStream st = { 0 };
+    esp_err_t ret = stream_prepare(&decoder, &st, js);
+    decode_arena_free(st.work);
+    return ret;
+}
+
+esp_err_t decode_jpeg_stream(jpeg_stream_t *js) {
+    JDEC decoder;
+    JpegStream st = { 0 };
+
+    if (!js->band_cb) return ESP_ERR_INVALID_ARG;
+    esp_err_t ret = stream_prepare(&decoder, &st, js);
+    if (ret == ESP_OK) ret = stream_run(&decoder, &st);
+    decode_arena_free(st.work);
+    return ret;
+}
+
+// --------------------------------------------------
+// 뷰포트 디코딩: 재시작 마커(RSTn) 색인으로 보이는 영역의 구간만 골라
+// SOF 크기를 고친 헤더 뒤에 이어 붙인 가상 JPEG를 디코더에 공급.
+// 건너뛴 MCU는 허프만 복호·IDCT·색 변환 모두 하지 않음
+// --------------------------------------------------
+struct JpegSplice {
+    const jpeg_rst_index_t *index;
+    int first;              // 첫 구간 번호
+    int stride;             // 다음 MCU 줄의 첫 구간까지 거리
+    int cols;               // 줄마다 이어 붙일 구간 수
+    int total;              // 이어 붙일 구간 수
+    int piece;              // 공급 중인 구간 (-1 = 헤더)
+    long pos, end;          // 공급 중인 파일 범위
+    bool seek;              // 파일 위치를 pos로 옮겨야 함
+    uint8_t marker[2];      // 구간 뒤에 넣을 RSTn 또는 EOI
+    int markerLeft;
+    uint8_t sof[4];         // 가상 이미지의 높이·너비 (big endian)
+};
+
+static void splice_next(JpegSplice *sp, FILE *fp) {
+    const jpeg_rst_index_t *idx = sp->index;
+    int n = ++sp->piece;
+    int i = sp->first + (n / sp->cols) * sp->stride + n % sp->cols;
+    sp->pos = idx->starts[i];
+    sp->end = i + 1 < idx->count ? (long)idx->starts[i + 1] - 2 : idx->dataEnd;
+    // 구간 번호가 바뀌므로 RSTn은 이어 붙인 순서대로 다시 매김
+    sp->marker[0] = 0xFF;
+    sp->marker[1] = n + 1 < sp->total ? 0xD0 + (n & 7) : 0xD9;
+    sp->markerLeft = 2;
+    sp->seek = true;
+}
+
+static size_t splice_infunc(JDEC *decoder, uint8_t *buf, size_t len) {
+    JpegStream *st = (JpegStream *)decoder->device;
+    JpegSplice *sp = st->splice;
+    FILE *fp = st->js->fp;
+    size_t done = 0;
+
+    while (done < len) {
+        if (sp->pos < sp->end) {
+            size_t n = len - done;
+            if (n > (size_t)(sp->end - sp->pos)) n = sp->end - sp->pos;
+            if (buf) {
+                // 병렬 디코딩에서는 두 작업자가 같은 FILE을 번갈아 읽음
+                if (st->par) xSemaphoreTake(st->par->io, portMAX_DELAY);
+                if (st->par || sp->seek) fseek(fp, sp->pos, SEEK_SET);
+                n = fread(buf + done, 1, n, fp);
+                if (st->par) xSemaphoreGive(st->par->io);
+                sp->seek = false;
+                if (n == 0) break;
+                // SOF의 높이·너비를 가상 이미지 크기로 바꿔치기
+                long sof = sp->index->sofPos;
+                for (long p = sof > sp->pos ? sof : sp->pos; p < sof + 4 && p < sp->pos + (long)n; p++) {
+                    buf[done + p - sp->pos] = sp->sof[p - sof];
+                }
+            } else {
+                sp->seek = true;
+            }
+            sp->pos += n;
+            done += n;
+        } else if (sp->markerLeft > 0) {
+            if (buf) buf[done] = sp->marker[2 - sp->markerLeft];
+            sp->markerLeft--;
+            done++;
+        } else if (sp->piece + 1 < sp->total) {
+            splice_next(sp, fp);
+        } else {
+            break;
+        }
+    }
+    return done;
+}
+
+esp_err_t decode_jpeg_index(FILE *fp, long offset, jpeg_rst_index_t *index) {
+    uint8_t buf[512];
+    memset(index, 0, sizeof(*index));
+    index->offset = offset;
+
+    if (fseek(fp, offset, SEEK_SET) != 0 || fread(buf, 1, 2, fp) != 2 ||
+        buf[0] != 0xFF || buf[1] != 0xD8) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // 헤더: SOF0(크기·MCU 크기), DRI(재시작 간격), SOS(엔트로피 데이터 시작)
+    while (index->dataPos == 0) {
+        if (fread(buf, 1, 4, fp) != 4 || buf[0] != 0xFF) return ESP_ERR_NOT_SUPPORTED;
+        uint8_t marker = buf[1];
+        uint16_t seglen = (buf[2] << 8) | buf[3];
+        long seg = ftell(fp);
+        if (seglen < 2) return ESP_ERR_NOT_SUPPORTED;
+
+        if (marker == 0xC0) {
+            if (seglen < 8 || fread(buf, 1, 6, fp) != 6) return ESP_ERR_NOT_SUPPORTED;
+            index->sofPos = seg + 1;
+            index->height = (buf[1] << 8) | buf[2];
+            index->width = (buf[3] << 8) | buf[4];
+            int hmax = 1, vmax = 1;
+            for (int c = 0; c < buf[5]; c++) {
+                uint8_t comp[3];
+                if (fread(comp, 1, 3, fp) != 3) return ESP_ERR_NOT_SUPPORTED;
+                if ((comp[1] >> 4) > hmax) hmax = comp[1] >> 4;
+                if ((comp[1] & 15) > vmax) vmax = comp[1] & 15;
+            }
+            index->mcuWidth = hmax * 8;
+            index->mcuHeight = vmax * 8;
+        } else if ((marker & 0xF0) == 0xC0 && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            return ESP_ERR_NOT_SUPPORTED;   // 프로그레시브 등 baseline 이외
+        } else if (marker == 0xDD) {
+            if (seglen < 4 || fread(buf, 1, 2, fp) != 2) return ESP_ERR_NOT_SUPPORTED;
+            index->interval = (buf[0] << 8) | buf[1];
+        } else if (marker == 0xDA) {
+            index->dataPos = seg + seglen - 2;
+        } else if (marker == 0xD9) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (fseek(fp, seg + seglen - 2, SEEK_SET) != 0) return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (index->width == 0 || index->height == 0) return ESP_ERR_NOT_SUPPORTED;
+    if (index->interval == 0) return ESP_OK;
+
+    // 엔트로피 데이터를 훑으며 RSTn 다음 위치를 기록 (디코딩 없이 바이트 검색만)
+    int mcus = ((index->width + index->mcuWidth - 1) / index->mcuWidth) *
+               ((index->height + index->mcuHeight - 1) / index->mcuHeight);
+    int want = (mcus + index->interval - 1) / index->interval;
+    index->starts = malloc(want * sizeof(uint32_t));
+    if (!index->starts) {
+        ESP_LOGW(TAG, "no memory for %d restart intervals", want);
+        index->interval = 0;
+        return ESP_ERR_NO_MEM;
+    }
+    index->starts[0] = index->dataPos;
+    index->count = 1;
+
+    long pos = index->dataPos;
+    bool ff = false;
+    size_t n;
+    while (index->dataEnd == 0 && (n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < n; i++, pos++) {
+            if (ff && buf[i] >= 0xD0 && buf[i] <= 0xD7) {
+                if (index->count < want) index->starts[index->count++] = pos + 1;
+            } else if (ff && buf[i] == 0xD9) {
+                index->dataEnd = pos - 1;
+                break;
+            }
+            ff = (buf[i] == 0xFF);
+        }
+    }
+    if (index->dataEnd == 0) index->dataEnd = pos;
+    if (index->count != want) {
+        ESP_LOGW(TAG, "found %d of %d restart intervals", index->count, want);
+        decode_jpeg_index_free(index);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ESP_LOGI(TAG, "%dx%d, %d restart intervals of %d MCUs", index->width, index->height,
+             index->count, index->interval);
+    return ESP_OK;
+}
+
+void decode_jpeg_index_free(jpeg_rst_index_t *index) {
+    free(index->starts);
+    index->starts = NULL;
+    index->count = 0;
+    index->interval = 0;
+}
+
+// 뷰포트를 덮는 구간 선택. 구간이 MCU 줄 단위(가로 전체)거나 한 줄을 나누어 떨어지게
+// 자를 때만 가능, 아니면 false
+static bool splice_plan(JpegSplice *sp, const jpeg_rst_index_t *idx,
+                        int srcX, int srcY, int srcW, int srcH, int *vx, int *vy) {
+    if (!idx || idx->interval == 0 || !idx->starts) return false;
+    int ri = idx->interval;
+    int mcusX = (idx->width + idx->mcuWidth - 1) / idx->mcuWidth;
+    int mx0 = srcX / idx->mcuWidth, mx1 = (srcX + srcW + idx->mcuWidth - 1) / idx->mcuWidth;
+    int my0 = srcY / idx->mcuHeight, my1 = (srcY + srcH + idx->mcuHeight - 1) / idx->mcuHeight;
+    int vw, vh;
+
+    if (ri % mcusX == 0) {
+        // 구간 하나 = MCU k줄: 세로 방향만 건너뜀
+        int k = ri / mcusX;
+        int i0 = my0 / k, i1 = (my1 + k - 1) / k;
+        if (i1 > idx->count) i1 = idx->count;
+        sp->first = i0;
+        sp->stride = 1;
+        sp->cols = 1;
+        sp->total = i1 - i0;
+        *vx = 0;
+        *vy = i0 * k * idx->mcuHeight;
+        vw = idx->width;
+        vh = i1 * k * idx->mcuHeight;
+    } else if (mcusX % ri == 0) {
+        // 한 줄이 여러 구간: 가로·세로 모두 건너뜀
+        int c0 = mx0 / ri, c1 = (mx1 + ri - 1) / ri;
+        sp->first = my0 * (mcusX / ri) + c0;
+        sp->stride = mcusX / ri;
+        sp->cols = c1 - c0;
+        sp->total = (my1 - my0) * sp->cols;
+        *vx = c0 * ri * idx->mcuWidth;
+        *vy = my0 * idx->mcuHeight;
+        vw = c1 * ri * idx->mcuWidth;
+        vh = my1 * idx->mcuHeight;
+    } else {
+        return false;
+    }
+    if (vw > idx->width) vw = idx->width;
+    if (vh > idx->height) vh = idx->height;
+    vw -= *vx;
+    vh -= *vy;
+    if (sp->total <= 0 || vw <= 0 || vh <= 0) return false;
+
+    sp->index = idx;
+    sp->piece = -1;
+    sp->pos = idx->offset;
+    sp->end = idx->dataPos;
+    sp->seek = true;
+    sp->markerLeft = 0;
+    sp->sof[0] = vh >> 8;
+    sp->sof[1] = vh;
+    sp->sof[2] = vw >> 8;
+    sp->sof[3] = vw;
+    return true;
+}
+
+static esp_err_t viewport_run(JpegStream *st, const jpeg_rst_index_t *index,
+                              int srcX, int srcY, int srcW, int srcH) {
+    jpeg_stream_t *js = st->js;
+    JDEC decoder;
+    JpegSplice sp = { 0 };
+    int vx = 0, vy = 0;
+
+    if (splice_plan(&sp, index, srcX, srcY, srcW, srcH, &vx, &vy)) {
+        st->splice = &sp;
+        JRESULT res = jd_prepare(&decoder, splice_infunc, st->work, JD_WORKSZ, st);
+        if (res != JDR_OK) {
+            ESP_LOGE(TAG, "jd_prepare failed (%d)", res);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        js->sourceWidth = index->width;
+        js->sourceHeight = index->height;
+        ESP_LOGD(TAG, "splice %d intervals, %dx%d at %d,%d", sp.total, decoder.width, decoder.height, vx, vy);
+    } else {
+        // 색인이 없으면 전체를 디코딩하며 잘라냄 (뷰포트 아래는 디코딩하지 않음)
+        if (fseek(js->fp, js->offset, SEEK_SET) != 0) return ESP_ERR_NOT_FOUND;
+        st->remain = js->length ? js->length : SIZE_MAX;
+        JRESULT res = jd_prepare(&decoder, stream_infunc, st->work, JD_WORKSZ, st);
+        if (res != JDR_OK) {
+            ESP_LOGE(TAG, "jd_prepare failed (%d)", res);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        js->sourceWidth = decoder.width;
+        js->sourceHeight = decoder.height;
+    }
+
+    if (srcX + srcW > js->sourceWidth) srcW = js->sourceWidth - srcX;
+    if (srcY + srcH > js->sourceHeight) srcH = js->sourceHeight - srcY;
+    if (srcW <= 0 || srcH <= 0) return ESP_ERR_INVALID_ARG;
+    if (js->scale < 0 || js->scale > 3) {
+        js->scale = getScale(js->screenWidth, js->screenHeight, srcW, srcH);
+    }
+    st->clipX = (srcX - vx) >> js->scale;
+    st->clipY = (srcY - vy) >> js->scale;
+    js->imageWidth = srcW >> js->scale;
+    js->imageHeight = srcH >> js->scale;
+    js->bandWidth = js->imageWidth < js->screenWidth ? js->imageWidth : js->screenWidth;
+    if (js->bandWidth <= 0 || js->imageHeight <= 0) return ESP_ERR_INVALID_ARG;
+    return stream_run(&decoder, st);
+}
+
+esp_err_t decode_jpeg_viewport(jpeg_stream_t *js, const jpeg_rst_index_t *index,
+                               int srcX, int srcY, int srcW, int srcH) {
+    JpegStream st = { 0 };
+
+    if (!js->fp || !js->band_cb || srcX < 0 || srcY < 0 || srcW <= 0 || srcH <= 0) return ESP_ERR_INVALID_ARG;
+    st.js = js;
+    st.work = decode_arena_alloc(JD_WORKSZ, "tjpgd");
+    if (!st.work) return ESP_ERR_NO_MEM;
+    esp_err_t ret = viewport_run(&st, index, srcX, srcY, srcW, srcH);
+    decode_arena_free(st.work);
+    return ret;
+}
+
+// --------------------------------------------------
+// 병렬 디코딩: 재시작 구간 단위로 MCU 줄 묶음을 두 작업자가 번갈아 맡음.
+// 작업자마다 자기 줄 묶음만 이어 붙인 가상 스트림과 JDEC·작업 버퍼를 따로 가지며,
+// 디코딩은 동시에 하고 밴드 전달만 위에서부터 순서대로 차례를 넘김
+// --------------------------------------------------
+#define JD_PAR_WORKSZ 16384     // 작업자별 tjpgd 작업 버퍼
+#define JD_PAR_STACK  8192      // band_cb(LCD 전송, 캐시 기록)도 이 스택에서 실행
+
+typedef struct {
+    JDEC decoder;
+    JpegStream st;
+    JpegSplice sp;
+    uint8_t *work;
+    esp_err_t ret;
+} JpegWorker;
+
+static void parallel_pass_turn(JpegStream *st) {
+    st->holding = false;
+    xSemaphoreGive(st->par->turn[1 - st->worker]);
+}
+
+// worker번 작업자가 맡을 구간(줄 묶음 worker, worker + 2, ...)으로 가상 스트림 구성
+static bool parallel_plan(JpegWorker *w, const jpeg_rst_index_t *idx, int worker, int scale) {
+    int ri = idx->interval;
+    int mcusX = (idx->width + idx->mcuWidth - 1) / idx->mcuWidth;
+    int mcusY = (idx->height + idx->mcuHeight - 1) / idx->mcuHeight;
+    int rowsPer, per;   // 줄 묶음 하나의 MCU 줄 수와 구간 수
+
+    if (ri % mcusX == 0) {
+        rowsPer = ri / mcusX;
+        per = 1;
+    } else if (mcusX % ri == 0) {
+        rowsPer = 1;
+        per = mcusX / ri;
+    } else {
+        return false;
+    }
+    int n = ((mcusY + rowsPer - 1) / rowsPer - worker + 1) / 2;
+    if (n <= 0) return false;
+
+    JpegSplice *sp = &w->sp;
+    sp->index = idx;
+    sp->first = worker * per;
+    sp->stride = 2 * per;
+    sp->cols = per;
+    sp->total = n * per;
+    sp->piece = -1;
+    sp->pos = idx->offset;
+    sp->end = idx->dataPos;
+    sp->seek = true;
+
+    int planPx = rowsPer * idx->mcuHeight;
+    int lastTop = (worker + 2 * (n - 1)) * planPx;
+    int vh = (n - 1) * planPx + (idx->height - lastTop < planPx ? idx->height - lastTop : planPx);
+    sp->sof[0] = vh >> 8;
+    sp->sof[1] = vh;
+    sp->sof[2] = idx->width >> 8;
+    sp->sof[3] = idx->width;
+
+    w->st.splice = sp;
+    w->st.worker = worker;
+    w->st.planFirst = (worker * planPx) >> scale;
+    w->st.planH = planPx >> scale;
+    w->st.planStep = (2 * planPx) >> scale;
+    w->st.vHeight = vh >> scale;
+    return w->st.planH > 0;
+}
+
+static void parallel_run(JpegWorker *w) {
+    w->ret = stream_run(&w->decoder, &w->st);
+    if (w->ret != ESP_OK) w->st.par->abort = true;
+    // 남은 밴드가 없으므로 상대가 차례를 기다리지 않게 넘겨줌
+    parallel_pass_turn(&w->st);
+}
+
+static void parallel_task(void *arg) {
+    JpegWorker *w = arg;
+    parallel_run(w);
+    xSemaphoreGive(w->st.par->done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t decode_jpeg_parallel(jpeg_stream_t *js, const jpeg_rst_index_t *index) {
+#if CONFIG_FREERTOS_UNICORE
+    return decode_jpeg_stream(js);
+#else
+    if (!js->fp || !js->band_cb) return ESP_ERR_INVALID_ARG;
+    if (!index || index->interval == 0 || !index->starts) return decode_jpeg_stream(js);
+
+    js->sourceWidth = index->width;
+    js->sourceHeight = index->height;
+    if (js->scale < 0 || js->scale > 3) {
+        js->scale = getScale(js->screenWidth, js->screenHeight, index->width, index->height);
+    }
+    js->imageWidth = index->width >> js->scale;
+    js->imageHeight = index->height >> js->scale;
+    js->bandWidth = js->imageWidth < js->screenWidth ? js->imageWidth : js->screenWidth;
+
+    JpegParallel par = { 0 };
+    JpegWorker *w = calloc(2, sizeof(JpegWorker));
+    bool ready = w != NULL;
+    if (ready) {
+        par.io = xSemaphoreCreateMutex();
+        par.turn[0] = xSemaphoreCreateBinary();
+        par.turn[1] = xSemaphoreCreateBinary();
+        par.done = xSemaphoreCreateBinary();
+        ready = par.io && par.turn[0] && par.turn[1] && par.done;
+    }
+    for (int i = 0; ready && i < 2; i++) {
+        w[i].st.js = js;
+        w[i].st.par = &par;
+        w[i].work = decode_arena_alloc(JD_PAR_WORKSZ, "tjpgd worker");
+        ready = w[i].work && parallel_plan(&w[i], index, i, js->scale) &&
+                jd_prepare(&w[i].decoder, splice_infunc, w[i].work, JD_PAR_WORKSZ, &w[i].st) == JDR_OK;
+    }
+    if (ready) {
+        xSemaphoreGive(par.turn[0]);
+        // 두 번째 작업자는 다른 코어에 고정, 첫 번째는 호출한 태스크에서 실행
+        ready = xTaskCreatePinnedToCore(parallel_task, "jpeg_par", JD_PAR_STACK, &w[1],
+                                        uxTaskPriorityGet(NULL), NULL, 1 - xPortGetCoreID()) == pdPASS;
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (ready) {
+        ESP_LOGD(TAG, "parallel decode, %d + %d intervals", w[0].sp.total, w[1].sp.total);
+        parallel_run(&w[0]);
+        xSemaphoreTake(par.done, portMAX_DELAY);
+        ret = w[0].ret != ESP_OK ? w[0].ret : w[1].ret;
+    }
+
+    if (w) {
+        decode_arena_free(w[1].work);
+        decode_arena_free(w[0].work);
+        free(w);
+    }
+    if (par.io) vSemaphoreDelete(par.io);
+    if (par.turn[0]) vSemaphoreDelete(par.turn[0]);
+    if (par.turn[1]) vSemaphoreDelete(par.turn[1]);
+    if (par.done) vSemaphoreDelete(par.done);
+
+    if (!ready) {
+        ESP_LOGW(TAG, "parallel decode not possible, decoding serially");
+        return decode_jpeg_stream(js);
+    }
+    return ret;
+#endif
+}
+
+// --------------------------------------------------
+// EXIF(APP1) 파싱: 방향 태그와 IFD1의 JPEG 썸네일 위치만 추출
+// --------------------------------------------------
+static uint16_t exif_get16(const uint8_t *p, bool le) {
+    return le ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+}
+
+static uint32_t exif_get32(const uint8_t *p, bool le) {
+    return le ? (p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24))
+              : (((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]);
+}
+
+// IFD 하나를 읽어 필요한 태그만 꺼내고 다음 IFD 오프셋을 반환 (0 = 없음)
+static uint32_t exif_read_ifd(FILE *fp, long tiff, uint32_t size, uint32_t ifd, bool le,
+                              uint32_t *orientation, uint32_t *thumbOffset, uint32_t *thumbLength) {
+    uint8_t entry[12];
+    if (ifd + 2 > size || fseek(fp, tiff + ifd, SEEK_SET) != 0 || fread(entry, 1, 2, fp) != 2) return 0;
+    uint16_t count = exif_get16(entry, le);
+    if (ifd + 2 + count * 12 + 4 > size) return 0;
+
+    for (int i = 0; i < count; i++) {
+        if (fread(entry, 1, 12, fp) != 12) return 0;
+        uint16_t tag = exif_get16(entry, le);
+        uint16_t type = exif_get16(&entry[2], le);
+        uint32_t value = (type == 3) ? exif_get16(&entry[8], le) : exif_get32(&entry[8], le);
+        if (tag == 0x0112 && orientation) *orientation = value;        // Orientation
+        if (tag == 0x0201 && thumbOffset) *thumbOffset = value;        // JPEGInterchangeFormat
+        if (tag == 0x0202 && thumbLength) *thumbLength = value;        // JPEGInterchangeFormatLength
+    }
+    if (fread(entry, 1, 4, fp) != 4) return 0;
+    return exif_get32(entry, le);
+}
+
+esp_err_t decode_jpeg_exif(FILE *fp, long offset, jpeg_exif_t *exif) {
+    uint8_t buf[8];
+    memset(exif, 0, sizeof(*exif));
+    exif->orientation = 1;
+
+    if (fseek(fp, offset, SEEK_SET) != 0 || fread(buf, 1, 2, fp) != 2 ||
+        buf[0] != 0xFF || buf[1] != 0xD8) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // SOS 전까지 세그먼트를 길이로 건너뛰며 "Exif\0\0" APP1을 찾음
+    while (fread(buf, 1, 4, fp) == 4 && buf[0] == 0xFF) {
+        uint8_t marker = buf[1];
+        uint16_t seglen = (buf[2] << 8) | buf[3];
+        long seg = ftell(fp);
+        if (marker == 0xDA || marker == 0xD9 || seglen < 2) break;
+
+        if (marker == 0xE1 && seglen >= 2 + 6 + 8 &&
+            fread(buf, 1, 6, fp) == 6 && memcmp(buf, "Exif\0\0", 6) == 0) {
+            long tiff = seg + 6;
+            uint32_t size = seglen - 2 - 6;
+            if (fread(buf, 1, 8, fp) != 8) break;
+            bool le = (buf[0] == 'I');
+            if ((buf[0] != 'I' && buf[0] != 'M') || exif_get16(&buf[2], le) != 42) break;
+
+            uint32_t orientation = 1, thumbOffset = 0, thumbLength = 0;
+            uint32_t ifd1 = exif_read_ifd(fp, tiff, size, exif_get32(&buf[4], le), le,
+                                          &orientation, NULL, NULL);
+            if (ifd1) {
+                exif_read_ifd(fp, tiff, size, ifd1, le, NULL, &thumbOffset, &thumbLength);
+            }
+            if (orientation >= 1 && orientation <= 8) exif->orientation = orientation;
+            if (thumbLength > 0 && thumbOffset + thumbLength <= size) {
+                exif->thumbOffset = tiff + thumbOffset;
+                exif->thumbLength = thumbLength;
+            }
+            ESP_LOGD(TAG, "orientation=%d thumbnail=%u bytes", exif->orientation, (unsigned)exif->thumbLength);
+            return ESP_OK;
+        }
+        if (fseek(fp, seg + seglen - 2, SEEK_SET) != 0) break;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
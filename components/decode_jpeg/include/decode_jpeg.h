@@ -1,5 +1,7 @@
 #pragma once
+#include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
 
 #if 0
@@ -13,6 +15,9 @@ typedef struct __attribute__((__packed__)) {
 //rgb565 format
 typedef uint16_t pixel_jpeg;
 
+// tjpgd work buffer, borrowed from the decoder arena (decode_arena.h) while decoding
+#define DECODE_JPEG_WORKSZ 50000
+
 /**
  * @brief Decode the jpeg ``image.jpg`` embedded into the program file into pixel data.
  *
@@ -32,3 +37,145 @@ esp_err_t decode_jpeg(pixel_jpeg ***pixels, char * file, int screenWidth, int sc
 
 esp_err_t release_image(pixel_jpeg ***pixels, int screenWidth, int screenHeight);
 
+
+typedef struct jpeg_stream jpeg_stream_t;
+
+/**
+ * @brief Called for every decoded band (one MCU row) of a streamed JPEG.
+ *
+ * @param js The stream being decoded, imageWidth/imageHeight are valid
+ * @param top First row of the band in the scaled image
+ * @param height Number of rows in the band
+ * @param band height rows of bandWidth pixels, bandWidth = min(imageWidth, screenWidth)
+ * @return false to stop decoding
+ */
+typedef bool (*jpeg_band_cb_t)(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band);
+
+/**
+ * @brief Source of a JPEG that is not a seekable file (e.g. still arriving over the network).
+ *
+ * @param buf Where to put the next len bytes, NULL to skip them
+ * @return Bytes read or skipped, fewer than len only at the end of the data
+ */
+typedef size_t (*jpeg_read_cb_t)(void *arg, uint8_t *buf, size_t len);
+
+struct jpeg_stream {
+	FILE *fp;				// source file, does not have to start with the JPEG
+	long offset;			// start of the JPEG data in fp
+	size_t length;			// size of the JPEG data, 0 = up to end of file
+	jpeg_read_cb_t read;	// instead of fp: read once from the start, front to back
+	void *read_arg;
+	int scale;				// in: 0..3 for 1/1..1/8, -1 = fit screen. out: scale used
+	int screenWidth;		// bands are clipped to the screen
+	int screenHeight;
+	jpeg_band_cb_t band_cb;
+	void *arg;				// for band_cb
+	int sourceWidth;		// out: size of the JPEG
+	int sourceHeight;
+	int imageWidth;			// out: size after scaling
+	int imageHeight;
+	int bandWidth;			// out: min(imageWidth, screenWidth)
+};
+
+/**
+ * @brief Decode a JPEG band by band without a frame buffer.
+ *
+ * Only one MCU row of RGB565 pixels is held in memory. Decoding stops early
+ * once the bands are below the screen or band_cb returns false.
+ *
+ * With js->read instead of js->fp the data is consumed in one forward pass,
+ * so bands come out as the bytes arrive (offset is not used).
+ *
+ * @return - ESP_ERR_NOT_SUPPORTED if image is malformed or a progressive jpeg file
+ *         - ESP_ERR_NO_MEM if out of memory
+ *         - ESP_OK on succesful decode (also when stopped by band_cb)
+ */
+esp_err_t decode_jpeg_stream(jpeg_stream_t *js);
+
+/**
+ * @brief Read only the JPEG header and fill in the out fields of js.
+ *
+ * Resolves scale -1 the same way decode_jpeg_stream() does, so callers can
+ * lay out the screen before decoding any pixels. Needs js->fp: a js->read
+ * source cannot be read a second time.
+ */
+esp_err_t decode_jpeg_info(jpeg_stream_t *js);
+
+typedef struct {
+	int orientation;		// EXIF orientation 1..8, 1 when absent
+	long thumbOffset;		// embedded JPEG thumbnail, absolute file offset
+	size_t thumbLength;		// 0 if there is no thumbnail
+} jpeg_exif_t;
+
+/**
+ * @brief Parse the EXIF APP1 segment of the JPEG at offset in fp.
+ *
+ * Only the orientation tag and the IFD1 JPEG thumbnail are extracted. The
+ * thumbnail can be decoded with decode_jpeg_stream() using thumbOffset and
+ * thumbLength.
+ *
+ * @return - ESP_ERR_NOT_FOUND if there is no EXIF segment (exif holds the defaults)
+ *         - ESP_ERR_NOT_SUPPORTED if the data is not a JPEG
+ *         - ESP_OK on success
+ */
+esp_err_t decode_jpeg_exif(FILE *fp, long offset, jpeg_exif_t *exif);
+
+typedef struct {
+	long offset;			// start of the JPEG in the file
+	int width;				// image size
+	int height;
+	int mcuWidth;			// MCU size in pixels (8 or 16)
+	int mcuHeight;
+	int interval;			// restart interval in MCUs, 0 = no restart markers
+	long sofPos;			// file offset of the SOF0 height/width fields
+	long dataPos;			// first byte of the entropy-coded data
+	long dataEnd;			// position of the EOI marker
+	int count;				// number of restart intervals
+	uint32_t *starts;		// file offset of each interval's entropy-coded data
+} jpeg_rst_index_t;
+
+/**
+ * @brief Index the restart (RSTn) markers of the JPEG at offset in fp.
+ *
+ * The entropy-coded data is only scanned for markers, nothing is decoded.
+ * Keep the index while panning over the same image and release it with
+ * decode_jpeg_index_free().
+ *
+ * @return - ESP_OK on success, interval is 0 if the image has no restart markers
+ *         - ESP_ERR_NOT_SUPPORTED if the image is not a baseline JPEG or the markers do not match DRI
+ *         - ESP_ERR_NO_MEM if the offset table cannot be allocated
+ */
+esp_err_t decode_jpeg_index(FILE *fp, long offset, jpeg_rst_index_t *index);
+
+void decode_jpeg_index_free(jpeg_rst_index_t *index);
+
+/**
+ * @brief Decode the source rectangle (srcX, srcY, srcW, srcH) of a JPEG band by band.
+ *
+ * With an index whose restart interval covers whole MCU rows or divides an
+ * MCU row evenly, only the intervals overlapping the rectangle are fed to the
+ * decoder, so the cost follows the visible area. Otherwise (index NULL or no
+ * restart markers) the whole image is decoded and clipped, stopping below the
+ * rectangle.
+ *
+ * js works as for decode_jpeg_stream(): scale -1 fits the rectangle into the
+ * screen, imageWidth/imageHeight are the scaled rectangle and band tops are
+ * relative to it. sourceWidth/sourceHeight are the full image size.
+ */
+esp_err_t decode_jpeg_viewport(jpeg_stream_t *js, const jpeg_rst_index_t *index,
+                               int srcX, int srcY, int srcW, int srcH);
+
+/**
+ * @brief Decode a JPEG band by band on both cores.
+ *
+ * The restart intervals are split into groups of whole MCU rows, and the
+ * groups alternate between two workers. Each worker has its own decoder
+ * and work buffer, and one of them is pinned to the other core. band_cb is
+ * still called from one task at a time, top to bottom, but not always from
+ * the calling task.
+ *
+ * Without usable restart markers (index NULL, no DRI, or an interval that
+ * neither covers whole MCU rows nor divides an MCU row) or on a single-core
+ * build, this is decode_jpeg_stream().
+ */
+esp_err_t decode_jpeg_parallel(jpeg_stream_t *js, const jpeg_rst_index_t *index);
@@ -4,6 +4,22 @@
 #include "pngle.h"
 #include "esp_log.h"
 
+#define rgb565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+
+// one decode at a time (pngle_t itself comes from the shared decode arena)
+static png_scaler_t scaler;
+static png_interlace_t interlace;
+
+static void png_row(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels)
+{
+	png_scaler_push(&scaler, y, pixels);
+}
+
+static void png_row_interlaced(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels)
+{
+	png_interlace_push(&interlace, pngle->interlace_pass, y, pixels, n);
+}
+
 void png_init(pngle_t *pngle, uint32_t w, uint32_t h)
 {
 	ESP_LOGD(__FUNCTION__, "png_init w=%"PRIu32" h=%"PRIu32, w, h);
@@ -25,10 +41,41 @@ void png_init(pngle_t *pngle, uint32_t w, uint32_t h)
 	}
 	ESP_LOGD(__FUNCTION__, "reduction=%d scale_factor=%f", pngle->reduction, pngle->scale_factor);
 	ESP_LOGD(__FUNCTION__, "imageWidth=%d imageHeight=%d", pngle->imageWidth, pngle->imageHeight);
-		
+
+	// Reduce by area averaging instead of dropping pixels in png_draw().
+	// Interlaced images arrive pass by pass and are painted as refining blocks;
+	// later passes overwrite earlier ones, so they composite onto a color only.
+	png_scaler_free(&scaler);
+	png_interlace_free(&interlace);
+	if (pngle->hdr.interlace && pngle->pixels &&
+		pngle->imageWidth > 0 && pngle->imageHeight > 0 &&
+		png_interlace_init(&interlace, w, h, pngle->imageWidth, pngle->imageHeight, pngle->pixels) == ESP_OK) {
+		if (!pngle->has_background) pngle_set_background(pngle, 0, 0, 0);
+		pngle_set_row_callback(pngle, png_row_interlaced, PNGLE_ROW_RGB565);
+	} else if (pngle->reduction && pngle->pixels && !pngle->hdr.interlace &&
+		pngle->imageWidth > 0 && pngle->imageHeight > 0 &&
+		png_scaler_init(&scaler, w, h, pngle->imageWidth, pngle->imageHeight, pngle->pixels) == ESP_OK) {
+		// same background as png_draw(): the set color, else the buffer's own contents
+		const uint8_t *bg = pngle->background;
+		png_scaler_set_background(&scaler, rgb565(bg[0], bg[1], bg[2]), pngle->has_background ? NULL : pngle->pixels);
+		pngle_set_row_callback(pngle, png_row, PNGLE_ROW_RGBA8888);
+	} else {
+		pngle_set_row_callback(pngle, NULL, PNGLE_ROW_RGBA8888);
+	}
 }
 
-#define rgb565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+// straight alpha over an RGB888 background, 8-bit fixed point
+static inline pixel_png blend565(const uint8_t rgba[4], uint32_t br, uint32_t bg, uint32_t bb)
+{
+	uint32_t a = rgba[3], ia = 255 - a;
+	uint32_t r = rgba[0] * a + br * ia + 128;
+	uint32_t g = rgba[1] * a + bg * ia + 128;
+	uint32_t b = rgba[2] * a + bb * ia + 128;
+	r = (r + (r >> 8)) >> 8;
+	g = (g + (g >> 8)) >> 8;
+	b = (b + (b >> 8)) >> 8;
+	return rgb565(r, g, b);
+}
 
 void png_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t rgba[4])
 {
@@ -52,11 +99,25 @@ void png_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, ui
 		pngle->pixels[_y][_x].green = rgba[1];
 		pngle->pixels[_y][_x].blue = rgba[2];
 #endif
-		pngle->pixels[_y][_x] = rgb565(rgba[0], rgba[1], rgba[2]);
+		pixel_png *dst = &pngle->pixels[_y][_x];
+		uint8_t a = rgba[3];
+		if (a == 255) {
+			*dst = rgb565(rgba[0], rgba[1], rgba[2]);
+		} else if (pngle->has_background) {
+			// composite onto the pngle_set_background() color
+			const uint8_t *bg = pngle->background;
+			*dst = a ? blend565(rgba, bg[0], bg[1], bg[2]) : rgb565(bg[0], bg[1], bg[2]);
+		} else if (a) {
+			// composite onto what the buffer already holds
+			uint32_t r5 = *dst >> 11, g6 = (*dst >> 5) & 0x3F, b5 = *dst & 0x1F;
+			*dst = blend565(rgba, (r5 << 3) | (r5 >> 2), (g6 << 2) | (g6 >> 4), (b5 << 3) | (b5 >> 2));
+		}
 	}
 
 }
 
 void png_finish(pngle_t *pngle) {
 	ESP_LOGD(__FUNCTION__, "png_finish");
+	png_scaler_free(&scaler);
+	png_interlace_free(&interlace);
 }
@@ -1,9 +1,70 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
 #include "pngle.h"
 
+// Draw-callback helpers for a buffered pngle (pngle_new()). Transparent pixels
+// are composited onto the pngle_set_background() color when one is set, else
+// onto what pngle->pixels already holds (black unless the caller painted it).
+// Interlaced images go through png_interlace_t and use the color (black if unset).
 void png_init(pngle_t *pngle, uint32_t w, uint32_t h);
 void png_draw(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t rgba[4]);
 void png_finish(pngle_t *pngle);
 
+/*
+ * Streaming area-average resampler for non-interlaced PNG rows.
+ *
+ * Source rows (RGBA8888, e.g. from a PNGLE_ROW_RGBA8888 row callback) are
+ * pushed top to bottom. Each output pixel is the average of the source area
+ * it covers, weighted by exact overlap, so reducing never drops pixels and
+ * enlarging replicates rows and columns instead of leaving gaps. Every output
+ * row is written exactly once, as soon as its last source row arrives; only
+ * two rows of per-column sums are kept.
+ *
+ * Color is averaged premultiplied by alpha and composited over a background
+ * when the row is written: a solid color (black by default) or an existing
+ * frame-buffer layer of the output size, which may be the output rows
+ * themselves to draw over what they already hold.
+ */
+typedef struct {
+	uint32_t srcW, srcH;
+	uint32_t dstW, dstH;
+	pixel_png **rows;	// dstH rows of dstW pixels, owned by the caller
+	pixel_png color;	// background where there is no layer
+	pixel_png **layer;	// optional background rows, dstH x dstW
+	uint32_t *hsum;		// current source row resampled horizontally, 8.8 fixed point premultiplied RGBA
+	uint32_t *vsum;		// weighted sum of hsum rows for output row out_y
+	uint32_t src_y;		// next source row expected
+	uint32_t out_y;		// next output row to complete
+} png_scaler_t;
+
+esp_err_t png_scaler_init(png_scaler_t *s, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH, pixel_png **rows);
+void png_scaler_set_background(png_scaler_t *s, pixel_png color, pixel_png **layer); // after init; layer may be NULL
+void png_scaler_push(png_scaler_t *s, uint32_t y, const uint8_t *rgba); // rows out of order are ignored
+void png_scaler_free(png_scaler_t *s);
+
+/*
+ * Adam7 sink for interlaced PNG rows (RGB565, e.g. from a PNGLE_ROW_RGB565
+ * row callback, alpha already composited by pngle_set_background()).
+ *
+ * Each pass row is painted as blocks: a pixel of pass 1 fills its whole 8x8
+ * source block, later passes refine the parts of the block they own, so the
+ * output holds a complete, progressively sharper picture after every pass.
+ * Output pixels sample the source pixel under their center; once pass 7 is
+ * in, the result is the plain nearest-pixel scaling of the image. Only
+ * output-width buffers are kept (column map, one resampled pass row).
+ */
+typedef struct {
+	uint32_t srcW, srcH;
+	uint32_t dstW, dstH;
+	pixel_png **rows;	// dstH rows of dstW pixels, owned by the caller
+	uint16_t *mapX;		// source column under each output column
+	uint16_t *mapY;		// source row under each output row
+	pixel_png *line;	// current pass row resampled to the output width
+	uint8_t *cover;		// output columns inside the current pass's blocks
+} png_interlace_t;
+
+esp_err_t png_interlace_init(png_interlace_t *s, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH, pixel_png **rows);
+void png_interlace_push(png_interlace_t *s, int pass, uint32_t y, const pixel_png *pixels, uint32_t n); // pass as in pngle->interlace_pass
+void png_interlace_free(png_interlace_t *s);
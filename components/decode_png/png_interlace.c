@@ -0,0 +1,93 @@
+#include <stdlib.h>
+#include <string.h>
+#include "decode_png.h"
+
+// Adam7 pass geometry, indexed like pngle->interlace_pass (0 = not interlaced).
+// A pass pixel at (x, y) stands for the block [x, x + div_x - off_x) x
+// [y, y + div_y - off_y) until later passes fill in the rest of it.
+static const uint8_t off_x[8] = { 0, 0, 4, 0, 2, 0, 1, 0 };
+static const uint8_t off_y[8] = { 0, 0, 0, 4, 0, 2, 0, 1 };
+static const uint8_t div_x_shift[8] = { 0, 3, 3, 2, 2, 1, 1, 0 };
+static const uint8_t div_y[8] = { 1, 8, 8, 8, 4, 4, 2, 2 };
+
+// source coordinate under the center of each output pixel
+static uint16_t *center_map(uint32_t src, uint32_t dst)
+{
+	uint16_t *map = malloc(dst * sizeof(uint16_t));
+	if (!map) return NULL;
+	for (uint32_t i = 0; i < dst; i++) {
+		map[i] = (uint16_t)(((uint64_t)(2 * i + 1) * src) / (2 * dst));
+	}
+	return map;
+}
+
+esp_err_t png_interlace_init(png_interlace_t *s, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH, pixel_png **rows)
+{
+	memset(s, 0, sizeof(*s));
+	if (!rows || !srcW || !srcH || !dstW || !dstH) return ESP_ERR_INVALID_ARG;
+	if (srcW > UINT16_MAX || srcH > UINT16_MAX) return ESP_ERR_INVALID_SIZE;
+
+	s->mapX = center_map(srcW, dstW);
+	s->mapY = center_map(srcH, dstH);
+	s->line = malloc(dstW * sizeof(pixel_png));
+	s->cover = malloc(dstW);
+	if (!s->mapX || !s->mapY || !s->line || !s->cover) {
+		png_interlace_free(s);
+		return ESP_ERR_NO_MEM;
+	}
+	s->srcW = srcW;
+	s->srcH = srcH;
+	s->dstW = dstW;
+	s->dstH = dstH;
+	s->rows = rows;
+	return ESP_OK;
+}
+
+void png_interlace_free(png_interlace_t *s)
+{
+	free(s->mapX);
+	free(s->mapY);
+	free(s->line);
+	free(s->cover);
+	s->mapX = NULL;
+	s->mapY = NULL;
+	s->line = NULL;
+	s->cover = NULL;
+	s->rows = NULL;
+}
+
+void png_interlace_push(png_interlace_t *s, int pass, uint32_t y, const pixel_png *pixels, uint32_t n)
+{
+	if (!s->rows || pass < 0 || pass > 7) return;
+
+	// output rows whose source row falls in this pass row's blocks
+	uint32_t y1 = y + div_y[pass] - off_y[pass];
+	uint32_t oy = (uint32_t)((uint64_t)y * s->dstH / s->srcH);
+	if (oy >= s->dstH) oy = s->dstH - 1;
+	while (oy > 0 && s->mapY[oy - 1] >= y) oy--;
+	while (oy < s->dstH && s->mapY[oy] < y) oy++;
+	if (oy >= s->dstH || s->mapY[oy] >= y1) return;
+
+	// resample the pass row to the output width once; columns outside this
+	// pass's blocks keep what earlier passes painted
+	uint32_t shift = div_x_shift[pass];
+	uint32_t mask = (1U << shift) - 1;
+	bool full = off_x[pass] == 0;
+	for (uint32_t ox = 0; ox < s->dstW; ox++) {
+		uint32_t sx = s->mapX[ox];
+		uint32_t i = sx >> shift;
+		s->cover[ox] = (full || (sx & mask) >= off_x[pass]) && i < n;
+		if (s->cover[ox]) s->line[ox] = pixels[i];
+	}
+
+	for (; oy < s->dstH && s->mapY[oy] < y1; oy++) {
+		pixel_png *dst = s->rows[oy];
+		if (full) {
+			memcpy(dst, s->line, s->dstW * sizeof(pixel_png));
+			continue;
+		}
+		for (uint32_t ox = 0; ox < s->dstW; ox++) {
+			if (s->cover[ox]) dst[ox] = s->line[ox];
+		}
+	}
+}
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include "decode_png.h"
+
+// Coordinates are kept in "scaled units": source column x spans
+// [x * dstW, (x + 1) * dstW) and output column j spans [j * srcW, (j + 1) * srcW),
+// so the overlap of any source pixel with any output pixel is an exact integer
+// and every output pixel receives a total weight of srcW (srcH vertically).
+
+#define rgb565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+
+esp_err_t png_scaler_init(png_scaler_t *s, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH, pixel_png **rows)
+{
+	memset(s, 0, sizeof(*s));
+	if (!rows || !srcW || !srcH || !dstW || !dstH) return ESP_ERR_INVALID_ARG;
+	// keeps the 8.8 sums and the scaled-unit positions inside 32 bits
+	if (srcW > UINT16_MAX || srcH > UINT16_MAX || dstW > UINT16_MAX || dstH > UINT16_MAX ||
+		(uint64_t)srcW * dstW > UINT32_MAX || (uint64_t)srcH * dstH > UINT32_MAX) {
+		return ESP_ERR_INVALID_SIZE;
+	}
+
+	s->hsum = malloc(dstW * 4 * sizeof(uint32_t));
+	s->vsum = calloc(dstW * 4, sizeof(uint32_t));
+	if (!s->hsum || !s->vsum) {
+		png_scaler_free(s);
+		return ESP_ERR_NO_MEM;
+	}
+	s->srcW = srcW;
+	s->srcH = srcH;
+	s->dstW = dstW;
+	s->dstH = dstH;
+	s->rows = rows;
+	return ESP_OK;
+}
+
+void png_scaler_set_background(png_scaler_t *s, pixel_png color, pixel_png **layer)
+{
+	s->color = color;
+	s->layer = layer;
+}
+
+void png_scaler_free(png_scaler_t *s)
+{
+	free(s->hsum);
+	free(s->vsum);
+	s->hsum = NULL;
+	s->vsum = NULL;
+	s->rows = NULL;
+}
+
+// 8-bit a * b / 255, rounded
+static inline uint32_t mul8(uint32_t a, uint32_t b)
+{
+	uint32_t t = a * b + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+// Resample one RGBA8888 source row to dstW columns of premultiplied RGBA,
+// 8.8 fixed point. Premultiplying first keeps the color of transparent
+// pixels out of the average.
+static void scale_row_h(png_scaler_t *s, const uint8_t *rgba)
+{
+	uint32_t *h = s->hsum;
+
+	if (s->srcW == s->dstW) {
+		for (uint32_t j = 0; j < s->dstW; j++, rgba += 4, h += 4) {
+			uint32_t a = rgba[3];
+			if (a == 255) {
+				h[0] = rgba[0] << 8;
+				h[1] = rgba[1] << 8;
+				h[2] = rgba[2] << 8;
+			} else {
+				h[0] = mul8(rgba[0], a) << 8;
+				h[1] = mul8(rgba[1], a) << 8;
+				h[2] = mul8(rgba[2], a) << 8;
+			}
+			h[3] = a << 8;
+		}
+		return;
+	}
+
+	// walk source and output column boundaries together; a source pixel
+	// feeds every output column it overlaps (two at most when reducing,
+	// several when enlarging)
+	uint32_t pos = 0, jend = s->srcW, xend = s->dstW;
+	uint32_t sum[4] = { 0 };
+	uint32_t px[4];
+	uint32_t half = s->srcW >> 1;
+	bool load = true;
+	for (uint32_t j = 0; j < s->dstW;) {
+		if (load) {
+			px[3] = rgba[3];
+			if (px[3] == 255) {
+				px[0] = rgba[0];
+				px[1] = rgba[1];
+				px[2] = rgba[2];
+			} else {
+				px[0] = mul8(rgba[0], px[3]);
+				px[1] = mul8(rgba[1], px[3]);
+				px[2] = mul8(rgba[2], px[3]);
+			}
+			load = false;
+		}
+		uint32_t end = jend < xend ? jend : xend;
+		uint32_t w = end - pos;
+		for (int c = 0; c < 4; c++) sum[c] += px[c] * w;
+		pos = end;
+		if (end == jend) {
+			for (int c = 0; c < 4; c++) {
+				h[c] = ((sum[c] << 8) + half) / s->srcW;
+				sum[c] = 0;
+			}
+			h += 4;
+			j++;
+			jend += s->srcW;
+		}
+		if (end == xend) {
+			rgba += 4;
+			xend += s->dstW;
+			load = true;
+		}
+	}
+}
+
+// Premultiplied 8-bit RGBA over an RGB565 background pixel.
+static inline pixel_png over(uint32_t r, uint32_t g, uint32_t b, uint32_t a, pixel_png bg)
+{
+	if (a < 255) {
+		uint32_t ia = 255 - a;
+		uint32_t br = (bg >> 11) & 0x1F, bgr = (bg >> 5) & 0x3F, bb = bg & 0x1F;
+		r += mul8((br << 3) | (br >> 2), ia);
+		g += mul8((bgr << 2) | (bgr >> 4), ia);
+		b += mul8((bb << 3) | (bb >> 2), ia);
+		// averaged color can round one above its averaged alpha
+		if (r > 255) r = 255;
+		if (g > 255) g = 255;
+		if (b > 255) b = 255;
+	}
+	return rgb565(r, g, b);
+}
+
+void png_scaler_push(png_scaler_t *s, uint32_t y, const uint8_t *rgba)
+{
+	// rows must come top to bottom, each exactly once
+	if (!s->rows || y != s->src_y || s->out_y >= s->dstH) return;
+	s->src_y++;
+
+	scale_row_h(s, rgba);
+
+	// distribute the row over the output rows it overlaps
+	uint32_t pos = y * s->dstH;
+	uint32_t yend = pos + s->dstH;
+	const pixel_png *copy = NULL;
+	while (pos < yend && s->out_y < s->dstH) {
+		uint32_t oend = (s->out_y + 1) * s->srcH;
+		uint32_t end = oend < yend ? oend : yend;
+		uint32_t w = end - pos;
+		pixel_png *dst = s->rows[s->out_y];
+		const pixel_png *under = s->layer ? s->layer[s->out_y] : NULL;
+
+		if (w == s->srcH) {
+			// output row lies inside this source row: no averaging, and the
+			// rows after it (enlarging) are the same pixels again, unless
+			// each one composites onto its own layer row
+			if (copy) {
+				memcpy(dst, copy, s->dstW * sizeof(pixel_png));
+			} else {
+				const uint32_t *h = s->hsum;
+				for (uint32_t j = 0; j < s->dstW; j++, h += 4) {
+					dst[j] = over((h[0] + 128) >> 8, (h[1] + 128) >> 8, (h[2] + 128) >> 8, (h[3] + 128) >> 8,
+						under ? under[j] : s->color);
+				}
+				if (!under) copy = dst;
+			}
+		} else {
+			const uint32_t *h = s->hsum;
+			uint32_t *v = s->vsum;
+			for (uint32_t i = 0; i < s->dstW * 4; i++) {
+				v[i] += h[i] * w;
+			}
+			if (end == oend) {
+				// output row complete: normalize, pack, start the next one
+				uint32_t den = s->srcH << 8;
+				uint32_t half = s->srcH << 7;
+				for (uint32_t j = 0; j < s->dstW; j++, v += 4) {
+					dst[j] = over((v[0] + half) / den, (v[1] + half) / den, (v[2] + half) / den, (v[3] + half) / den,
+						under ? under[j] : s->color);
+				}
+				memset(s->vsum, 0, s->dstW * 4 * sizeof(uint32_t));
+			}
+		}
+		pos = end;
+		if (end == oend) s->out_y++;
+	}
+}
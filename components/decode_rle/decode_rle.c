@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "decode_rle.h"
+
+#define TAG "DECODE_RLE"
+
+static uint16_t get16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool rle565_probe(const uint8_t *head, size_t len, uint16_t *width, uint16_t *height)
+{
+	if (len < RLE565_HEADER_SIZE) return false;
+	if (memcmp(head, RLE565_MAGIC, 4) != 0) return false;
+	if (head[4] != RLE565_VERSION) return false;
+	uint16_t w = get16(&head[6]);
+	uint16_t h = get16(&head[8]);
+	if (w == 0 || h == 0) return false;
+	if (width) *width = w;
+	if (height) *height = h;
+	return true;
+}
+
+bool rle565_is_file(const char *file)
+{
+	uint8_t head[RLE565_HEADER_SIZE];
+	FILE *fp = fopen(file, "rb");
+	if (!fp) return false;
+	size_t len = fread(head, 1, sizeof(head), fp);
+	fclose(fp);
+	return rle565_probe(head, len, NULL, NULL);
+}
+
+esp_err_t rle565_open(rle565_t *rle, const char *file)
+{
+	uint8_t head[RLE565_HEADER_SIZE];
+	memset(rle, 0, sizeof(*rle));
+
+	rle->fp = fopen(file, "rb");
+	if (!rle->fp) {
+		ESP_LOGW(TAG, "File not found [%s]", file);
+		return ESP_ERR_NOT_FOUND;
+	}
+	size_t len = fread(head, 1, sizeof(head), rle->fp);
+	if (!rle565_probe(head, len, &rle->width, &rle->height)) {
+		ESP_LOGW(TAG, "Not an RLE565 file [%s]", file);
+		rle565_close(rle);
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+
+	// worst case row: all literals, one control byte per 128 pixels
+	rle->bufSize = rle->width * 2 + (rle->width + 127) / 128;
+	rle->index = malloc((rle->height + 1) * sizeof(uint32_t));
+	rle->buf = malloc(rle->bufSize);
+	if (!rle->index || !rle->buf) {
+		ESP_LOGE(TAG, "Error allocating memory for %dx%d index", rle->width, rle->height);
+		rle565_close(rle);
+		return ESP_ERR_NO_MEM;
+	}
+
+	// index is stored little-endian, read it in place and convert
+	uint8_t *raw = (uint8_t *)rle->index;
+	size_t count = rle->height + 1;
+	if (fread(raw, sizeof(uint32_t), count, rle->fp) != count) {
+		rle565_close(rle);
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+	for (size_t i = 0; i < count; i++) {
+		rle->index[i] = get32(&raw[i * 4]);
+	}
+
+	long dataStart = RLE565_HEADER_SIZE + count * sizeof(uint32_t);
+	for (int y = 0; y < rle->height; y++) {
+		if (rle->index[y] < dataStart || rle->index[y + 1] < rle->index[y] ||
+		    rle->index[y + 1] - rle->index[y] > rle->bufSize) {
+			ESP_LOGW(TAG, "Bad row index %d [%s]", y, file);
+			rle565_close(rle);
+			return ESP_ERR_NOT_SUPPORTED;
+		}
+	}
+	rle->pos = dataStart;
+	ESP_LOGD(TAG, "open %s %dx%d", file, rle->width, rle->height);
+	return ESP_OK;
+}
+
+esp_err_t rle565_unpack(const uint8_t *src, size_t len, uint16_t *row, int width)
+{
+	const uint8_t *end = src + len;
+	int x = 0;
+	while (src < end) {
+		uint8_t c = *src++;
+		if (c < 128) {
+			int n = c + 1;
+			if (x + n > width || end - src < n * 2) return ESP_ERR_INVALID_SIZE;
+			// pixels are stored little-endian, same as the ESP32
+			memcpy(&row[x], src, n * 2);
+			src += n * 2;
+			x += n;
+		} else {
+			int n = c - 126;
+			if (x + n > width || end - src < 2) return ESP_ERR_INVALID_SIZE;
+			uint16_t color = get16(src);
+			src += 2;
+			uint16_t *dst = &row[x];
+			x += n;
+			while (n--) *dst++ = color;
+		}
+	}
+	return (x == width) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t rle565_read_row(rle565_t *rle, int y, uint16_t *row)
+{
+	if (!rle->fp || y < 0 || y >= rle->height) return ESP_ERR_INVALID_ARG;
+
+	long offset = rle->index[y];
+	size_t len = rle->index[y + 1] - rle->index[y];
+	if (rle->pos != offset) {
+		if (fseek(rle->fp, offset, SEEK_SET) != 0) return ESP_FAIL;
+	}
+	if (fread(rle->buf, 1, len, rle->fp) != len) {
+		rle->pos = -1;
+		return ESP_FAIL;
+	}
+	rle->pos = offset + len;
+	return rle565_unpack(rle->buf, len, row, rle->width);
+}
+
+void rle565_close(rle565_t *rle)
+{
+	if (rle->fp) fclose(rle->fp);
+	free(rle->index);
+	free(rle->buf);
+	rle->fp = NULL;
+	rle->index = NULL;
+	rle->buf = NULL;
+}
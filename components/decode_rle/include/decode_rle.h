@@ -0,0 +1,74 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * RLE565: device-native screen image.
+ *
+ * Layout (little-endian):
+ *   header   "R565", version, flags, width, height, reserved  (12 bytes)
+ *   index    (height + 1) x uint32, file offset of every row plus end of data
+ *   rows     each row is a PackBits-style stream of RGB565 pixels:
+ *            c = 0..127   : c + 1 literal pixels follow
+ *            c = 128..255 : next pixel repeated c - 126 times (2..129)
+ *
+ * Files are produced on the host by tools/rle565.py.
+ */
+
+#define RLE565_MAGIC		"R565"
+#define RLE565_VERSION		1
+#define RLE565_HEADER_SIZE	12
+
+typedef struct {
+	FILE *fp;
+	uint16_t width;
+	uint16_t height;
+	uint32_t *index;	// height + 1 entries
+	uint8_t *buf;		// one compressed row
+	size_t bufSize;
+	long pos;			// current file position, avoids needless fseek
+} rle565_t;
+
+/**
+ * @brief Check whether the first bytes of a file carry the RLE565 magic.
+ *
+ * @param head First bytes of the file
+ * @param len Number of valid bytes in head
+ * @param width Image width out (may be NULL)
+ * @param height Image height out (may be NULL)
+ * @return true if head is a supported RLE565 header
+ */
+bool rle565_probe(const uint8_t *head, size_t len, uint16_t *width, uint16_t *height);
+
+/**
+ * @brief Check whether a file on storage is an RLE565 image.
+ */
+bool rle565_is_file(const char *file);
+
+/**
+ * @brief Open an RLE565 image and load its row index.
+ *
+ * @return - ESP_ERR_NOT_FOUND if the file cannot be opened
+ *         - ESP_ERR_NOT_SUPPORTED if the file is not RLE565 or is malformed
+ *         - ESP_ERR_NO_MEM if out of memory
+ *         - ESP_OK on success
+ */
+esp_err_t rle565_open(rle565_t *rle, const char *file);
+
+/**
+ * @brief Decompress row y into row (width pixels).
+ *
+ * Rows can be read in any order, sequential reads do not seek.
+ */
+esp_err_t rle565_read_row(rle565_t *rle, int y, uint16_t *row);
+
+/**
+ * @brief Decompress one packed row from memory.
+ *
+ * @return ESP_OK if src decodes to exactly width pixels
+ */
+esp_err_t rle565_unpack(const uint8_t *src, size_t len, uint16_t *row, int width);
+
+void rle565_close(rle565_t *rle);
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "frame_cache.h"
+
+#define TAG "FRAME_CACHE"
+
+#define FRAME_CACHE_MAGIC	0x43465444	// "DTFC"
+#define FRAME_CACHE_VERSION	2
+
+typedef struct {
+	uint32_t magic;			// written last, see frame_cache_commit()
+	uint16_t version;
+	uint16_t rotation;
+	uint32_t src_size;
+	int64_t src_mtime;
+	uint16_t screenWidth;
+	uint16_t screenHeight;
+	uint16_t x;
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint32_t background;
+	uint16_t revision;
+	uint16_t reserved;
+} frame_cache_header_t;
+
+// FNV-1a of the file name, so the sidecar name stays short on SPIFFS
+static uint32_t name_hash(const char *s)
+{
+	uint32_t h = 2166136261u;
+	while (*s) {
+		h ^= (uint8_t)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static esp_err_t sidecar_path_ext(char *dest, size_t size, const char *src, const char *ext)
+{
+	const char *slash = strrchr(src, '/');
+	const char *name = slash ? slash + 1 : src;
+	int dirlen = slash ? (int)(slash - src) : 0;
+	int n = snprintf(dest, size, "%.*s/.%08"PRIx32".%s", dirlen, src, name_hash(name), ext);
+	if (n < 0 || (size_t)n >= size) return ESP_ERR_INVALID_SIZE;
+	return ESP_OK;
+}
+
+static esp_err_t sidecar_path(char *dest, size_t size, const char *src)
+{
+	return sidecar_path_ext(dest, size, src, "fc");
+}
+
+static esp_err_t make_header(frame_cache_header_t *hdr, const char *src, const frame_cache_geom_t *geom)
+{
+	struct stat st;
+	if (stat(src, &st) != 0) return ESP_ERR_NOT_FOUND;
+
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->version = FRAME_CACHE_VERSION;
+	hdr->rotation = geom->rotation;
+	hdr->src_size = st.st_size;
+	hdr->src_mtime = st.st_mtime;
+	hdr->screenWidth = geom->screenWidth;
+	hdr->screenHeight = geom->screenHeight;
+	hdr->background = geom->background;
+	hdr->revision = geom->revision;
+	return ESP_OK;
+}
+
+bool frame_cache_is_sidecar(const char *name)
+{
+	size_t len = strlen(name);
+	return name[0] == '.' && len > 3 && (strcmp(&name[len - 3], ".fc") == 0 || strcmp(&name[len - 3], ".vf") == 0);
+}
+
+esp_err_t frame_cache_open(frame_cache_t *fc, const char *src, const frame_cache_geom_t *geom)
+{
+	frame_cache_header_t want, hdr;
+	memset(fc, 0, sizeof(*fc));
+
+	if (make_header(&want, src, geom) != ESP_OK) return ESP_ERR_NOT_FOUND;
+	if (sidecar_path(fc->path, sizeof(fc->path), src) != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+	fc->fp = fopen(fc->path, "rb");
+	if (!fc->fp) return ESP_ERR_NOT_FOUND;
+
+	if (fread(&hdr, sizeof(hdr), 1, fc->fp) != 1 ||
+	    hdr.magic != FRAME_CACHE_MAGIC ||
+	    hdr.version != want.version ||
+	    hdr.rotation != want.rotation ||
+	    hdr.src_size != want.src_size ||
+	    hdr.src_mtime != want.src_mtime ||
+	    hdr.screenWidth != want.screenWidth ||
+	    hdr.screenHeight != want.screenHeight ||
+	    hdr.background != want.background ||
+	    hdr.revision != want.revision ||
+	    hdr.x + hdr.width > hdr.screenWidth ||
+	    hdr.y + hdr.height > hdr.screenHeight) {
+		ESP_LOGI(TAG, "stale entry for %s", src);
+		frame_cache_close(fc);
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	fc->x = hdr.x;
+	fc->y = hdr.y;
+	fc->width = hdr.width;
+	fc->height = hdr.height;
+	ESP_LOGI(TAG, "hit %s -> %s (%dx%d)", src, fc->path, fc->width, fc->height);
+	return ESP_OK;
+}
+
+esp_err_t frame_cache_read_row(frame_cache_t *fc, uint16_t *row)
+{
+	if (!fc->fp || fc->rows >= fc->height) return ESP_ERR_INVALID_STATE;
+	if (fread(row, sizeof(uint16_t), fc->width, fc->fp) != fc->width) return ESP_FAIL;
+	fc->rows++;
+	return ESP_OK;
+}
+
+void frame_cache_close(frame_cache_t *fc)
+{
+	if (fc->fp) fclose(fc->fp);
+	fc->fp = NULL;
+}
+
+esp_err_t frame_cache_create(frame_cache_t *fc, const char *src, const frame_cache_geom_t *geom,
+                             uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+	frame_cache_header_t hdr;
+	memset(fc, 0, sizeof(*fc));
+
+	if (x + width > geom->screenWidth || y + height > geom->screenHeight) return ESP_ERR_INVALID_ARG;
+	esp_err_t ret = make_header(&hdr, src, geom);
+	if (ret != ESP_OK) return ret;
+	ret = sidecar_path(fc->path, sizeof(fc->path), src);
+	if (ret != ESP_OK) return ret;
+
+	hdr.x = fc->x = x;
+	hdr.y = fc->y = y;
+	hdr.width = fc->width = width;
+	hdr.height = fc->height = height;
+
+	fc->fp = fopen(fc->path, "wb");
+	if (!fc->fp) {
+		ESP_LOGW(TAG, "cannot create %s", fc->path);
+		return ESP_FAIL;
+	}
+	// magic stays zero until every row is on flash
+	if (fwrite(&hdr, sizeof(hdr), 1, fc->fp) != 1) {
+		frame_cache_abort(fc);
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+esp_err_t frame_cache_write_row(frame_cache_t *fc, const uint16_t *row)
+{
+	if (!fc->fp || fc->rows >= fc->height) return ESP_ERR_INVALID_STATE;
+	if (fwrite(row, sizeof(uint16_t), fc->width, fc->fp) != fc->width) {
+		ESP_LOGW(TAG, "write failed, storage full?");
+		frame_cache_abort(fc);
+		return ESP_FAIL;
+	}
+	fc->rows++;
+	return ESP_OK;
+}
+
+esp_err_t frame_cache_commit(frame_cache_t *fc)
+{
+	if (!fc->fp) return ESP_ERR_INVALID_STATE;
+	if (fc->rows != fc->height) {
+		frame_cache_abort(fc);
+		return ESP_ERR_INVALID_STATE;
+	}
+
+	uint32_t magic = FRAME_CACHE_MAGIC;
+	if (fseek(fc->fp, offsetof(frame_cache_header_t, magic), SEEK_SET) != 0 ||
+	    fwrite(&magic, sizeof(magic), 1, fc->fp) != 1) {
+		frame_cache_abort(fc);
+		return ESP_FAIL;
+	}
+	fclose(fc->fp);
+	fc->fp = NULL;
+	ESP_LOGI(TAG, "stored %s (%dx%d)", fc->path, fc->width, fc->height);
+	return ESP_OK;
+}
+
+void frame_cache_abort(frame_cache_t *fc)
+{
+	if (fc->fp) {
+		fclose(fc->fp);
+		fc->fp = NULL;
+		unlink(fc->path);
+	}
+}
+
+esp_err_t frame_cache_invalidate(const char *src)
+{
+	char path[64];
+	if (sidecar_path(path, sizeof(path), src) != ESP_OK) return ESP_ERR_INVALID_SIZE;
+	if (unlink(path) == 0) {
+		ESP_LOGI(TAG, "invalidated %s", path);
+	}
+	if (sidecar_path_ext(path, sizeof(path), src, "vf") == ESP_OK) unlink(path);
+	return ESP_OK;
+}
+
+// ".vf" sidecar: the source size and mtime at the time it was verified
+typedef struct {
+	uint32_t magic;
+	uint32_t src_size;
+	int64_t src_mtime;
+} frame_cache_verified_t;
+
+#define FRAME_CACHE_VERIFIED_MAGIC	0x46565444	// "DTVF"
+
+static esp_err_t make_verified(frame_cache_verified_t *vf, const char *src)
+{
+	struct stat st;
+	if (stat(src, &st) != 0) return ESP_ERR_NOT_FOUND;
+	memset(vf, 0, sizeof(*vf));
+	vf->magic = FRAME_CACHE_VERIFIED_MAGIC;
+	vf->src_size = st.st_size;
+	vf->src_mtime = st.st_mtime;
+	return ESP_OK;
+}
+
+esp_err_t frame_cache_set_verified(const char *src)
+{
+	char path[64];
+	frame_cache_verified_t vf;
+	esp_err_t ret = sidecar_path_ext(path, sizeof(path), src, "vf");
+	if (ret != ESP_OK) return ret;
+	ret = make_verified(&vf, src);
+	if (ret != ESP_OK) return ret;
+
+	FILE *fp = fopen(path, "wb");
+	if (!fp) return ESP_FAIL;
+	bool ok = fwrite(&vf, sizeof(vf), 1, fp) == 1;
+	if (fclose(fp) != 0) ok = false;
+	if (!ok) {
+		unlink(path);
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+bool frame_cache_is_verified(const char *src)
+{
+	char path[64];
+	frame_cache_verified_t want, vf;
+	if (sidecar_path_ext(path, sizeof(path), src, "vf") != ESP_OK) return false;
+	if (make_verified(&want, src) != ESP_OK) return false;
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return false;
+	bool ok = fread(&vf, sizeof(vf), 1, fp) == 1 && memcmp(&vf, &want, sizeof(vf)) == 0;
+	fclose(fp);
+	return ok;
+}
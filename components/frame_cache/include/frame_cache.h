@@ -0,0 +1,99 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+ * Decoded-frame cache.
+ *
+ * The final RGB565 frame of an image is stored in a sidecar file next to the
+ * source (".<hash>.fc" in the same directory). The sidecar is keyed by the
+ * source size and mtime plus the screen geometry, MADCTL rotation, background
+ * color and the caller's decoder revision, so a stale or foreign entry is
+ * simply reported as a miss.
+ *
+ * A second sidecar (".<hash>.vf") records that the source passed an integrity
+ * check when it was stored, so decoders may skip their own checksums. It is
+ * keyed by size and mtime the same way.
+ */
+
+typedef struct {
+	uint16_t screenWidth;
+	uint16_t screenHeight;
+	uint8_t rotation;		// MADCTL value the frame was rendered for
+	uint32_t background;	// 0xRRGGBB transparent pixels were composited onto
+	uint16_t revision;		// caller's decoder revision, bumped when the rendered pixels change
+} frame_cache_geom_t;
+
+typedef struct {
+	FILE *fp;
+	char path[64];			// sidecar path
+	uint16_t x;				// image rectangle on the screen
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint16_t rows;			// rows read or written so far
+} frame_cache_t;
+
+/**
+ * @brief Look up the cached frame of ``src``.
+ *
+ * @return - ESP_OK on hit; ``fc`` holds the image rectangle and is ready for frame_cache_read_row()
+ *         - ESP_ERR_NOT_FOUND if there is no valid entry for the current source and geometry
+ */
+esp_err_t frame_cache_open(frame_cache_t *fc, const char *src, const frame_cache_geom_t *geom);
+
+/**
+ * @brief Read the next row of ``fc->width`` pixels.
+ */
+esp_err_t frame_cache_read_row(frame_cache_t *fc, uint16_t *row);
+
+/**
+ * @brief Close a cache entry opened by frame_cache_open().
+ */
+void frame_cache_close(frame_cache_t *fc);
+
+/**
+ * @brief Start writing the cached frame of ``src``. The image covers the
+ *        rectangle (x, y, width, height) of the screen.
+ */
+esp_err_t frame_cache_create(frame_cache_t *fc, const char *src, const frame_cache_geom_t *geom,
+                             uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+/**
+ * @brief Append the next row of ``fc->width`` pixels.
+ */
+esp_err_t frame_cache_write_row(frame_cache_t *fc, const uint16_t *row);
+
+/**
+ * @brief Finish the entry. It only becomes visible to frame_cache_open() after
+ *        every row has been written.
+ */
+esp_err_t frame_cache_commit(frame_cache_t *fc);
+
+/**
+ * @brief Drop an unfinished entry.
+ */
+void frame_cache_abort(frame_cache_t *fc);
+
+/**
+ * @brief Delete the cached frame of ``src`` and its verified record, if any.
+ */
+esp_err_t frame_cache_invalidate(const char *src);
+
+/**
+ * @brief Record that ``src``, as it is on storage now, passed an integrity check.
+ *        frame_cache_invalidate() drops the record.
+ */
+esp_err_t frame_cache_set_verified(const char *src);
+
+/**
+ * @brief true if ``src`` was recorded by frame_cache_set_verified() and has not changed since.
+ */
+bool frame_cache_is_verified(const char *src);
+
+/**
+ * @brief true if ``name`` (without directory) is a cache sidecar.
+ */
+bool frame_cache_is_sidecar(const char *name);
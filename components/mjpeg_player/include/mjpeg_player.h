@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "st7789.h"
+
+/*
+ * Motion JPEG playback from storage.
+ *
+ * Supported containers:
+ *   - AVI with MJPEG video ("##dc"/"##db" chunks in the movi list)
+ *   - concatenated baseline JPEG frames (.mjpg/.mjpeg, e.g. ffmpeg -f mjpeg)
+ * The container is told apart by the RIFF header, not by the file name.
+ *
+ * Frames are decoded band by band with decode_jpeg_stream() and sent to the
+ * panel as they come out of the decoder, so no frame buffer is needed.
+ */
+
+#define MJPEG_DEFAULT_FPS	15
+
+typedef struct {
+	uint32_t frames;		// frames shown
+	uint32_t dropped;		// frames skipped because decode fell behind
+	float fps;				// achieved over the last report period
+	float decode_ms;		// average per frame over the last report period
+	float transmit_ms;		// average per frame over the last report period
+} mjpeg_stats_t;
+
+typedef struct {
+	int screenWidth;
+	int screenHeight;
+	int fps;				// target rate, 0 = from the AVI header (MJPEG_DEFAULT_FPS for raw streams)
+	int scale;				// 0..3 for 1/1..1/8, -1 = fit the first frame to the screen
+	bool loop;				// restart at the end of the file
+	bool (*stop)(void *arg);	// polled after every frame, return true to stop
+	void *stop_arg;
+} mjpeg_config_t;
+
+/**
+ * @brief Play a video until its end (or until cfg->stop returns true if cfg->loop).
+ *
+ * Output is paced to the target rate with esp_timer. A frame that is more
+ * than one period late is skipped without decoding.
+ *
+ * @param stats Totals and the last report period (may be NULL)
+ * @return - ESP_ERR_NOT_FOUND if the file cannot be opened or has no frames
+ *         - ESP_ERR_NOT_SUPPORTED if no frame could be decoded
+ *         - ESP_OK otherwise
+ */
+esp_err_t mjpeg_play(TFT_t *dev, const char *file, const mjpeg_config_t *cfg, mjpeg_stats_t *stats);
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "decode_jpeg.h"
+#include "mjpeg_player.h"
+
+#define TAG "MJPEG"
+
+#define REPORT_PERIOD_US	1000000
+
+typedef struct {
+	FILE *fp;
+	bool avi;
+	long start;				// first frame: movi list data or start of file
+	long end;
+	long pos;				// where to look for the next frame
+	uint32_t usPerFrame;	// from the AVI main header, 0 if unknown
+} mjpeg_src_t;
+
+typedef struct {
+	TFT_t *dev;
+	int64_t transmit_us;	// spent in lcdDrawMultiPixels for the current frame
+} mjpeg_out_t;
+
+static uint32_t get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Walk the RIFF tree down to the movi list. Every LIST other than movi
+// (hdrl, strl, INFO) is entered, plain chunks are skipped.
+static esp_err_t avi_open(mjpeg_src_t *src)
+{
+	uint8_t hdr[12];
+	long pos = 12;
+	while (pos + 8 <= src->end) {
+		if (fseek(src->fp, pos, SEEK_SET) != 0 || fread(hdr, 1, 12, src->fp) < 8) break;
+		uint32_t size = get32(&hdr[4]);
+		if (memcmp(hdr, "LIST", 4) == 0) {
+			if (memcmp(&hdr[8], "movi", 4) == 0) {
+				src->start = pos + 12;
+				src->end = pos + 8 + size;
+				return ESP_OK;
+			}
+			pos += 12;
+			continue;
+		}
+		if (memcmp(hdr, "avih", 4) == 0) {
+			src->usPerFrame = get32(&hdr[8]);	// dwMicroSecPerFrame
+		}
+		pos += 8 + size + (size & 1);
+	}
+	return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t src_open(mjpeg_src_t *src, const char *file)
+{
+	uint8_t hdr[12];
+	memset(src, 0, sizeof(*src));
+	src->fp = fopen(file, "rb");
+	if (!src->fp) return ESP_ERR_NOT_FOUND;
+
+	fseek(src->fp, 0, SEEK_END);
+	src->end = ftell(src->fp);
+	fseek(src->fp, 0, SEEK_SET);
+	src->avi = fread(hdr, 1, sizeof(hdr), src->fp) == sizeof(hdr) &&
+	           memcmp(hdr, "RIFF", 4) == 0 && memcmp(&hdr[8], "AVI ", 4) == 0;
+	if (src->avi && avi_open(src) != ESP_OK) {
+		ESP_LOGW(TAG, "no movi list in %s", file);
+		fclose(src->fp);
+		return ESP_ERR_NOT_FOUND;
+	}
+	src->pos = src->start;
+	return ESP_OK;
+}
+
+// Next "##dc"/"##db" chunk. LIST rec groups are entered, audio and JUNK skipped.
+static esp_err_t avi_next(mjpeg_src_t *src, long *offset, size_t *length)
+{
+	uint8_t hdr[8];
+	while (src->pos + 8 <= src->end) {
+		if (fseek(src->fp, src->pos, SEEK_SET) != 0 || fread(hdr, 1, 8, src->fp) != 8) break;
+		uint32_t size = get32(&hdr[4]);
+		if (memcmp(hdr, "LIST", 4) == 0) {
+			src->pos += 12;
+			continue;
+		}
+		long data = src->pos + 8;
+		src->pos = data + size + (size & 1);
+		if (hdr[2] == 'd' && (hdr[3] == 'c' || hdr[3] == 'b') && size > 0) {
+			*offset = data;
+			*length = size;
+			return ESP_OK;
+		}
+	}
+	return ESP_ERR_NOT_FOUND;
+}
+
+// Next SOI..EOI in a raw stream: skip marker segments by their length up to
+// SOS (so thumbnails in APPn do not confuse us), then look for EOI in the
+// entropy-coded data, where 0xFF is always stuffed.
+static esp_err_t raw_next(mjpeg_src_t *src, long *offset, size_t *length)
+{
+	FILE *fp = src->fp;
+	int c, prev = 0;
+	if (fseek(fp, src->pos, SEEK_SET) != 0) return ESP_ERR_NOT_FOUND;
+
+	while ((c = getc(fp)) != EOF) {
+		if (prev == 0xFF && c == 0xD8) break;
+		prev = c;
+	}
+	if (c == EOF) return ESP_ERR_NOT_FOUND;
+	*offset = ftell(fp) - 2;
+
+	while (1) {
+		if (getc(fp) != 0xFF) return ESP_ERR_NOT_FOUND;
+		int marker;
+		while ((marker = getc(fp)) == 0xFF);
+		if (marker == EOF || marker == 0xD9) return ESP_ERR_NOT_FOUND;
+		int hi = getc(fp);
+		int lo = getc(fp);
+		if (lo == EOF) return ESP_ERR_NOT_FOUND;
+		fseek(fp, ((hi << 8) | lo) - 2, SEEK_CUR);
+		if (marker == 0xDA) break;
+	}
+
+	prev = 0;
+	while ((c = getc(fp)) != EOF) {
+		if (prev == 0xFF && c == 0xD9) break;
+		prev = c;
+	}
+	src->pos = ftell(fp);
+	*length = src->pos - *offset;
+	return ESP_OK;
+}
+
+static esp_err_t src_next(mjpeg_src_t *src, long *offset, size_t *length)
+{
+	return src->avi ? avi_next(src, offset, length) : raw_next(src, offset, length);
+}
+
+static bool band_cb(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band)
+{
+	mjpeg_out_t *out = js->arg;
+	int x = (js->screenWidth - js->bandWidth) / 2;
+	int y = js->imageHeight < js->screenHeight ? (js->screenHeight - js->imageHeight) / 2 : 0;
+
+	int64_t start = esp_timer_get_time();
+	for (int i = 0; i < height; i++) {
+		lcdDrawMultiPixels(out->dev, x, y + top + i, js->bandWidth,
+		                   (uint16_t *)&band[i * js->bandWidth]);
+	}
+	out->transmit_us += esp_timer_get_time() - start;
+	return true;
+}
+
+esp_err_t mjpeg_play(TFT_t *dev, const char *file, const mjpeg_config_t *cfg, mjpeg_stats_t *stats)
+{
+	mjpeg_src_t src;
+	mjpeg_stats_t local;
+	if (!stats) stats = &local;
+	memset(stats, 0, sizeof(*stats));
+
+	esp_err_t ret = src_open(&src, file);
+	if (ret != ESP_OK) return ret;
+
+	int64_t period = cfg->fps > 0 ? 1000000 / cfg->fps :
+	                 src.usPerFrame ? src.usPerFrame : 1000000 / MJPEG_DEFAULT_FPS;
+	ESP_LOGI(TAG, "%s: %s, %"PRId64" us/frame", file, src.avi ? "AVI" : "raw MJPEG", period);
+
+	// scale -1 is resolved on the first frame and then kept for the whole clip
+	mjpeg_out_t out = { .dev = dev };
+	jpeg_stream_t js = {
+		.fp = src.fp,
+		.scale = cfg->scale,
+		.screenWidth = cfg->screenWidth,
+		.screenHeight = cfg->screenHeight,
+		.band_cb = band_cb,
+		.arg = &out,
+	};
+
+	lcdFillScreen(dev, BLACK);
+
+	int64_t t0 = esp_timer_get_time();
+	int64_t reportStart = t0;
+	int64_t decodeSum = 0, transmitSum = 0;
+	uint32_t frameNo = 0, reportFrames = 0, passFrames = 0;
+
+	while (!(cfg->stop && cfg->stop(cfg->stop_arg))) {
+		size_t length;
+		if (src_next(&src, &js.offset, &length) != ESP_OK) {
+			if (!cfg->loop || passFrames == 0) break;
+			src.pos = src.start;
+			passFrames = 0;
+			continue;
+		}
+		js.length = length;
+		passFrames++;
+
+		// Frame frameNo is due at t0 + frameNo * period. More than one period
+		// late: skip it without decoding to catch up.
+		int64_t due = t0 + (int64_t)frameNo++ * period;
+		int64_t now = esp_timer_get_time();
+		if (now > due + period) {
+			stats->dropped++;
+			continue;
+		}
+		if (now < due) {
+			TickType_t ticks = pdMS_TO_TICKS((due - now) / 1000);
+			if (ticks > 0) vTaskDelay(ticks);
+		}
+
+		out.transmit_us = 0;
+		int64_t start = esp_timer_get_time();
+		esp_err_t err = decode_jpeg_stream(&js);
+		int64_t total = esp_timer_get_time() - start;
+		lcdDrawFinish(dev);
+		if (err != ESP_OK) {
+			ESP_LOGW(TAG, "frame %"PRIu32" at %ld: %s", frameNo - 1, js.offset, esp_err_to_name(err));
+			continue;
+		}
+		stats->frames++;
+		reportFrames++;
+		decodeSum += total - out.transmit_us;
+		transmitSum += out.transmit_us;
+
+		now = esp_timer_get_time();
+		if (now - reportStart >= REPORT_PERIOD_US) {
+			stats->fps = reportFrames * 1000000.0f / (now - reportStart);
+			stats->decode_ms = decodeSum / 1000.0f / reportFrames;
+			stats->transmit_ms = transmitSum / 1000.0f / reportFrames;
+			ESP_LOGI(TAG, "%.1f fps, decode %.1f ms, transmit %.1f ms, %"PRIu32" shown, %"PRIu32" dropped",
+			         stats->fps, stats->decode_ms, stats->transmit_ms, stats->frames, stats->dropped);
+			reportStart = now;
+			reportFrames = 0;
+			decodeSum = transmitSum = 0;
+		}
+	}
+
+	fclose(src.fp);
+	if (stats->frames == 0) {
+		return frameNo == 0 ? ESP_ERR_NOT_FOUND : ESP_ERR_NOT_SUPPORTED;
+	}
+	return ESP_OK;
+}
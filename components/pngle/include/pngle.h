@@ -97,6 +97,15 @@ typedef void (*pngle_init_callback_t)(pngle_t *pngle, uint32_t w, uint32_t h);
 typedef void (*pngle_draw_callback_t)(pngle_t *pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t rgba[4]);
 typedef void (*pngle_done_callback_t)(pngle_t *pngle);
 
+// Row output: one reconstructed scanline per call instead of one pixel per draw callback.
+// `pixels` holds `n` pixels for columns x, x + step, x + 2 * step, ... of row y
+// (step > 1 only for Adam7 pass rows). Valid until the callback returns.
+typedef enum {
+	PNGLE_ROW_RGB565,	// uint16_t per pixel, alpha dropped
+	PNGLE_ROW_RGBA8888,	// uint8_t r, g, b, a per pixel
+} pngle_row_format_t;
+typedef void (*pngle_row_callback_t)(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels);
+
 struct pngle {
 	pngle_ihdr_t hdr;
 
@@ -110,11 +119,18 @@ struct pngle {
 	size_t n_trans_palettes;
 	uint8_t *trans_palette;
 
+	// palette lookup (built at the first IDAT): 256 x RGBA8888 then 256 x RGB565, gamma folded in
+	uint8_t *palette_rgba;
+	uint16_t *palette_rgb565;
+
 	// parser state (reset on every chunk header)
 	pngle_state_t state;
 	uint32_t chunk_type;
 	uint32_t chunk_remain;
 	mz_ulong crc32;
+	bool crc_check; // set by pngle_set_crc_check(), survives pngle_reset()
+	bool has_background; // set by pngle_set_background(), survives pngle_reset()
+	uint8_t background[3];
 
 	// decompression state (reset on IHDR)
 	tinfl_decompressor inflator; // 11000 bytes
@@ -123,12 +139,14 @@ struct pngle {
 	size_t  avail_out;
 
 	// scanline decoder (reset on every set_interlace_pass() call)
-	uint8_t *scanline_ringbuf;
-	size_t scanline_ringbuf_size;
-	size_t scanline_ringbuf_cidx;
-	int_fast8_t scanline_remain_bytes_to_render;
+	// row_buf holds the unpacked pixels, then the previous and current raw rows (see pngle_filter.h)
+	uint8_t *row_buf;
+	uint8_t *row_prev;
+	uint8_t *row_cur;
+	size_t row_stride;
+	size_t row_bytes;
+	uint32_t row_pixels;
 	int_fast8_t filter_type;
-	uint32_t drawing_x;
 	uint32_t drawing_y;
 
 	// interlace
@@ -144,13 +162,16 @@ struct pngle {
 	pngle_init_callback_t init_callback;
 	pngle_draw_callback_t draw_callback;
 	pngle_done_callback_t done_callback;
+	pngle_row_callback_t row_callback;
+	pngle_row_format_t row_format;
 
 	void *user_data;
 	uint16_t screenWidth;
 	uint16_t screenHeight;
 	uint16_t imageWidth;
 	uint16_t imageHeight;
-	pixel_png **pixels;
+	pixel_png **pixels;		// NULL until pngle_alloc_pixels(), see pngle_new_unbuffered()
+	uint16_t pixelRows;
 	bool reduction;
 	double scale_factor;
 };
@@ -159,7 +180,10 @@ struct pngle {
 // ----------------
 // Basic interfaces
 // ----------------
-pngle_t *pngle_new(uint16_t width, uint16_t height);
+pngle_t *pngle_new(uint16_t width, uint16_t height); // also allocates pixels[height][width]
+pngle_t *pngle_new_unbuffered(uint16_t width, uint16_t height); // no pixel array, the draw callback consumes pixels itself
+int pngle_alloc_pixels(pngle_t *pngle, uint16_t width, uint16_t height); // lazy pixel array, e.g. from the init callback once the image size is known; returns -1 on failure
+void pngle_free_pixels(pngle_t *pngle);
 void pngle_destroy(pngle_t *pngle, uint16_t width, uint16_t height);
 void pngle_reset(pngle_t *pngle); // clear its internal state (not applied to pngle_set_* functions)
 const char *pngle_error(pngle_t *pngle);
@@ -171,9 +195,14 @@ uint32_t pngle_get_height(pngle_t *pngle);
 void pngle_set_init_callback(pngle_t *png, pngle_init_callback_t callback);
 void pngle_set_draw_callback(pngle_t *png, pngle_draw_callback_t callback);
 void pngle_set_done_callback(pngle_t *png, pngle_done_callback_t callback);
+void pngle_set_row_callback(pngle_t *png, pngle_row_callback_t callback, pngle_row_format_t format); // replaces the draw callback while set
 
 void pngle_set_display_gamma(pngle_t *pngle, double display_gamma); // enables gamma correction by specifying display gamma, typically 2.2. No effect when gAMA chunk is missing
 
+void pngle_set_crc_check(pngle_t *pngle, bool enable); // on by default; turn off for sources whose integrity was verified elsewhere (e.g. at upload)
+
+void pngle_set_background(pngle_t *pngle, uint8_t r, uint8_t g, uint8_t b); // PNGLE_ROW_RGB565 rows are composited onto this color instead of dropping alpha; RGBA8888 rows and draw callbacks keep alpha
+
 void pngle_set_user_data(pngle_t *pngle, void *user_data);
 void *pngle_get_user_data(pngle_t *pngle);
 
@@ -31,12 +31,22 @@
 #include "esp_log.h"
 #include "miniz.h"
 #include "pngle.h"
+#include "pngle_filter.h"
+#include "decode_arena.h"
 
 #define PNGLE_ERROR(s) (pngle->error = (s), pngle->state = PNGLE_STATE_ERROR, -1)
 #define PNGLE_CALLOC(a, b, name) (debug_printf("[pngle] Allocating %zu bytes for %s\n", (size_t)(a) * (size_t)(b), (name)), calloc((size_t)(a), (size_t)(b)))
 
 #define PNGLE_UNUSED(x) (void)(x)
 
+#ifdef ESP_PLATFORM
+#include "esp_rom_crc.h"
+// ROM CRC-32: same polynomial and pre/post inversion as miniz, no lookup table in RAM
+#define PNGLE_CRC32(crc, buf, len) esp_rom_crc32_le((crc), (const uint8_t *)(buf), (len))
+#else
+#define PNGLE_CRC32(crc, buf, len) mz_crc32((crc), (const mz_uint8 *)(buf), (len))
+#endif
+
 // magic
 static const uint8_t png_sig[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
 static uint32_t interlace_off_x[8] = { 0,  0, 4, 0, 2, 0, 1, 0 };
@@ -75,16 +85,19 @@ void pngle_reset(pngle_t *pngle)
 	pngle->state = PNGLE_STATE_INITIAL;
 	pngle->error = "No error";
 
-	if (pngle->scanline_ringbuf) free(pngle->scanline_ringbuf);
+	if (pngle->row_buf) free(pngle->row_buf);
 	if (pngle->palette) free(pngle->palette);
 	if (pngle->trans_palette) free(pngle->trans_palette);
+	if (pngle->palette_rgba) free(pngle->palette_rgba);
 #ifndef PNGLE_NO_GAMMA_CORRECTION
 	if (pngle->gamma_table) free(pngle->gamma_table);
 #endif
 
-	pngle->scanline_ringbuf = NULL;
+	pngle->row_buf = NULL;
 	pngle->palette = NULL;
 	pngle->trans_palette = NULL;
+	pngle->palette_rgba = NULL;
+	pngle->palette_rgb565 = NULL;
 #ifndef PNGLE_NO_GAMMA_CORRECTION
 	pngle->gamma_table = NULL;
 #endif
@@ -100,59 +113,77 @@ void pngle_reset(pngle_t *pngle)
 	tinfl_init(&pngle->inflator);
 }
 
-pngle_t *pngle_new(uint16_t width, uint16_t height)
+pngle_t *pngle_new_unbuffered(uint16_t width, uint16_t height)
 {
-	pngle_t *pngle = (pngle_t *)PNGLE_CALLOC(1, sizeof(pngle_t), "pngle_t");
+	// inflate state + 32KB LZ window: borrowed from the decoder arena instead of a fresh calloc per image
+	pngle_t *pngle = (pngle_t *)decode_arena_calloc(sizeof(pngle_t), "pngle_t");
 	if (!pngle) return NULL;
 
 	pngle_reset(pngle);
 
 	pngle->pixels = NULL;
+	pngle->pixelRows = 0;
+	pngle->crc_check = true;
+	pngle->screenWidth = width;
+	pngle->screenHeight = height;
+	return pngle;
+}
 
-	//Alocate pixel memory. Each line is an array of IMAGE_W 16-bit pixels; the `*pixels` array itself contains pointers to these lines.
-	ESP_LOGD(__FUNCTION__, "height=%d sizeof(pixel_png *)=%d", height, sizeof(pixel_png *));
+int pngle_alloc_pixels(pngle_t *pngle, uint16_t width, uint16_t height)
+{
+	if (!pngle || pngle->pixels) return -1;
+
+	//Alocate pixel memory. Each line is an array of `width` 16-bit pixels; the `*pixels` array itself contains pointers to these lines.
+	ESP_LOGD(__FUNCTION__, "height=%d sizeof(pixel_png *)=%d", height, (int)sizeof(pixel_png *));
 	pngle->pixels = calloc(height, sizeof(pixel_png *));
 	if (pngle->pixels == NULL) {
 		ESP_LOGE(__FUNCTION__, "Error allocating memory for lines");
-		//ret = ESP_ERR_NO_MEM;
-		goto err;
+		return -1;
 	}
-	ESP_LOGD(__FUNCTION__, "width=%d sizeof(pixel_png)=%d", width, sizeof(pixel_png));
+	pngle->pixelRows = height;
+	ESP_LOGD(__FUNCTION__, "width=%d sizeof(pixel_png)=%d", width, (int)sizeof(pixel_png));
 	for (int i = 0; i < height; i++) {
-		(pngle->pixels)[i] = malloc(width * sizeof(pixel_png));
+		(pngle->pixels)[i] = calloc(width, sizeof(pixel_png)); // black, the layer transparent pixels composite onto
 		if ((pngle->pixels)[i] == NULL) {
 			ESP_LOGE(__FUNCTION__, "Error allocating memory for line %d", i);
-			//ret = ESP_ERR_NO_MEM;
-			goto err;
+			pngle_free_pixels(pngle);
+			return -1;
 		}
 	}
+	return 0;
+}
 
-	pngle->screenWidth = width;
-	pngle->screenHeight = height;
-	return pngle;
+void pngle_free_pixels(pngle_t *pngle)
+{
+	if (!pngle || pngle->pixels == NULL) return;
+	for (int i = 0; i < pngle->pixelRows; i++) {
+		free((pngle->pixels)[i]);
+	}
+	free(pngle->pixels);
+	pngle->pixels = NULL;
+	pngle->pixelRows = 0;
+}
 
-	err:
-	//Something went wrong! Exit cleanly, de-allocating everything we allocated.
-	if (pngle->pixels != NULL) {
-		for (int i = 0; i < height; i++) {
-			if ((pngle->pixels)[i]) free((pngle->pixels)[i]);
-		}
-		free(pngle->pixels);
+pngle_t *pngle_new(uint16_t width, uint16_t height)
+{
+	pngle_t *pngle = pngle_new_unbuffered(width, height);
+	if (!pngle) return NULL;
+
+	if (pngle_alloc_pixels(pngle, width, height) < 0) {
+		//Something went wrong! Exit cleanly, de-allocating everything we allocated.
+		decode_arena_free(pngle);
+		return NULL;
 	}
-	return NULL;
+	return pngle;
 }
 
 void pngle_destroy(pngle_t *pngle, uint16_t width, uint16_t height)
 {
 	if (pngle) {
-		if (pngle->pixels != NULL) {
-			for (int i = 0; i < height; i++) {
-				free((pngle->pixels)[i]);
-			}
-			free(pngle->pixels);
-		}
+		// rows are freed by the count pngle_alloc_pixels() recorded, width/height are kept for old callers
+		pngle_free_pixels(pngle);
 		pngle_reset(pngle);
-		free(pngle);
+		decode_arena_free(pngle);
 	}
 }
 
@@ -192,151 +223,209 @@ static int is_trans_color(pngle_t *pngle, uint16_t *value, size_t n)
 	return 1; // true
 }
 
-static inline void scanline_ringbuf_push(pngle_t *pngle, uint8_t value)
-{
-	pngle->scanline_ringbuf[pngle->scanline_ringbuf_cidx] = value;
-	pngle->scanline_ringbuf_cidx = (pngle->scanline_ringbuf_cidx + 1) % pngle->scanline_ringbuf_size;
-}
-
-static inline uint16_t get_value(pngle_t *pngle, size_t *ridx, int *bitcount, int depth)
+static inline uint16_t row_get_value(const uint8_t *raw, size_t *bit, int depth)
 {
-	uint16_t v;
-
-	switch (depth) {
-	case 1:
-	case 2:
-	case 4:
-		if (*bitcount >= 8) {
-			*bitcount = 0;
-			*ridx = (*ridx + 1) % pngle->scanline_ringbuf_size;
-		}
-		*bitcount += depth;
-		uint8_t mask = ((1UL << depth) - 1);
-		uint8_t shift = (8 - *bitcount);
-		return (pngle->scanline_ringbuf[*ridx] >> shift) & mask;
-
-	case 8:
-		v = pngle->scanline_ringbuf[*ridx];
-		*ridx = (*ridx + 1) % pngle->scanline_ringbuf_size;
-		return v;
-
-	case 16:
-		v = pngle->scanline_ringbuf[*ridx];
-		*ridx = (*ridx + 1) % pngle->scanline_ringbuf_size;
-
-		v = v * 0x100 + pngle->scanline_ringbuf[*ridx];
-		*ridx = (*ridx + 1) % pngle->scanline_ringbuf_size;
-		return v;
-	}
-
-	return 0;
+	size_t i = *bit >> 3;
+	*bit += depth;
+	if (depth == 16) return raw[i] * 0x100 + raw[i + 1];
+	if (depth == 8) return raw[i];
+	return (raw[i] >> (8 - depth - ((*bit - depth) & 7))) & ((1U << depth) - 1);
 }
 
-static int pngle_draw_pixels(pngle_t *pngle, size_t scanline_ringbuf_xidx)
+// Any color type and depth, one sample at a time
+static int row_unpack_generic(pngle_t *pngle, const uint8_t *raw, uint8_t *out, uint32_t n)
 {
 	uint16_t v[4]; // MAX_CHANNELS
-	int bitcount = 0;
+	size_t bit = 0;
 	uint8_t pixel_depth = (pngle->hdr.color_type & 1) ? 8 : pngle->hdr.depth;
 	uint16_t maxval = (1UL << pixel_depth) - 1;
 
-	int n_pixels = pngle->hdr.depth == 16 ? 1 : (8 / pngle->hdr.depth);
-
-	for (; n_pixels-- > 0 && pngle->drawing_x < pngle->hdr.width; pngle->drawing_x = U32_CLAMP_ADD(pngle->drawing_x, interlace_div_x[pngle->interlace_pass], pngle->hdr.width)) {
+	for (uint32_t i = 0; i < n; i++, out += 4) {
 		for (uint_fast8_t c = 0; c < pngle->channels; c++) {
-			v[c] = get_value(pngle, &scanline_ringbuf_xidx, &bitcount, pngle->hdr.depth);
+			v[c] = row_get_value(raw, &bit, pngle->hdr.depth);
 		}
 
-		// color type: 0000 0111
-		//                     ^-- indexed color (palette)
-		//                    ^--- Color
-		//                   ^---- Alpha channel
-
 		if (pngle->hdr.color_type & 2) {
-			// color
 			if (pngle->hdr.color_type & 1) {
-				// indexed color: type 3
-
-				// lookup palette info
 				uint16_t pidx = v[0];
 				if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
-
 				v[0] = pngle->palette[pidx * 3 + 0];
 				v[1] = pngle->palette[pidx * 3 + 1];
 				v[2] = pngle->palette[pidx * 3 + 2];
-
-				// tRNS as an indexed alpha value table (for color type 3)
 				v[3] = pidx < pngle->n_trans_palettes ? pngle->trans_palette[pidx] : maxval;
 			} else {
-				// true color: 2, and 6
 				v[3] = (pngle->hdr.color_type & 4) ? v[3] : is_trans_color(pngle, v, 3) ? 0 : maxval;
 			}
 		} else {
-			// alpha, tRNS, or opaque
 			v[3] = (pngle->hdr.color_type & 4) ? v[1] : is_trans_color(pngle, v, 1) ? 0 : maxval;
-
-			// monochrome
 			v[1] = v[2] = v[0];
 		}
 
-		if (pngle->draw_callback) {
-			uint8_t rgba[4] = {
-				(v[0] * 255 + maxval / 2) / maxval,
-				(v[1] * 255 + maxval / 2) / maxval,
-				(v[2] * 255 + maxval / 2) / maxval,
-				(v[3] * 255 + maxval / 2) / maxval
-			};
-
+		for (int c = 0; c < 4; c++) {
+			out[c] = (v[c] * 255 + maxval / 2) / maxval;
+		}
 #ifndef PNGLE_NO_GAMMA_CORRECTION
-			if (pngle->gamma_table) {
-				for (int i = 0; i < 3; i++) {
-					rgba[i] = pngle->gamma_table[v[i]];
-				}
+		if (pngle->gamma_table) {
+			for (int c = 0; c < 3; c++) {
+				out[c] = pngle->gamma_table[v[c]];
 			}
+		}
 #endif
+	}
+	return 0;
+}
 
-			pngle->draw_callback(pngle, pngle->drawing_x, pngle->drawing_y
-				, MIN(interlace_div_x[pngle->interlace_pass] - interlace_off_x[pngle->interlace_pass], pngle->hdr.width  - pngle->drawing_x)
-				, MIN(interlace_div_y[pngle->interlace_pass] - interlace_off_y[pngle->interlace_pass], pngle->hdr.height - pngle->drawing_y)
-				, rgba
-			);
+// Palette indices of a row as bytes: the raw row itself at 8 bits, otherwise expanded into
+// the last quarter of `out`, where pixel i (4 bytes, or 2 for RGB565) is written only after
+// index i has been read.
+static const uint8_t *row_palette_indices(pngle_t *pngle, const uint8_t *raw, uint8_t *out, uint32_t n)
+{
+	if (pngle->hdr.depth == 8) return raw;
+	pngle_unpack_bits(out + n * 3, raw, n, pngle->hdr.depth);
+	return out + n * 3;
+}
+
+// Unpack one raw scanline into RGBA8888. 8-bit truecolor and gray rows and palette rows
+// take straight loops; 16-bit, sub-byte gray and single-color tRNS go through the generic path.
+static int row_unpack(pngle_t *pngle, const uint8_t *raw, uint8_t *out, uint32_t n)
+{
+	const uint8_t *gamma = NULL;
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+	gamma = pngle->gamma_table;
+#endif
+	uint8_t ct = pngle->hdr.color_type;
+
+	if (pngle->hdr.depth != 8 && ct != 3) return row_unpack_generic(pngle, raw, out, n);
+	if ((ct == 0 || ct == 2) && pngle->n_trans_palettes == 1) return row_unpack_generic(pngle, raw, out, n);
+
+	switch (ct) {
+	case 2: // RGB
+		for (uint32_t i = 0; i < n; i++, raw += 3, out += 4) {
+			out[0] = raw[0]; out[1] = raw[1]; out[2] = raw[2]; out[3] = 255;
+		}
+		break;
+	case 6: // RGBA
+		memcpy(out, raw, n * 4);
+		out += n * 4;
+		break;
+	case 0: // gray
+		for (uint32_t i = 0; i < n; i++, raw++, out += 4) {
+			out[0] = out[1] = out[2] = raw[0]; out[3] = 255;
 		}
+		break;
+	case 4: // gray + alpha
+		for (uint32_t i = 0; i < n; i++, raw += 2, out += 4) {
+			out[0] = out[1] = out[2] = raw[0]; out[3] = raw[1];
+		}
+		break;
+	case 3: { // palette, 1/2/4/8 bits per index: one table lookup per pixel, gamma already applied
+		const uint8_t *idx = row_palette_indices(pngle, raw, out, n);
+		for (uint32_t i = 0; i < n; i++, out += 4) {
+			uint8_t pidx = idx[i];
+			if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
+			memcpy(out, pngle->palette_rgba + pidx * 4, 4);
+		}
+		return 0;
+	}
 	}
 
+	if (gamma) {
+		out -= n * 4;
+		for (uint32_t i = 0; i < n; i++, out += 4) {
+			out[0] = gamma[out[0]]; out[1] = gamma[out[1]]; out[2] = gamma[out[2]];
+		}
+	}
 	return 0;
 }
 
-static inline int paeth(int a, int b, int c)
+// Palette rows and 8-bit RGB/RGBA straight to RGB565, skipping the RGBA8888 step
+// (RGB/RGBA only without gamma and tRNS color). Returns 1 if done, 0 if not applicable.
+static int row_pack_rgb565(pngle_t *pngle, const uint8_t *raw, uint16_t *dst, uint32_t n)
+{
+	uint8_t ct = pngle->hdr.color_type;
+	if (ct == 3) {
+		const uint8_t *idx = row_palette_indices(pngle, raw, (uint8_t *)dst, n);
+		for (uint32_t i = 0; i < n; i++) {
+			uint8_t pidx = idx[i];
+			if (pidx >= pngle->n_palettes) return PNGLE_ERROR("Color index is out of range");
+			dst[i] = pngle->palette_rgb565[pidx];
+		}
+		return 1;
+	}
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+	if (pngle->gamma_table) return 0;
+#endif
+	if (pngle->hdr.depth != 8 || (ct != 2 && ct != 6) || pngle->n_trans_palettes == 1) return 0;
+	if (ct == 6 && pngle->has_background) return 0; // composited by pngle_rgba_blend_rgb565()
+
+	int step = pngle->channels;
+	for (uint32_t i = 0; i < n; i++, raw += step) {
+		dst[i] = ((raw[0] & 0xF8) << 8) | ((raw[1] & 0xFC) << 3) | (raw[2] >> 3);
+	}
+	return 1;
+}
+
+static int pngle_draw_row(pngle_t *pngle)
 {
-	int p = a + b - c;
-	int pa = abs(p - a);
-	int pb = abs(p - b);
-	int pc = abs(p - c);
+	uint_fast8_t pass = pngle->interlace_pass;
+	const uint8_t *raw = pngle->row_cur;
+	uint32_t n = pngle->row_pixels;
+	uint8_t *out = pngle->row_buf;
+
+	if (pngle->row_callback) {
+		int packed = pngle->row_format == PNGLE_ROW_RGB565 ? row_pack_rgb565(pngle, raw, (uint16_t *)out, n) : 0;
+		if (packed < 0) return -1;
+		if (!packed) {
+			if (row_unpack(pngle, raw, out, n) < 0) return -1;
+			if (pngle->row_format == PNGLE_ROW_RGB565) {
+				if (pngle->has_background) {
+					pngle_rgba_blend_rgb565((uint16_t *)out, out, n, pngle->background);
+				} else {
+					pngle_rgba_to_rgb565((uint16_t *)out, out, n);
+				}
+			}
+		}
+		pngle->row_callback(pngle, pngle->drawing_y, interlace_off_x[pass], interlace_div_x[pass], n, out);
+		return 0;
+	}
+
+	if (!pngle->draw_callback) return 0;
+	if (row_unpack(pngle, raw, out, n) < 0) return -1;
 
-	if (pa <= pb && pa <= pc) return a;
-	if (pb <= pc) return b;
-	return c;
+	uint32_t h = MIN(interlace_div_y[pass] - interlace_off_y[pass], pngle->hdr.height - pngle->drawing_y);
+	uint32_t x = interlace_off_x[pass];
+	for (uint32_t i = 0; i < n; i++, x += interlace_div_x[pass], out += 4) {
+		pngle->draw_callback(pngle, x, pngle->drawing_y
+			, MIN(interlace_div_x[pass] - interlace_off_x[pass], pngle->hdr.width - x)
+			, h
+			, out
+		);
+	}
+	return 0;
 }
 
 static int set_interlace_pass(pngle_t *pngle, uint_fast8_t pass)
 {
 	pngle->interlace_pass = pass;
 
-	uint_fast8_t bytes_per_pixel = (pngle->channels * pngle->hdr.depth + 7) / 8; // 1 if depth <= 8
 	size_t scanline_pixels = (pngle->hdr.width - interlace_off_x[pngle->interlace_pass] + interlace_div_x[pngle->interlace_pass] - 1) / interlace_div_x[pngle->interlace_pass];
 	size_t scanline_stride = (scanline_pixels * pngle->channels * pngle->hdr.depth + 7) / 8;
 
-	pngle->scanline_ringbuf_size = scanline_stride + bytes_per_pixel * 2; // 2 rooms for c/x and a
+	// [unpacked pixels][pad | previous row][pad | current row], each part word aligned
+	size_t out_size = scanline_pixels * 4;
+	size_t raw_size = PNGLE_ROW_PAD + ((scanline_stride + 3) & ~(size_t)3);
 
-	if (pngle->scanline_ringbuf) free(pngle->scanline_ringbuf);
-	if ((pngle->scanline_ringbuf = PNGLE_CALLOC(pngle->scanline_ringbuf_size, 1, "scanline ringbuf")) == NULL) return PNGLE_ERROR("Insufficient memory");
+	if (pngle->row_buf) free(pngle->row_buf);
+	if ((pngle->row_buf = PNGLE_CALLOC(out_size + raw_size * 2, 1, "row buffer")) == NULL) return PNGLE_ERROR("Insufficient memory");
+	pngle->row_prev = pngle->row_buf + out_size + PNGLE_ROW_PAD;
+	pngle->row_cur = pngle->row_prev + raw_size;
+	pngle->row_stride = scanline_stride;
+	pngle->row_pixels = scanline_pixels;
+	pngle->row_bytes = 0;
 
-	pngle->drawing_x = interlace_off_x[pngle->interlace_pass];
 	pngle->drawing_y = interlace_off_y[pngle->interlace_pass];
 	pngle->filter_type = -1;
 
-	pngle->scanline_ringbuf_cidx = 0;
-	pngle->scanline_remain_bytes_to_render = -1;
-
 	return 0;
 }
 
@@ -354,8 +443,10 @@ static int setup_gamma_table(pngle_t *pngle, uint32_t png_gamma)
 	pngle->gamma_table = PNGLE_CALLOC(1, maxval + 1, "gamma table");
 	if (!pngle->gamma_table) return PNGLE_ERROR("Insufficient memory");
 
+	// single precision: the FPU does it in hardware, double is emulated (65536 entries at 16 bits)
+	float exponent = (float)(100000.0 / png_gamma / pngle->display_gamma);
 	for (int i = 0; i < maxval + 1; i++) {
-		pngle->gamma_table[i] = (uint8_t)floor(pow(i / (double)maxval, 100000.0 / png_gamma / pngle->display_gamma) * 255.0 + 0.5);
+		pngle->gamma_table[i] = (uint8_t)(powf(i / (float)maxval, exponent) * 255.0f + 0.5f);
 	}
 	debug_printf("[pngle] gamma value = %d\n", png_gamma);
 #else
@@ -366,6 +457,34 @@ static int setup_gamma_table(pngle_t *pngle, uint32_t png_gamma)
 }
 
 
+// After PLTE, tRNS and gAMA: every palette entry resolved once, so indexed rows
+// need one table lookup per pixel
+static int setup_palette_lut(pngle_t *pngle)
+{
+	if (pngle->palette_rgba) free(pngle->palette_rgba);
+	pngle->palette_rgba = PNGLE_CALLOC(256, 4 + sizeof(uint16_t), "palette lut");
+	if (!pngle->palette_rgba) return PNGLE_ERROR("Insufficient memory");
+	pngle->palette_rgb565 = (uint16_t *)(pngle->palette_rgba + 256 * 4);
+
+	for (size_t i = 0; i < pngle->n_palettes; i++) {
+		uint8_t *e = pngle->palette_rgba + i * 4;
+		memcpy(e, pngle->palette + i * 3, 3);
+#ifndef PNGLE_NO_GAMMA_CORRECTION
+		if (pngle->gamma_table) {
+			for (int c = 0; c < 3; c++) e[c] = pngle->gamma_table[e[c]];
+		}
+#endif
+		e[3] = i < pngle->n_trans_palettes ? pngle->trans_palette[i] : 255;
+		// a background is folded into the RGB565 entries, so indexed rows composite for free
+		if (pngle->has_background) {
+			pngle_rgba_blend_rgb565(pngle->palette_rgb565 + i, e, 1, pngle->background);
+		} else {
+			pngle->palette_rgb565[i] = ((e[0] & 0xF8) << 8) | ((e[1] & 0xFC) << 3) | (e[2] >> 3);
+		}
+	}
+	return 0;
+}
+
 static int pngle_on_data(pngle_t *pngle, const uint8_t *p, int len)
 {
 	const uint8_t *ep = p + len;
@@ -373,14 +492,7 @@ static int pngle_on_data(pngle_t *pngle, const uint8_t *p, int len)
 	uint_fast8_t bytes_per_pixel = (pngle->channels * pngle->hdr.depth + 7) / 8; // 1 if depth <= 8
 
 	while (p < ep) {
-		if (pngle->drawing_x >= pngle->hdr.width) {
-			// New row
-			pngle->drawing_x = interlace_off_x[pngle->interlace_pass];
-			pngle->drawing_y = U32_CLAMP_ADD(pngle->drawing_y, interlace_div_y[pngle->interlace_pass], pngle->hdr.height);
-			pngle->filter_type = -1; // Indicate new line
-		}
-
-		if (pngle->drawing_x >= pngle->hdr.width || pngle->drawing_y >= pngle->hdr.height) {
+		if (pngle->drawing_y >= pngle->hdr.height || interlace_off_x[pngle->interlace_pass] >= pngle->hdr.width) {
 			if (pngle->interlace_pass == 0 || pngle->interlace_pass >= 7) return len; // Do nothing further
 
 			// Interlace: Next pass
@@ -397,51 +509,31 @@ static int pngle_on_data(pngle_t *pngle, const uint8_t *p, int len)
 			}
 
 			pngle->filter_type = (int_fast8_t)*p++; // 0 - 4
-
-			// push sentinel bytes for new line
-			for (uint_fast8_t i = 0; i < bytes_per_pixel; i++) {
-				scanline_ringbuf_push(pngle, 0);
-			}
-
 			continue;
 		}
 
-		size_t cidx =  pngle->scanline_ringbuf_cidx;
-		size_t bidx = (pngle->scanline_ringbuf_cidx                                + bytes_per_pixel) % pngle->scanline_ringbuf_size;
-		size_t aidx = (pngle->scanline_ringbuf_cidx + pngle->scanline_ringbuf_size - bytes_per_pixel) % pngle->scanline_ringbuf_size;
-		// debug_printf("[pngle] cidx = %zd, bidx = %zd, aidx = %zd\n", cidx, bidx, aidx);
-
-		uint8_t c = pngle->scanline_ringbuf[cidx]; // left-up
-		uint8_t b = pngle->scanline_ringbuf[bidx]; // up
-		uint8_t a = pngle->scanline_ringbuf[aidx]; // left
-		uint8_t x = *p++; // target
-		// debug_printf("[pngle] c = 0x%02x, b = 0x%02x, a = 0x%02x, x = 0x%02x\n", c, b, a, x);
-
-		// Reverse the filter
-		switch (pngle->filter_type) {
-		case 0: break; // None
-		case 1: x += a; break; // Sub
-		case 2: x += b; break; // Up
-		case 3: x += (a + b) / 2; break; // Average
-		case 4: x += paeth(a, b, c); break; // Paeth
-		}
-
-		scanline_ringbuf_push(pngle, x); // updates scanline_ringbuf_cidx
-
-		if (pngle->scanline_remain_bytes_to_render < 0) pngle->scanline_remain_bytes_to_render = bytes_per_pixel;
-		if (--pngle->scanline_remain_bytes_to_render == 0) {
-			size_t xidx = (pngle->scanline_ringbuf_cidx + pngle->scanline_ringbuf_size - bytes_per_pixel) % pngle->scanline_ringbuf_size;
-
-			if (pngle_draw_pixels(pngle, xidx) < 0) return -1;
-
-			pngle->scanline_remain_bytes_to_render = -1; // reset
-		}
+		// collect the filtered row, then reverse the filter on all of it at once
+		size_t n = MIN((size_t)(ep - p), pngle->row_stride - pngle->row_bytes);
+		memcpy(pngle->row_cur + pngle->row_bytes, p, n);
+		p += n;
+		pngle->row_bytes += n;
+		if (pngle->row_bytes < pngle->row_stride) continue;
+
+		pngle_unfilter_row(pngle->filter_type, pngle->row_cur, pngle->row_prev, pngle->row_stride, bytes_per_pixel);
+		if (pngle_draw_row(pngle) < 0) return -1;
+
+		// New row
+		uint8_t *t = pngle->row_prev;
+		pngle->row_prev = pngle->row_cur;
+		pngle->row_cur = t;
+		pngle->row_bytes = 0;
+		pngle->drawing_y = U32_CLAMP_ADD(pngle->drawing_y, interlace_div_y[pngle->interlace_pass], pngle->hdr.height);
+		pngle->filter_type = -1; // Indicate new line
 	}
 
 	return len;
 }
 
-
 static int pngle_handle_chunk(pngle_t *pngle, const uint8_t *buf, size_t len)
 {
 	size_t consume = 0;
@@ -643,7 +735,7 @@ static int pngle_feed_internal(pngle_t *pngle, const uint8_t *buf, size_t len)
 		pngle->chunk_remain = read_uint32(buf);
 		pngle->chunk_type = read_uint32(buf + 4);
 
-		pngle->crc32 = mz_crc32(MZ_CRC32_INIT, (const mz_uint8 *)(buf + 4), 4);
+		if (pngle->crc_check) pngle->crc32 = PNGLE_CRC32(MZ_CRC32_INIT, buf + 4, 4);
 
 		debug_printf("[pngle] Chunk '%.4s' len %u\n", buf + 4, pngle->chunk_remain);
 
@@ -663,6 +755,7 @@ static int pngle_feed_internal(pngle_t *pngle, const uint8_t *buf, size_t len)
 
 			if (pngle->next_out == NULL) {
 				// Very first IDAT
+				if (pngle->hdr.color_type == 3 && setup_palette_lut(pngle) < 0) return -1;
 				pngle->next_out = pngle->lz_buf;
 				pngle->avail_out = TINFL_LZ_DICT_SIZE;
 			}
@@ -733,7 +826,7 @@ static int pngle_feed_internal(pngle_t *pngle, const uint8_t *buf, size_t len)
 			if (pngle->chunk_remain < (uint32_t)consumed) return PNGLE_ERROR("Chunk data has been consumed too much");
 
 			pngle->chunk_remain -= consumed;
-			pngle->crc32 = mz_crc32(pngle->crc32, (const mz_uint8 *)buf, consumed);
+			if (pngle->crc_check) pngle->crc32 = PNGLE_CRC32(pngle->crc32, buf, consumed);
 		}
 		if (pngle->chunk_remain <= 0) pngle->state = PNGLE_STATE_CRC;
 
@@ -744,7 +837,7 @@ static int pngle_feed_internal(pngle_t *pngle, const uint8_t *buf, size_t len)
 
 		uint32_t crc32 = read_uint32(buf);
 
-		if (crc32 != pngle->crc32) {
+		if (pngle->crc_check && crc32 != pngle->crc32) {
 			debug_printf("[pngle] CRC: %08x vs %08x => NG\n", crc32, (uint32_t)pngle->crc32);
 			return PNGLE_ERROR("CRC mismatch");
 		}
@@ -814,6 +907,28 @@ void pngle_set_done_callback(pngle_t *pngle, pngle_done_callback_t callback)
 	pngle->done_callback = callback;
 }
 
+void pngle_set_row_callback(pngle_t *pngle, pngle_row_callback_t callback, pngle_row_format_t format)
+{
+	if (!pngle) return ;
+	pngle->row_callback = callback;
+	pngle->row_format = format;
+}
+
+void pngle_set_crc_check(pngle_t *pngle, bool enable)
+{
+	if (!pngle) return ;
+	pngle->crc_check = enable;
+}
+
+void pngle_set_background(pngle_t *pngle, uint8_t r, uint8_t g, uint8_t b)
+{
+	if (!pngle) return ;
+	pngle->has_background = true;
+	pngle->background[0] = r;
+	pngle->background[1] = g;
+	pngle->background[2] = b;
+}
+
 void pngle_set_user_data(pngle_t *pngle, void *user_data)
 {
 	if (!pngle) return ;
@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pngle_filter.h"
+
+// Byte-lane arithmetic on 32-bit words: four bytes per operation, no carries
+// between lanes. ESP32-S3 PIE only has saturating byte adds, while PNG filters
+// need them modulo 256, so plain word operations are used on every target.
+#define LANE_LO	0x7f7f7f7fU
+#define LANE_HI	0x80808080U
+
+static inline uint32_t lane_add(uint32_t x, uint32_t y)
+{
+	return ((x & LANE_LO) + (y & LANE_LO)) ^ ((x ^ y) & LANE_HI);
+}
+
+// floor((x + y) / 2) per lane
+static inline uint32_t lane_avg(uint32_t x, uint32_t y)
+{
+	return (x & y) + (((x ^ y) >> 1) & LANE_LO);
+}
+
+static inline uint32_t load32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void store32(uint8_t *p, uint32_t v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+	int pa = abs(b - c);
+	int pb = abs(a - c);
+	int pc = abs(a + b - 2 * c);
+
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+static void unfilter_sub(uint8_t *cur, size_t len, int bpp)
+{
+	size_t i = 0;
+	if (bpp == 4 || bpp == 8) {
+		// each lane only depends on the same lane one pixel to the left
+		for (; i + 4 <= len; i += 4) {
+			store32(cur + i, lane_add(load32(cur + i), load32(cur + i - bpp)));
+		}
+	}
+	for (; i < len; i++) {
+		cur[i] += cur[i - bpp];
+	}
+}
+
+static void unfilter_up(uint8_t *cur, const uint8_t *prev, size_t len)
+{
+	size_t i = 0;
+	for (; i + 4 <= len; i += 4) {
+		store32(cur + i, lane_add(load32(cur + i), load32(prev + i)));
+	}
+	for (; i < len; i++) {
+		cur[i] += prev[i];
+	}
+}
+
+static void unfilter_avg(uint8_t *cur, const uint8_t *prev, size_t len, int bpp)
+{
+	size_t i = 0;
+	if (bpp == 4 || bpp == 8) {
+		for (; i + 4 <= len; i += 4) {
+			store32(cur + i, lane_add(load32(cur + i), lane_avg(load32(cur + i - bpp), load32(prev + i))));
+		}
+	}
+	for (; i < len; i++) {
+		cur[i] += (cur[i - bpp] + prev[i]) >> 1;
+	}
+}
+
+static void unfilter_paeth(uint8_t *cur, const uint8_t *prev, size_t len, int bpp)
+{
+	for (size_t i = 0; i < len; i++) {
+		cur[i] += paeth(cur[i - bpp], prev[i], prev[i - bpp]);
+	}
+}
+
+void pngle_unfilter_row(int type, uint8_t *cur, const uint8_t *prev, size_t len, int bpp)
+{
+	switch (type) {
+	case 1: unfilter_sub(cur, len, bpp); break;
+	case 2: unfilter_up(cur, prev, len); break;
+	case 3: unfilter_avg(cur, prev, len, bpp); break;
+	case 4: unfilter_paeth(cur, prev, len, bpp); break;
+	default: break; // None
+	}
+}
+
+void pngle_unpack_bits(uint8_t *dst, const uint8_t *src, size_t n, int depth)
+{
+	// one source byte at a time, all of its samples at once
+	uint8_t mask = (1U << depth) - 1;
+	int per_byte = 8 / depth;
+	size_t i = 0;
+
+	for (; i + per_byte <= n; src++) {
+		uint8_t v = *src;
+		for (int s = 8 - depth; s >= 0; s -= depth) {
+			dst[i++] = (v >> s) & mask;
+		}
+	}
+	for (int s = 8 - depth; i < n; s -= depth) {
+		dst[i++] = (*src >> s) & mask;
+	}
+}
+
+void pngle_rgba_to_rgb565(uint16_t *dst, const uint8_t *rgba, size_t n)
+{
+	// writes stay behind the reads, so dst may alias rgba
+	for (size_t i = 0; i < n; i++, rgba += 4) {
+		dst[i] = ((rgba[0] & 0xF8) << 8) | ((rgba[1] & 0xFC) << 3) | (rgba[2] >> 3);
+	}
+}
+
+void pngle_rgba_blend_rgb565(uint16_t *dst, const uint8_t *rgba, size_t n, const uint8_t bg[3])
+{
+	uint16_t fill = ((bg[0] & 0xF8) << 8) | ((bg[1] & 0xFC) << 3) | (bg[2] >> 3);
+	size_t i = 0;
+
+	// same aliasing argument as pngle_rgba_to_rgb565()
+	while (i < n) {
+		for (; i < n && rgba[i * 4 + 3] == 255; i++) {
+			const uint8_t *p = rgba + i * 4;
+			dst[i] = ((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3);
+		}
+		for (; i < n && rgba[i * 4 + 3] == 0; i++) {
+			dst[i] = fill;
+		}
+		for (; i < n && (uint8_t)(rgba[i * 4 + 3] + 1) > 1; i++) {
+			const uint8_t *p = rgba + i * 4;
+			uint8_t r = pngle_blend8(p[0], bg[0], p[3]);
+			uint8_t g = pngle_blend8(p[1], bg[1], p[3]);
+			uint8_t b = pngle_blend8(p[2], bg[2], p[3]);
+			dst[i] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Row kernels for pngle: filter reconstruction, sub-byte sample unpacking and
+ * RGBA8888 to RGB565 packing (optionally composited onto a background color).
+ *
+ * Rows are processed whole instead of byte by byte. The unfilter works on
+ * 32-bit words where the filter allows it (Up always; Sub and Average when a
+ * pixel is 4 or 8 bytes), treating each word as four independent byte lanes.
+ * Everything else is a plain byte loop. Results are bit-exact with the PNG
+ * specification; tools/png_kernels.c checks that against a byte-wise
+ * reference and measures throughput on the host.
+ *
+ * No ESP-IDF dependencies, so the file builds on the host as is.
+ */
+
+// Bytes of zero padding the unfilter expects in front of both rows
+// (covers the left neighbour of the first pixel for any bytes-per-pixel).
+#define PNGLE_ROW_PAD	8
+
+/**
+ * @brief Reverse one PNG filter in place.
+ *
+ * @param type Filter type 0..4 (None, Sub, Up, Average, Paeth)
+ * @param cur  Filtered row, PNGLE_ROW_PAD zero bytes before it, 4-byte aligned
+ * @param prev Previous reconstructed row (all zero for the first row of a pass),
+ *             same padding and alignment
+ * @param len  Row length in bytes
+ * @param bpp  Bytes per complete pixel, rounded up (1..8)
+ */
+void pngle_unfilter_row(int type, uint8_t *cur, const uint8_t *prev, size_t len, int bpp);
+
+/**
+ * @brief Expand 1/2/4-bit samples (MSB first) to one byte each.
+ */
+void pngle_unpack_bits(uint8_t *dst, const uint8_t *src, size_t n, int depth);
+
+/**
+ * @brief Pack RGBA8888 pixels to RGB565, alpha dropped.
+ *
+ * dst may alias rgba (packing in place).
+ */
+void pngle_rgba_to_rgb565(uint16_t *dst, const uint8_t *rgba, size_t n);
+
+/**
+ * @brief fg over bg with 8-bit coverage a, rounded like (fg * a + bg * (255 - a)) / 255.
+ */
+static inline uint8_t pngle_blend8(uint8_t fg, uint8_t bg, uint8_t a)
+{
+	uint32_t t = fg * a + bg * (255 - a) + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+/**
+ * @brief Composite RGBA8888 pixels onto an RGB color and pack them to RGB565.
+ *
+ * Opaque and fully transparent runs are a plain pack or fill; only partially
+ * covered pixels are blended. dst may alias rgba.
+ */
+void pngle_rgba_blend_rgb565(uint16_t *dst, const uint8_t *rgba, size_t n, const uint8_t bg[3]);
@@ -14,17 +14,28 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include <sys/param.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
 #include <dirent.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "esp_vfs.h"
 #include "esp_spiffs.h"
 #include "esp_http_server.h"
+#include "esp_rom_crc.h"
+
+#include "frame_cache.h"
+#include "decode_rle.h"
+#include "file_serving_example_common.h"
 
 /* Max length a file path can have on storage */
 #define FILE_PATH_MAX (ESP_VFS_PATH_MAX + CONFIG_SPIFFS_OBJ_NAME_LEN)
@@ -33,25 +44,98 @@
 #define MAX_FILE_SIZE   (8000 * 1024) // 8000 KB
 #define MAX_FILE_SIZE_STR "8000KB"
 
+/* Longest panel side, RLE565 images bigger than this are rejected */
+#define SCREEN_MAX      MAX(CONFIG_WIDTH, CONFIG_HEIGHT)
+
 /* Scratch buffer size */
 #define SCRATCH_BUFSIZE  8192
 
+/* Upload receive ring: httpd_req_recv() fills one buffer while the writer
+ * task stores the ones before it, so network and flash time overlap. The
+ * HTTP server handles one request at a time, so one ring serves all uploads,
+ * and between uploads its first buffer is the scratch buffer of downloads */
+#define UPLOAD_RING_BUFS     4
+#define UPLOAD_WRITER_STACK  4096
+#define UPLOAD_WRITER_CORE   1      /* Wi-Fi and the HTTP server run on core 0 */
+
+/* Uploads are received under this name and renamed over the target once
+ * complete, so the image on display stays intact until then. A file of the
+ * same name is moved aside to the backup name meanwhile. Neither is an image
+ * extension, so the display never picks them up */
+#define UPLOAD_TMP_NAME  ".upload.tmp"
+#define UPLOAD_OLD_NAME  ".upload.old"
+
 struct file_server_data {
     /* Base path of file storage */
     char base_path[ESP_VFS_PATH_MAX + 1];
 
-    /* Scratch buffer for temporary storage during file transfer */
-    char scratch[SCRATCH_BUFSIZE];
+    /* Upload ring, see upload_writer_task(). ring[0] doubles as the
+     * scratch buffer for temporary storage during file downloads */
+    char ring[UPLOAD_RING_BUFS][SCRATCH_BUFSIZE];
+    QueueHandle_t free_bufs;        /* char *, ready to receive into */
+    QueueHandle_t full_bufs;        /* upload_chunk_t, waiting to be written */
+    SemaphoreHandle_t written;      /* given when the writer reaches the end marker */
+    FILE *upload_fd;
+    volatile bool write_failed;
 };
 
+typedef struct {
+    char *buf;                      /* NULL marks the end of the upload */
+    int len;                        /* with buf NULL: < 0 also stops the writer */
+} upload_chunk_t;
+
 static const char *TAG = "file_server";
 
-/* Stub for LCD update. User should replace with actual implementation. */
-static void refresh_lcd(const char *filepath)
+/* Chunk CRC check of a PNG as it streams in. Uploads that pass are recorded
+ * with frame_cache_set_verified(), so the decoder can skip the same work on
+ * every display */
+typedef struct {
+    uint8_t head[8];        /* signature, chunk header, or CRC being collected */
+    uint32_t have;          /* bytes of head collected */
+    uint32_t remain;        /* chunk data bytes still to come */
+    uint32_t crc;
+    enum { PNG_SIG, PNG_HEADER, PNG_DATA, PNG_CRC, PNG_END, PNG_BAD } state;
+    bool iend;
+} png_check_t;
+
+static void png_check_feed(png_check_t *c, const uint8_t *p, size_t len)
 {
-    // 파일 경로가 NULL이면 검은 화면 등 초기화 처리,
-    // 아니면 지정된 이미지 파일을 SPIFFS에서 읽어 LCD에 표시.
-    (void)filepath;
+    static const uint8_t sig[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    while (len > 0 && c->state != PNG_BAD) {
+        if (c->state == PNG_END) {
+            break;                  /* trailing bytes after IEND, the decoder ignores them too */
+        } else if (c->state == PNG_DATA) {
+            size_t n = MIN(len, c->remain);
+            c->crc = esp_rom_crc32_le(c->crc, p, n);
+            p += n;
+            len -= n;
+            c->remain -= n;
+            if (c->remain == 0) c->state = PNG_CRC;
+        } else {
+            size_t want = c->state == PNG_CRC ? 4 : 8;
+            size_t n = MIN(len, want - c->have);
+            memcpy(c->head + c->have, p, n);
+            p += n;
+            len -= n;
+            c->have += n;
+            if (c->have < want) break;
+            c->have = 0;
+
+            const uint8_t *h = c->head;
+            if (c->state == PNG_SIG) {
+                c->state = memcmp(h, sig, 8) == 0 ? PNG_HEADER : PNG_BAD;
+            } else if (c->state == PNG_HEADER) {
+                c->remain = (uint32_t)h[0] << 24 | h[1] << 16 | h[2] << 8 | h[3];
+                c->iend = memcmp(h + 4, "IEND", 4) == 0;
+                c->crc = esp_rom_crc32_le(0, h + 4, 4);
+                c->state = c->remain > MAX_FILE_SIZE ? PNG_BAD : c->remain ? PNG_DATA : PNG_CRC;
+            } else {
+                uint32_t crc = (uint32_t)h[0] << 24 | h[1] << 16 | h[2] << 8 | h[3];
+                c->state = crc != c->crc ? PNG_BAD : c->iend ? PNG_END : PNG_HEADER;
+            }
+        }
+    }
 }
 
 /* Handler to redirect incoming GET request for /index.html to /
@@ -123,6 +207,11 @@ static esp_err_t http_resp_dir_html(httpd_req_t *req, const char *dirpath)
 
     /* Iterate over all files / folders and fetch their names and sizes */
     while ((entry = readdir(dir)) != NULL) {
+        /* Decoded-frame cache files are an implementation detail */
+        if (frame_cache_is_sidecar(entry->d_name) || strcmp(entry->d_name, UPLOAD_TMP_NAME) == 0 ||
+            strcmp(entry->d_name, UPLOAD_OLD_NAME) == 0) {
+            continue;
+        }
         entrytype = (entry->d_type == DT_DIR ? "directory" : "file");
 
         strlcpy(entrypath + dirpath_len, entry->d_name, sizeof(entrypath) - dirpath_len);
@@ -181,6 +270,14 @@ static esp_err_t set_content_type_from_file(httpd_req_t *req, const char *filena
         return httpd_resp_set_type(req, "image/jpeg");
     } else if (IS_FILE_EXT(filename, ".png")) {
         return httpd_resp_set_type(req, "image/png");
+    } else if (IS_FILE_EXT(filename, ".bmp")) {
+        return httpd_resp_set_type(req, "image/bmp");
+    } else if (IS_FILE_EXT(filename, ".avi")) {
+        return httpd_resp_set_type(req, "video/x-msvideo");
+    } else if (IS_FILE_EXT(filename, ".mjpg") || IS_FILE_EXT(filename, ".mjpeg")) {
+        return httpd_resp_set_type(req, "video/x-motion-jpeg");
+    } else if (IS_FILE_EXT(filename, ".rle")) {
+        return httpd_resp_set_type(req, "application/octet-stream");
     } else if (IS_FILE_EXT(filename, ".ico")) {
         return httpd_resp_set_type(req, "image/x-icon");
     }
@@ -258,8 +355,9 @@ static esp_err_t download_get_handler(httpd_req_t *req)
     ESP_LOGI(TAG, "Sending file : %s (%ld bytes)...", filename, file_stat.st_size);
     set_content_type_from_file(req, filename);
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *chunk = ((struct file_server_data *)req->user_ctx)->scratch;
+    /* Retrieve the pointer to scratch buffer for temporary storage: no
+     * upload runs alongside, so the first ring buffer is free */
+    char *chunk = ((struct file_server_data *)req->user_ctx)->ring[0];
     size_t chunksize;
     do {
         /* Read file in chunks into the scratch buffer */
@@ -286,6 +384,52 @@ static esp_err_t download_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/* Writes the chunks the upload handler queues to upload_fd and hands the
+ * buffers back. After a failed write the rest are only handed back, the
+ * handler sees write_failed and gives up */
+static void upload_writer_task(void *arg)
+{
+    struct file_server_data *data = arg;
+    upload_chunk_t c;
+
+    while (1) {
+        xQueueReceive(data->full_bufs, &c, portMAX_DELAY);
+        if (!c.buf) {
+            xSemaphoreGive(data->written);
+            if (c.len < 0) break;
+            continue;
+        }
+        if (!data->write_failed && fwrite(c.buf, 1, c.len, data->upload_fd) != c.len) {
+            data->write_failed = true;
+        }
+        xQueueSend(data->free_bufs, &c.buf, portMAX_DELAY);
+    }
+    vTaskDelete(NULL);
+}
+
+/* Wait until everything queued so far is written, before the file is closed */
+static void upload_drain(struct file_server_data *data)
+{
+    upload_chunk_t end = { .buf = NULL };
+    xQueueSend(data->full_bufs, &end, portMAX_DELAY);
+    xSemaphoreTake(data->written, portMAX_DELAY);
+}
+
+/* Undo a failed example_start_file_server(): stop the writer if it was
+ * started, then delete what it waited on */
+static void server_data_free(struct file_server_data *data, bool writer_started)
+{
+    if (writer_started) {
+        upload_chunk_t stop = { .buf = NULL, .len = -1 };
+        xQueueSend(data->full_bufs, &stop, portMAX_DELAY);
+        xSemaphoreTake(data->written, portMAX_DELAY);
+    }
+    if (data->written) vSemaphoreDelete(data->written);
+    if (data->full_bufs) vQueueDelete(data->full_bufs);
+    if (data->free_bufs) vQueueDelete(data->free_bufs);
+    free(data);
+}
+
 /* Handler to upload a file onto the server */
 static esp_err_t upload_post_handler(httpd_req_t *req)
 {
@@ -309,80 +453,191 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
     /* File cannot be larger than a limit */
     if (req->content_len > MAX_FILE_SIZE) {
-        ESP_LOGE(TAG, "File too large : %d bytes", req->content_len);
+        ESP_LOGE(TAG, "File too large : %d bytes", (int)req->content_len);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
                             "File size must be less than "
                             MAX_FILE_SIZE_STR "!");
         return ESP_FAIL;
     }
 
-    /* Before creating new file, delete all existing files in the directory */
-    {
-        char full_path[FILE_PATH_MAX];
-        struct file_server_data *data = (struct file_server_data *)req->user_ctx;
-        DIR *dir = opendir(data->base_path);
-        if (dir) {
-            struct dirent *entry;
-            while ((entry = readdir(dir)) != NULL) {
-                if (entry->d_type != DT_REG) continue;
-                strlcpy(full_path, data->base_path, sizeof(full_path));
-                strlcat(full_path, "/", sizeof(full_path));
-                strlcat(full_path, entry->d_name, sizeof(full_path));
-                unlink(full_path);
-                ESP_LOGI(TAG, "Deleted old file: %s", full_path);
-            }
-            closedir(dir);
-        }
-    }
+    /* Tells the display whether this upload adds an image or replaces one */
+    struct stat file_stat;
+    bool existed = stat(filepath, &file_stat) == 0;
+
+    struct file_server_data *data = (struct file_server_data *)req->user_ctx;
+    char tmppath[FILE_PATH_MAX];
+    snprintf(tmppath, sizeof(tmppath), "%s/" UPLOAD_TMP_NAME, data->base_path);
 
-    fd = fopen(filepath, "w");
+    fd = fopen(tmppath, "w");
     if (!fd) {
-        ESP_LOGE(TAG, "Failed to create file : %s", filepath);
+        ESP_LOGE(TAG, "Failed to create file : %s", tmppath);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to create file");
         return ESP_FAIL;
     }
 
     ESP_LOGI(TAG, "Receiving file : %s...", filename);
 
-    /* Retrieve the pointer to scratch buffer for temporary storage */
-    char *buf = ((struct file_server_data *)req->user_ctx)->scratch;
+    /* Let the display task decode and draw the image as it arrives */
+    bool live = live_upload_begin(filepath);
+
+    /* The writer task stores what is received into the ring */
+    data->upload_fd = fd;
+    data->write_failed = false;
+
+    char *buf;
     int received;
     int remaining = req->content_len;
+    uint8_t head[RLE565_HEADER_SIZE];
+    size_t head_len = 0;
+    bool probed = false;
+    bool png = IS_FILE_EXT(filename, ".png");
+    png_check_t check = { 0 };
+    int64_t start = esp_timer_get_time();
 
     while (remaining > 0) {
-        ESP_LOGI(TAG, "Remaining size : %d", remaining);
+        xQueueReceive(data->free_bufs, &buf, portMAX_DELAY);
+
         /* Receive the file part by part into a buffer */
         if ((received = httpd_req_recv(req, buf, MIN(remaining, SCRATCH_BUFSIZE))) <= 0) {
+            xQueueSend(data->free_bufs, &buf, 0);
             if (received == HTTPD_SOCK_ERR_TIMEOUT) {
                 /* Retry if timeout occurred */
                 continue;
             }
             /* In case of unrecoverable error, close and delete the unfinished file */
+            upload_drain(data);
             fclose(fd);
-            unlink(filepath);
+            unlink(tmppath);
+            if (live) live_upload_end(false);
             ESP_LOGE(TAG, "File reception failed!");
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to receive file");
             return ESP_FAIL;
         }
 
-        /* Write buffer content to file on storage */
-        if (received && (received != fwrite(buf, 1, received, fd))) {
-            /* Couldn't write everything to file! Storage may be full? */
-            fclose(fd);
-            unlink(filepath);
-            ESP_LOGE(TAG, "File write failed!");
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write file to storage");
-            return ESP_FAIL;
+        /* Device-native RLE565 images are recognized by their magic bytes.
+         * Reject ones that are larger than the panel, and .rle files that
+         * are not RLE565 at all, before they take up storage. The header
+         * may span several receives, so collect it first */
+        if (!probed) {
+            size_t n = MIN((size_t)received, sizeof(head) - head_len);
+            memcpy(head + head_len, buf, n);
+            head_len += n;
+        }
+        if (!probed && (head_len == sizeof(head) || received == remaining)) {
+            uint16_t w, h;
+            bool rle = rle565_probe(head, head_len, &w, &h);
+            probed = true;
+            if ((rle && (w > SCREEN_MAX || h > SCREEN_MAX)) ||
+                (!rle && IS_FILE_EXT(filename, ".rle"))) {
+                xQueueSend(data->free_bufs, &buf, 0);
+                upload_drain(data);
+                fclose(fd);
+                unlink(tmppath);
+                if (live) live_upload_end(false);
+                ESP_LOGE(TAG, "Invalid RLE565 image : %s", filename);
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid RLE565 image");
+                return ESP_FAIL;
+            }
         }
+
+        if (png) png_check_feed(&check, (const uint8_t *)buf, received);
+        if (live) live_upload_feed(buf, received);
+
+        /* Hand the buffer to the writer, which gives it back once stored */
+        upload_chunk_t chunk = { .buf = buf, .len = received };
+        xQueueSend(data->full_bufs, &chunk, portMAX_DELAY);
         remaining -= received;
+
+        /* Stop receiving as soon as a write has failed */
+        if (data->write_failed) break;
     }
 
-    /* Close file upon upload completion */
+    /* Wait for the writer, then make sure the data is on storage before it
+     * replaces the old file */
+    upload_drain(data);
+    if (data->write_failed) {
+        /* Couldn't write everything to file! Storage may be full? */
+        fclose(fd);
+        unlink(tmppath);
+        if (live) live_upload_end(false);
+        ESP_LOGE(TAG, "File write failed!");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to write file to storage");
+        return ESP_FAIL;
+    }
+    fflush(fd);
+    fsync(fileno(fd));
     fclose(fd);
-    ESP_LOGI(TAG, "File reception complete: %s", filename);
+    ESP_LOGI(TAG, "File reception complete: %s (%u bytes in %"PRId64" ms)",
+             filename, (unsigned)req->content_len, (esp_timer_get_time() - start) / 1000);
+
+    /* A PNG with a bad chunk CRC would fail on every display, reject it now.
+     * A good one does not need its CRCs checked again */
+    if (png) {
+        if (check.state != PNG_END) {
+            unlink(tmppath);
+            if (live) live_upload_end(false);
+            ESP_LOGE(TAG, "Corrupt PNG : %s", filename);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Corrupt PNG image");
+            return ESP_FAIL;
+        }
+    }
+
+    /* Swap the new file in. Neither SPIFFS nor FAT rename over an existing
+     * file, so an old file of the same name is renamed to the backup name
+     * first and only deleted once the new one is in place. If that fails
+     * the backup goes back, so a failed swap never loses the old image */
+    char oldpath[FILE_PATH_MAX];
+    snprintf(oldpath, sizeof(oldpath), "%s/" UPLOAD_OLD_NAME, data->base_path);
+    if (existed) {
+        unlink(oldpath);
+        if (rename(filepath, oldpath) != 0) {
+            unlink(tmppath);
+            if (live) live_upload_end(false);
+            ESP_LOGE(TAG, "Failed to rename %s to %s", filepath, oldpath);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save file");
+            return ESP_FAIL;
+        }
+    }
+    if (rename(tmppath, filepath) != 0) {
+        if (existed && rename(oldpath, filepath) != 0) {
+            ESP_LOGE(TAG, "Failed to restore %s from %s", filepath, oldpath);
+        }
+        unlink(tmppath);
+        if (live) live_upload_end(false);
+        ESP_LOGE(TAG, "Failed to rename %s to %s", tmppath, filepath);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save file");
+        return ESP_FAIL;
+    }
+    if (existed) unlink(oldpath);
+
+#if !CONFIG_SLIDESHOW
+    /* Only the new image is kept: delete the previous ones now that it is in place */
+    {
+        char full_path[FILE_PATH_MAX];
+        DIR *dir = opendir(data->base_path);
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (entry->d_type != DT_REG) continue;
+                strlcpy(full_path, data->base_path, sizeof(full_path));
+                strlcat(full_path, "/", sizeof(full_path));
+                strlcat(full_path, entry->d_name, sizeof(full_path));
+                if (strcmp(full_path, filepath) == 0) continue;
+                unlink(full_path);
+                ESP_LOGI(TAG, "Deleted old file: %s", full_path);
+            }
+            closedir(dir);
+        }
+    }
+#endif
+
+    /* A cached frame of a previous upload with the same name is stale now */
+    frame_cache_invalidate(filepath);
+    if (png) frame_cache_set_verified(filepath);
+    if (live) live_upload_end(true);
 
-    /* Trigger LCD update callback */
-    refresh_lcd(filepath);
+    /* Let the display task pick up the new file */
+    image_event_post(existed ? IMAGE_EVENT_REPLACED : IMAGE_EVENT_ADDED, filepath, req->content_len);
 
     /* Redirect onto root to see the updated file list */
     httpd_resp_set_status(req, "303 See Other");
@@ -424,9 +679,10 @@ static esp_err_t delete_post_handler(httpd_req_t *req)
     ESP_LOGI(TAG, "Deleting file : %s", filename);
     /* Delete file */
     unlink(filepath);
+    frame_cache_invalidate(filepath);
 
-    /* Trigger LCD update callback with NULL to clear screen */
-    refresh_lcd(NULL);
+    /* Let the display task move off the deleted file */
+    image_event_post(IMAGE_EVENT_DELETED, filepath, 0);
 
     /* Redirect onto root to see the updated file list */
     httpd_resp_set_status(req, "303 See Other");
@@ -457,15 +713,37 @@ esp_err_t example_start_file_server(const char *base_path)
     strlcpy(server_data->base_path, base_path,
             sizeof(server_data->base_path));
 
+    /* Upload ring and the writer task that empties it */
+    server_data->free_bufs = xQueueCreate(UPLOAD_RING_BUFS, sizeof(char *));
+    server_data->full_bufs = xQueueCreate(UPLOAD_RING_BUFS + 1, sizeof(upload_chunk_t));
+    server_data->written = xSemaphoreCreateBinary();
+    if (!server_data->free_bufs || !server_data->full_bufs || !server_data->written ||
+        xTaskCreatePinnedToCore(upload_writer_task, "upload_writer", UPLOAD_WRITER_STACK, server_data,
+                                tskIDLE_PRIORITY + 5, NULL, UPLOAD_WRITER_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start upload writer");
+        server_data_free(server_data, false);
+        server_data = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < UPLOAD_RING_BUFS; i++) {
+        char *buf = server_data->ring[i];
+        xQueueSend(server_data->free_bufs, &buf, 0);
+    }
+
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
 
     /* Use the URI wildcard matching function */
     config.uri_match_fn = httpd_uri_match_wildcard;
 
+    /* Receive next to the network stack, the upload writer has the other core */
+    config.core_id = 0;
+
     ESP_LOGI(TAG, "Starting HTTP Server on port: '%d'", config.server_port);
     if (httpd_start(&server, &config) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start file server!");
+        server_data_free(server_data, true);
+        server_data = NULL;
         return ESP_FAIL;
     }
 
@@ -14,6 +14,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "sdkconfig.h"
 #include "esp_err.h"
 
@@ -25,6 +28,38 @@ esp_err_t example_mount_storage(const char *base_path);
 
 esp_err_t example_start_file_server(const char *base_path);
 
+/* Changes to the image directory, published by the file server for the
+ * display task (main.c), which waits for them instead of scanning the
+ * directory */
+typedef enum {
+    IMAGE_EVENT_RECEIVING,  /* upload started, streamed by live_upload_feed() */
+    IMAGE_EVENT_ADDED,      /* upload of a new name finished */
+    IMAGE_EVENT_REPLACED,   /* upload over an existing name finished */
+    IMAGE_EVENT_DELETED,
+} image_event_type_t;
+
+typedef struct {
+    image_event_type_t type;
+    uint32_t size;          /* bytes of the uploaded file, 0 for IMAGE_EVENT_DELETED */
+    char path[64];
+} image_event_t;
+
+/* Never blocks: if the display task is too far behind, it rereads the
+ * directory once instead */
+void image_event_post(image_event_type_t type, const char *path, uint32_t size);
+
+/* Live display of an upload (main.c). The file server tees the body into
+ * live_upload_feed() while it writes the file, and the display task decodes
+ * and draws the image as the bytes arrive.
+ *
+ * live_upload_begin() returns false if the image cannot be shown this way
+ * (not PNG/JPEG, slideshow mode, display busy with another upload); then
+ * nothing else needs to be called. Otherwise live_upload_end() must follow,
+ * with ok = false if the upload failed or was rejected. */
+bool live_upload_begin(const char *filepath);
+void live_upload_feed(const void *data, size_t len);
+void live_upload_end(bool ok);
+
 #ifdef __cplusplus
 }
 #endif
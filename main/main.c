@@ -8,6 +8,9 @@
  * - SPIFFS에 저장된 이미지를 Wi-Fi 파일 서버를 통해 업로드/삭제/다운로드
  * - ST7789 LCD에 하드웨어 MADCTL 회전 후, 스케일만 적용하여 이미지 출력
  * - JPEG/PNG 파일 형식에 따라 자동으로 디코딩 처리
+ * - 16/24비트 BMP는 디코딩 없이 행 단위로 바로 전송
+ * - RLE565(tools/rle565.py로 변환)는 매직 바이트로 판별해 행 단위로 풀어서 전송
+ * - MJPEG 동영상(.avi/.mjpg)은 밴드 단위 디코딩으로 프레임 속도에 맞춰 재생
  */
 
 #include <stdio.h>
@@ -16,11 +19,16 @@
 #include <inttypes.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/param.h>
 
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
 #include "esp_err.h"
+#include "esp_timer.h"
 #include "esp_system.h"
 #include "esp_vfs.h"
 #include "esp_spiffs.h"
@@ -31,6 +39,10 @@
 #include "pngle.h"
 #include "decode_png.h"
 #include "decode_jpeg.h"
+#include "frame_cache.h"
+#include "decode_rle.h"
+#include "decode_arena.h"
+#include "mjpeg_player.h"
 
 #include "esp_event.h"
 #include "esp_log.h"
@@ -41,6 +53,7 @@
 #include "wifi_provisioning/scheme_ble.h"
 
 #include "file_serving_example_common.h"
+#include "bmpfile.h"
 #include "power_button.h"
 #include "wifi_provision.h"
 #include "charging_indicator.h"
@@ -69,8 +82,25 @@ static int scrW, scrH;            // 회전 후 화면 가로·세로 (MADCTL 
 static float scaleF;              // 확대/축소 배율
 static int scaledW, scaledH;      // 스케일된 크기
 static int colOffset, rowOffset;  // 중앙 정렬 오프셋
+static png_scaler_t pngScaler;    // PNG 면적 평균 리샘플러 (비인터레이스 이미지)
+static png_interlace_t pngInterlace;  // PNG Adam7 패스 → 블록 복제 (인터레이스 이미지)
+static TFT_t *pngProgressDev;     // 인터레이스 패스마다 중간 결과를 그릴 LCD (NULL이면 그리지 않음)
+static int pngPass;               // 마지막으로 받은 인터레이스 패스 번호
+static int pngRowsDone;           // 위에서부터 완성된 출력 행 수, -1 = 인터레이스 (행 순서 아님)
+static pngle_t *pngCur;           // 디코딩 중인 PNG (업로드 실시간 표시가 완성된 행을 그림)
+
+// 투명 PNG 픽셀을 합성할 배경색 (Kconfig 0xRRGGBB)
+#define PNG_BG_R ((CONFIG_PNG_BACKGROUND >> 16) & 0xFF)
+#define PNG_BG_G ((CONFIG_PNG_BACKGROUND >> 8) & 0xFF)
+#define PNG_BG_B (CONFIG_PNG_BACKGROUND & 0xFF)
+#define PNG_BG_565 (((PNG_BG_R & 0xF8) << 8) | ((PNG_BG_G & 0xFC) << 3) | (PNG_BG_B >> 3))
 TFT_t *g_dev = NULL;       // LCD 디바이스 포인터
 
+// MADCTL: 90° 회전 (MV=1, MX=1, MY=0)
+#define LCD_MADCTL 0x60
+#define MADCTL_MV  0x20
+static uint8_t lcd_madctl = LCD_MADCTL;  // 현재 패널에 설정된 MADCTL
+
 static void on_power_long_press(void)
 {
     ESP_LOGW(TAG_POWER, "전원 꺼짐 직전 콜백 호출됨: 필요한 마무리 작업 수행");
@@ -87,7 +117,7 @@ static void listSPIFFS(const char *path)
         struct dirent *pe = readdir(dir);
         if (!pe) break;
         ESP_LOGI(TAG, "d_name=%s  d_ino=%d  d_type=%x",
-                 pe->d_name, pe->d_ino, pe->d_type);
+                 pe->d_name, (int)pe->d_ino, pe->d_type);
     }
     closedir(dir);
 }
@@ -122,6 +152,212 @@ static esp_err_t mountSPIFFS(const char *path, const char *label, int max_files)
     return ret;
 }
 
+// --------------------------------------------------
+// EXIF 방향: 회전 패스 없이 MADCTL 주소 매핑만 바꿔서 반영
+// 저장된 픽셀을 그대로 보내면 EXIF가 요구하는 방향으로 보이도록,
+// LCD_MADCTL(0x60)에 방향 변환을 합성한 값 (MADCTL 반전은 행/열 교환 후 적용)
+// --------------------------------------------------
+static const uint8_t exif_madctl[9] = {
+    LCD_MADCTL,     // 0: 없음
+    0x60,           // 1: 그대로
+    0xE0,           // 2: 좌우 반전
+    0xA0,           // 3: 180°
+    0x20,           // 4: 상하 반전
+    0x40,           // 5: 좌우 반전 + 270°
+    0xC0,           // 6: 90° (시계 방향)
+    0x80,           // 7: 좌우 반전 + 90°
+    0x00,           // 8: 270°
+};
+
+// madctl 기준 화면 크기: 기본 매핑과 행/열 교환(MV)이 다르면 가로·세로가 바뀜
+static void ScreenSize(uint8_t madctl, int *w, int *h)
+{
+    bool swap = (madctl ^ LCD_MADCTL) & MADCTL_MV;
+    *w = swap ? scrH : scrW;
+    *h = swap ? scrW : scrH;
+}
+
+// MADCTL 변경. 행/열 교환이 바뀌면 드라이버의 화면 크기·오프셋도 교환
+// (보이는 영역이 컨트롤러 메모리 가운데에 있다고 가정, 반전만으로는 오프셋 불변)
+static void LcdSetOrientation(TFT_t *dev, uint8_t madctl)
+{
+    if (madctl == lcd_madctl) return;
+    if ((madctl ^ lcd_madctl) & MADCTL_MV) {
+        uint16_t t = dev->_width;
+        dev->_width = dev->_height;
+        dev->_height = t;
+        t = dev->_offsetx;
+        dev->_offsetx = dev->_offsety;
+        dev->_offsety = t;
+    }
+    spi_master_write_command(dev, 0x36);
+    spi_master_write_data_byte(dev, madctl);
+    lcd_madctl = madctl;
+}
+
+// JPEG 파일의 EXIF 방향에 해당하는 MADCTL
+static uint8_t JpegMadctl(const char *file)
+{
+    jpeg_exif_t exif;
+    FILE *fp = fopen(file, "rb");
+    if (!fp) return LCD_MADCTL;
+    decode_jpeg_exif(fp, 0, &exif);
+    fclose(fp);
+    return exif_madctl[exif.orientation];
+}
+
+// --------------------------------------------------
+// 화면 한 장 분량의 RGB565 프레임: 디코딩(또는 캐시 로드) 후 한 번에 전송
+// rows[srcY + i] + srcX 부터 w 픽셀씩, 화면 (x, y + i) 위치에 그림
+// --------------------------------------------------
+typedef struct {
+    uint16_t **rows;
+    int nrows;
+    int srcX, srcY;
+    int x, y, w, h;
+    uint8_t madctl;     // 이 프레임을 보낼 때의 MADCTL (EXIF 방향)
+} frame_t;
+
+static void FrameRelease(frame_t *f)
+{
+    if (f->rows) {
+        release_image(&f->rows, 0, f->nrows);
+    }
+    memset(f, 0, sizeof(*f));
+}
+
+// 이미지 바깥 영역만 검게 칠함 (전체 클리어로 인한 깜빡임 방지)
+static void FillMargins(TFT_t *dev, int x, int y, int w, int h)
+{
+    int sw, sh;
+    ScreenSize(lcd_madctl, &sw, &sh);
+    if (y > 0) lcdDrawFillRect(dev, 0, 0, sw - 1, y - 1, BLACK);
+    if (y + h < sh) lcdDrawFillRect(dev, 0, y + h, sw - 1, sh - 1, BLACK);
+    if (h <= 0) return;
+    if (x > 0) lcdDrawFillRect(dev, 0, y, x - 1, y + h - 1, BLACK);
+    if (x + w < sw) lcdDrawFillRect(dev, x + w, y, sw - 1, y + h - 1, BLACK);
+}
+
+static void FrameFlush(TFT_t *dev, const frame_t *f)
+{
+    lcdSetFontDirection(dev, 0);
+    LcdSetOrientation(dev, f->madctl);
+    for (int i = 0; i < f->h; i++) {
+        lcdDrawMultiPixels(dev, f->x, f->y + i, f->w, f->rows[f->srcY + i] + f->srcX);
+    }
+    FillMargins(dev, f->x, f->y, f->w, f->h);
+    lcdDrawFinish(dev);
+    LcdSetOrientation(dev, LCD_MADCTL);
+}
+
+// --------------------------------------------------
+// 디코딩 결과 캐시: 화면 크기·회전이 같으면 디코딩 없이 바로 출력
+// --------------------------------------------------
+// 디코딩 결과 픽셀이 바뀌는 변경(스케일러, 합성, 인터레이스 처리 등)마다 올림
+// 2: PNG 면적 평균 축소, 배경색 합성, Adam7 블록 채우기
+#define FRAME_CACHE_REVISION 2
+
+// PNG은 배경색에 합성된 결과이므로 배경색도 키에 포함 (JPEG은 투명 픽셀이 없어 0)
+static frame_cache_geom_t cache_geom(const char *file, uint8_t madctl)
+{
+    int sw, sh;
+    ScreenSize(madctl, &sw, &sh);
+    const char *ext = strrchr(file, '.');
+    bool png = ext && strcasecmp(ext, ".png") == 0;
+    frame_cache_geom_t geom = {
+        .screenWidth  = sw,
+        .screenHeight = sh,
+        .rotation     = madctl,
+        .background   = png ? CONFIG_PNG_BACKGROUND : 0,
+        .revision     = FRAME_CACHE_REVISION,
+    };
+    return geom;
+}
+
+static esp_err_t CacheLoad(const char *file, frame_t *f, uint8_t madctl)
+{
+    frame_cache_geom_t geom = cache_geom(file, madctl);
+    frame_cache_t fc;
+    if (frame_cache_open(&fc, file, &geom) != ESP_OK) return ESP_ERR_NOT_FOUND;
+
+    memset(f, 0, sizeof(*f));
+    f->rows = calloc(fc.height, sizeof(uint16_t *));
+    f->nrows = fc.height;
+    esp_err_t ret = f->rows ? ESP_OK : ESP_ERR_NO_MEM;
+    for (int i = 0; ret == ESP_OK && i < fc.height; i++) {
+        f->rows[i] = malloc(fc.width * sizeof(uint16_t));
+        if (!f->rows[i]) {
+            ret = ESP_ERR_NO_MEM;
+        } else if (frame_cache_read_row(&fc, f->rows[i]) != ESP_OK) {
+            // 잘린 캐시는 지우고 원본을 다시 디코딩
+            ESP_LOGW(TAG, "캐시 읽기 실패: %s", file);
+            frame_cache_invalidate(file);
+            ret = ESP_FAIL;
+        }
+    }
+    frame_cache_close(&fc);
+    if (ret != ESP_OK) {
+        FrameRelease(f);
+        return ret;
+    }
+
+    f->x = fc.x;
+    f->y = fc.y;
+    f->w = fc.width;
+    f->h = fc.height;
+    f->madctl = madctl;
+    return ESP_OK;
+}
+
+// 프레임 f를 캐시에 저장
+static void CacheStore(const char *file, const frame_t *f)
+{
+    frame_cache_geom_t geom = cache_geom(file, f->madctl);
+    int x = f->x, y = f->y, w = f->w, h = f->h;
+    if (w > geom.screenWidth - x) w = geom.screenWidth - x;
+    if (h > geom.screenHeight - y) h = geom.screenHeight - y;
+    if (w <= 0 || h <= 0) return;
+
+    frame_cache_t fc;
+    if (frame_cache_create(&fc, file, &geom, x, y, w, h) != ESP_OK) return;
+    for (int i = 0; i < h; i++) {
+        if (frame_cache_write_row(&fc, f->rows[f->srcY + i] + f->srcX) != ESP_OK) return;
+    }
+    frame_cache_commit(&fc);
+}
+
+// --------------------------------------------------
+// 스케일이 걸린 비인터레이스 PNG 행 콜백: RGBA8888 한 줄 → 리샘플러
+// --------------------------------------------------
+static void png_row_scaled(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step,
+                           uint32_t n, const void *pixels)
+{
+    png_scaler_push(&pngScaler, y, pixels);
+    pngRowsDone = pngScaler.out_y;
+}
+
+// --------------------------------------------------
+// 인터레이스 PNG 행 콜백: 패스가 바뀌면 지금까지의 그림을 화면에 먼저 보여 줌
+// --------------------------------------------------
+static void png_row_interlaced(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step,
+                               uint32_t n, const void *pixels)
+{
+    int pass = pngle->interlace_pass;
+    if (pass != pngPass && pngPass > 0 && pngProgressDev) {
+        TFT_t *dev = pngProgressDev;
+        int w = pngle->imageWidth, h = pngle->imageHeight;
+        lcdSetFontDirection(dev, 0);
+        for (int i = 0; i < h; i++) {
+            lcdDrawMultiPixels(dev, colOffset, rowOffset + i, w, pngle->pixels[i]);
+        }
+        if (pngPass == 1) FillMargins(dev, colOffset, rowOffset, w, h);
+        lcdDrawFinish(dev);
+        ESP_LOGD(TAG, "PNG 인터레이스 패스 %d 표시", pngPass);
+    }
+    pngPass = pass;
+    png_interlace_push(&pngInterlace, pass, y, pixels, n);
+}
+
 // --------------------------------------------------
 // “회전 없는” PNG 초기화 콜백: 원본 크기를 얻고 스케일·오프셋 계산
 // --------------------------------------------------
@@ -139,27 +375,66 @@ static void png_init_simple(pngle_t *pngle, uint32_t width, uint32_t height)
     rowOffset = (scrH - scaledH) / 2;
     if (colOffset < 0) colOffset = 0;
     if (rowOffset < 0) rowOffset = 0;
+
+    // 크기를 안 지금에서야 이미지 영역만큼만 픽셀 버퍼를 할당 (화면 전체 버퍼 불필요)
+    int w = scaledW < scrW - colOffset ? scaledW : scrW - colOffset;
+    int h = scaledH < scrH - rowOffset ? scaledH : scrH - rowOffset;
+    pngRowsDone = pngle->hdr.interlace ? -1 : 0;
+    if (w <= 0 || h <= 0 || pngle_alloc_pixels(pngle, w, h) < 0) {
+        ESP_LOGE(TAG, "PNG 픽셀 버퍼 할당 실패 (%dx%d)", w, h);
+        return;
+    }
+    pngle->imageWidth = w;
+    pngle->imageHeight = h;
+
+    // 인터레이스: 패스마다 블록으로 채우고 다음 패스가 다듬음 (첫 패스 후 이미 전체 그림)
+    // 알파는 pngle_set_background()가 RGB565 행에서 이미 합성
+    if (pngle->hdr.interlace) {
+        esp_err_t err = png_interlace_init(&pngInterlace, origW, origH, w, h, pngle->pixels);
+        if (err == ESP_OK) {
+            pngle_set_row_callback(pngle, png_row_interlaced, PNGLE_ROW_RGB565);
+            return;
+        }
+        ESP_LOGW(TAG, "PNG 인터레이스 버퍼 초기화 실패: %s, 최근접 매핑 사용", esp_err_to_name(err));
+    }
+
+    // 크기가 다르면 면적 평균(축소)·행/열 복제(확대)로 모든 출력 픽셀을 정확히 한 번씩 채움
+    if (!pngle->hdr.interlace && (scaledW != origW || scaledH != origH)) {
+        esp_err_t err = png_scaler_init(&pngScaler, origW, origH, w, h, pngle->pixels);
+        if (err == ESP_OK) {
+            png_scaler_set_background(&pngScaler, PNG_BG_565, NULL);
+            pngle_set_row_callback(pngle, png_row_scaled, PNGLE_ROW_RGBA8888);
+            return;
+        }
+        ESP_LOGW(TAG, "PNG 리샘플러 초기화 실패: %s, 최근접 매핑 사용", esp_err_to_name(err));
+    }
+    // 확대 시 빈 픽셀은 배경색 (행 버퍼는 이미 0 = BLACK)
+    for (int i = 0; PNG_BG_565 != 0 && i < h; i++) {
+        for (int j = 0; j < w; j++) pngle->pixels[i][j] = PNG_BG_565;
+    }
 }
 
 // --------------------------------------------------
-// “회전 없는” PNG 드로우 콜백: RGBA 블록 → 스케일·오프셋 적용해 LCD 픽셀 그리기
+// “회전 없는” PNG 행 콜백: RGB565 한 줄(인터레이스면 패스의 한 줄) → 스케일 적용해 이미지 영역 버퍼에 기록
 // --------------------------------------------------
-static void png_draw_simple(pngle_t *pngle, uint32_t x, uint32_t y,
-                            uint32_t w, uint32_t h, unsigned char *rgba)
+static void png_row_simple(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step,
+                           uint32_t n, const void *pixels)
 {
-    if (!g_dev) return;
-    for (uint32_t row = 0; row < h; row++) {
-        for (uint32_t col = 0; col < w; col++) {
-            unsigned char *p = rgba + ((row * w + col) * 4);
-            uint8_t r = p[0], g = p[1], b = p[2];
-            uint16_t color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    if (!pngle->pixels) return;  // 버퍼 할당 실패: 끝까지 읽고 오류 처리
+    int dispY = (int)(y * scaleF);
+    if (pngRowsDone >= 0) {
+        // 다음 원본 행이 덮어쓰지 않는 출력 행까지 완성
+        int done = (int)((y + 1) * scaleF);
+        pngRowsDone = done < pngle->imageHeight ? done : pngle->imageHeight;
+    }
+    if (dispY >= pngle->imageHeight) return;
 
-            int origX = (int)x + (int)col;
-            int origY = (int)y + (int)row;
-            int dispX = colOffset + (int)(origX * scaleF);
-            int dispY = rowOffset + (int)(origY * scaleF);
-            lcdDrawPixel(g_dev, dispX, dispY, color);
-        }
+    const uint16_t *src = pixels;
+    uint16_t *dst = pngle->pixels[dispY];
+    for (uint32_t i = 0; i < n; i++, x += step) {
+        int dispX = (int)(x * scaleF);
+        if (dispX >= pngle->imageWidth) break;
+        dst[dispX] = src[i];
     }
 }
 
@@ -172,50 +447,51 @@ static void png_done_simple(pngle_t *pngle)
 }
 
 // --------------------------------------------------
-// PNG 스트리밍 처리: 하드웨어 회전은 MADCTL으로 이미 걸렸으므로,
-// 화면 크기(scrW, scrH)만 넘겨주고, 간단히 스케일+렌더링
+// PNG 디코딩: 하드웨어 회전은 MADCTL으로 이미 걸렸으므로,
+// 스케일된 이미지 크기 버퍼에만 그리고, 중앙 정렬은 프레임 위치(x, y)로 처리
+// progress가 있으면 인터레이스 이미지는 패스가 끝날 때마다 그 LCD에 중간 결과를 그림
+// 입력은 read()로 받음 (파일 또는 업로드 중인 스트림), 0을 돌려주면 끝
 // --------------------------------------------------
-static void PNGDisplaySimple(TFT_t *dev, const char *file)
-{
-    FILE *fp = fopen(file, "rb");
-    if (!fp) {
-        ESP_LOGE(TAG, "파일을 찾을 수 없음: %s", file);
-        return;
-    }
-
-    scrW = scrW;  // 그대로 사용
-    scrH = scrH;
-    g_dev = dev;
+typedef size_t (*image_read_t)(void *arg, uint8_t *buf, size_t len);
 
-    pngle_t *pngle = pngle_new(scrW, scrH);
+static esp_err_t PNGDecode(image_read_t read, void *arg, bool crc_check, frame_t *f, TFT_t *progress)
+{
+    // 픽셀 버퍼는 png_init_simple()에서 이미지 크기를 안 뒤에 할당
+    pngle_t *pngle = pngle_new_unbuffered(scrW, scrH);
     if (!pngle) {
         ESP_LOGE(TAG, "pngle_new 실패");
-        fclose(fp);
-        return;
+        return ESP_ERR_NO_MEM;
     }
 
     // “회전 없는” 콜백 등록
+    origW = 0;
+    pngProgressDev = progress;
+    pngPass = 0;
+    pngRowsDone = 0;
+    pngCur = pngle;
     pngle_set_init_callback(pngle, png_init_simple);
-    pngle_set_draw_callback(pngle, png_draw_simple);
+    pngle_set_row_callback(pngle, png_row_simple, PNGLE_ROW_RGB565);
     pngle_set_done_callback(pngle, png_done_simple);
     pngle_set_display_gamma(pngle, 2.2);
-
-    // 화면 클리어
-    lcdSetFontDirection(dev, 0);
-    lcdFillScreen(dev, BLACK);
+    // 알파를 버리지 않고 배경색에 합성 (RGB565 행 출력에 적용)
+    pngle_set_background(pngle, PNG_BG_R, PNG_BG_G, PNG_BG_B);
+    pngle_set_crc_check(pngle, crc_check);
 
     char buf[1024];
     size_t remain = 0;
-    while (!feof(fp)) {
+    esp_err_t ret = ESP_OK;
+    while (1) {
         if (remain >= sizeof(buf)) {
             ESP_LOGE(TAG, "버퍼 오버플로우");
+            ret = ESP_FAIL;
             break;
         }
-        int len = fread(buf + remain, 1, sizeof(buf) - remain, fp);
-        if (len <= 0) break;
+        size_t len = read(arg, (uint8_t *)buf + remain, sizeof(buf) - remain);
+        if (len == 0) break;
         int fed = pngle_feed(pngle, buf, remain + len);
         if (fed < 0) {
             ESP_LOGE(TAG, "pngle_feed 오류: %s", pngle_error(pngle));
+            ret = ESP_ERR_NOT_SUPPORTED;
             break;
         }
         remain = remain + len - fed;
@@ -223,55 +499,1115 @@ static void PNGDisplaySimple(TFT_t *dev, const char *file)
             memmove(buf, buf + fed, remain);
         }
     }
-    fclose(fp);
+    png_scaler_free(&pngScaler);
+    png_interlace_free(&pngInterlace);
+    pngProgressDev = NULL;
+    pngCur = NULL;
+    if (ret == ESP_OK && origW == 0) ret = ESP_ERR_NOT_SUPPORTED;
+    if (ret == ESP_OK && !pngle->pixels) ret = ESP_ERR_NO_MEM;
 
+    if (ret == ESP_OK) {
+        // 픽셀 버퍼 소유권을 프레임으로 넘김
+        f->rows = pngle->pixels;
+        f->nrows = pngle->pixelRows;
+        pngle->pixels = NULL;
+        pngle->pixelRows = 0;
+        f->srcX = f->srcY = 0;
+        f->x = colOffset;
+        f->y = rowOffset;
+        f->w = pngle->imageWidth;
+        f->h = pngle->imageHeight;
+        f->madctl = LCD_MADCTL;
+    }
     pngle_destroy(pngle, scrW, scrH);
-    lcdDrawFinish(dev);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    return ret;
+}
+
+static size_t file_read(void *arg, uint8_t *buf, size_t len)
+{
+    return fread(buf, 1, len, (FILE *)arg);
+}
+
+static esp_err_t PNGDecodeFrame(const char *file, frame_t *f, TFT_t *progress)
+{
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "파일을 찾을 수 없음: %s", file);
+        return ESP_ERR_NOT_FOUND;
+    }
+    // 업로드 때 청크 CRC 검사를 통과한 파일은 표시할 때마다 다시 계산하지 않음
+    esp_err_t ret = PNGDecode(file_read, fp, !frame_cache_is_verified(file), f, progress);
+    fclose(fp);
+    return ret;
 }
 
 // --------------------------------------------------
-// JPEG 디코딩 처리: 하드웨어 회전은 MADCTL으로 이미 걸렸으므로,
-// decode_jpeg() 호출 후, 간단히 픽셀 버퍼 출력
+// JPEG 디코딩: decode_jpeg()가 이미 화면에 맞게 스케일링한 버퍼를 프레임으로 반환
 // --------------------------------------------------
-static void JPEGDisplaySimple(TFT_t *dev, const char *file)
+static esp_err_t JPEGDecodeFrame(const char *file, frame_t *f, uint8_t madctl)
 {
     pixel_jpeg **pixels = NULL;
     int imageW = 0, imageH = 0;
+    int sw, sh;
+    ScreenSize(madctl, &sw, &sh);
+
+    // decode_jpeg(): sw, sh 크기로 디코딩하며 imageW, imageH 반환
+    esp_err_t err = decode_jpeg(&pixels, (char *)file, sw, sh, &imageW, &imageH);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "JPEG 디코드 실패: %s", file);
+        return err;
+    }
+
+    // 이미지 픽셀 버퍼(pixels[y][x])를 화면 중앙에 스케일 없이 렌더링
+    f->rows = pixels;
+    f->nrows = sh;
+    f->srcX = f->srcY = 0;
+    f->w = imageW < sw ? imageW : sw;
+    f->h = imageH < sh ? imageH : sh;
+    f->x = (sw - f->w) / 2;
+    f->y = (sh - f->h) / 2;
+    f->madctl = madctl;
+    return ESP_OK;
+}
+
+// --------------------------------------------------
+// PNG/JPEG 한 장을 프레임으로 준비: 캐시 → 디코딩(성공 시 캐시 저장) 순서
+// 디스플레이 태스크와 프리페치 태스크 양쪽에서 호출됨 (동시에 호출되지는 않음)
+// progress: 인터레이스 PNG를 디코딩하는 동안 중간 결과를 그릴 LCD (프리페치는 NULL)
+// --------------------------------------------------
+static esp_err_t FrameLoad(const char *file, frame_t *f, TFT_t *progress)
+{
+    const char *ext = strrchr(file, '.');
+    bool png = ext && strcasecmp(ext, ".png") == 0;
+    uint8_t madctl = png ? LCD_MADCTL : JpegMadctl(file);
+
+    memset(f, 0, sizeof(*f));
+    if (CacheLoad(file, f, madctl) == ESP_OK) {
+        ESP_LOGI(TAG, "캐시에서 로드: %s", file);
+        return ESP_OK;
+    }
+
+    esp_err_t err = png ? PNGDecodeFrame(file, f, progress) : JPEGDecodeFrame(file, f, madctl);
+    if (err == ESP_OK) {
+        CacheStore(file, f);
+    }
+    return err;
+}
+
+// --------------------------------------------------
+// JPEG 2단계 출력
+// 1) EXIF 썸네일, 없으면 1/8 스케일(DC 계수만, IDCT 없음) 미리보기를 쌍선형 확대해 먼저 그림
+// 2) 전체 해상도 디코딩을 밴드(MCU 한 줄) 단위로 그 위에 덮어쓰면서 캐시에 기록
+// EXIF 방향은 MADCTL로 반영하므로 두 단계 모두 저장된 픽셀 순서 그대로 출력
+// --------------------------------------------------
+typedef struct {
+    TFT_t *dev;
+    int x, y;                 // 이미지의 화면 위치
+    uint16_t *preview;        // 미리보기 버퍼 (pw x ph)
+    int pw, ph;
+    frame_cache_t *fc;        // 전체 디코딩 결과를 기록할 캐시, 실패하면 NULL
+    int w, h;                 // 업로드 실시간 표시: 첫 밴드에서 정한 이미지 크기 (0 = 아직)
+} jpeg_view_t;
+
+static bool preview_band(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band)
+{
+    jpeg_view_t *v = js->arg;
+    for (int i = 0; i < height && top + i < v->ph; i++) {
+        memcpy(&v->preview[(top + i) * v->pw], &band[i * js->bandWidth], v->pw * sizeof(uint16_t));
+    }
+    return true;
+}
+
+static bool full_band(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band)
+{
+    jpeg_view_t *v = js->arg;
+    for (int i = 0; i < height; i++) {
+        uint16_t *row = (uint16_t *)&band[i * js->bandWidth];
+        lcdDrawMultiPixels(v->dev, v->x, v->y + top + i, js->bandWidth, row);
+        if (v->fc && frame_cache_write_row(v->fc, row) != ESP_OK) {
+            v->fc = NULL;  // 저장 공간 부족 등: 캐시는 포기하고 출력은 계속
+        }
+    }
+    return true;
+}
+
+// RGB565 → 0g0r0b 형태로 펼쳐서 5비트 가중치 보간 시 필드 간 자리 올림이 없게 함
+#define SPREAD565(c)  (((uint32_t)(c) | ((uint32_t)(c) << 16)) & 0x07E0F81F)
+#define PACK565(v)    ((uint16_t)(((v) & 0xF81F) | (((v) >> 16) & 0x07E0)))
+
+static inline uint32_t lerp565(uint32_t a, uint32_t b, uint32_t w)
+{
+    return ((a * (32 - w) + b * w) >> 5) & 0x07E0F81F;
+}
+
+// 출력 좌표 → 원본 16.16 좌표 (픽셀 중심 정렬, 가장자리 고정)
+static int32_t src_pos(int d, int dn, int sn)
+{
+    int32_t p = (int32_t)(((2 * d + 1) * (int64_t)sn << 16) / (2 * dn)) - 32768;
+    if (p < 0) p = 0;
+    if (p > (sn - 1) << 16) p = (sn - 1) << 16;
+    return p;
+}
+
+// 미리보기(sw x sh, 한 줄 stride 픽셀)를 화면 (x, y)에 dw x dh 크기로 쌍선형 확대해 한 줄씩 출력
+static void PreviewDraw(TFT_t *dev, const uint16_t *src, int stride, int sw, int sh,
+                        int x, int y, int dw, int dh)
+{
+    uint16_t *line = malloc(dw * sizeof(uint16_t));
+    int32_t *xs = malloc(dw * sizeof(int32_t));
+    if (!line || !xs) {
+        free(line);
+        free(xs);
+        return;
+    }
+    for (int dx = 0; dx < dw; dx++) xs[dx] = src_pos(dx, dw, sw);
+
+    for (int dy = 0; dy < dh; dy++) {
+        int32_t fy = src_pos(dy, dh, sh);
+        const uint16_t *r0 = &src[(fy >> 16) * stride];
+        const uint16_t *r1 = (fy >> 16) + 1 < sh ? r0 + stride : r0;
+        uint32_t wy = (fy >> 11) & 31;
+        for (int dx = 0; dx < dw; dx++) {
+            int x0 = xs[dx] >> 16;
+            int x1 = x0 + 1 < sw ? x0 + 1 : x0;
+            uint32_t wx = (xs[dx] >> 11) & 31;
+            uint32_t top = lerp565(SPREAD565(r0[x0]), SPREAD565(r0[x1]), wx);
+            uint32_t bot = lerp565(SPREAD565(r1[x0]), SPREAD565(r1[x1]), wx);
+            line[dx] = PACK565(lerp565(top, bot, wy));
+        }
+        lcdDrawMultiPixels(dev, x, y + dy, dw, line);
+    }
+    free(line);
+    free(xs);
+}
+
+#if CONFIG_JPEG_PREVIEW
+// EXIF 썸네일을 미리보기로 사용. 썸네일은 보통 160x120 고정이라
+// 본 이미지와 비율이 다르면 위아래(또는 좌우)의 검은 여백을 잘라냄
+static bool ThumbnailPreview(TFT_t *dev, FILE *fp, const jpeg_exif_t *exif,
+                             jpeg_view_t *view, int w, int h)
+{
+    jpeg_stream_t tjs = {
+        .fp           = fp,
+        .offset       = exif->thumbOffset,
+        .length       = exif->thumbLength,
+        .scale        = -1,
+        .screenWidth  = w,
+        .screenHeight = h,
+        .band_cb      = preview_band,
+        .arg          = view,
+    };
+    if (exif->thumbLength == 0 || decode_jpeg_info(&tjs) != ESP_OK) return false;
+
+    view->pw = tjs.bandWidth;
+    view->ph = tjs.imageHeight < h ? tjs.imageHeight : h;
+    view->preview = malloc(view->pw * view->ph * sizeof(uint16_t));
+    bool ok = view->preview && decode_jpeg_stream(&tjs) == ESP_OK;
+    if (ok) {
+        int cx = 0, cy = 0, cw = view->pw, ch = view->ph;
+        if (cw * h > ch * w) {
+            cw = ch * w / h;
+            cx = (view->pw - cw) / 2;
+        } else {
+            ch = cw * h / w;
+            cy = (view->ph - ch) / 2;
+        }
+        if (cw < 1) cw = 1;
+        if (ch < 1) ch = 1;
+        PreviewDraw(dev, &view->preview[cy * view->pw + cx], view->pw, cw, ch,
+                    view->x, view->y, w, h);
+    }
+    free(view->preview);
+    view->preview = NULL;
+    return ok;
+}
+
+// 1/8 스케일 DC 미리보기
+static bool DCPreview(TFT_t *dev, const jpeg_stream_t *js, jpeg_view_t *view, int w, int h)
+{
+    // 최종 스케일이 이미 1/8이면 미리보기가 곧 결과이므로 생략
+    if (js->scale >= 3 || (js->sourceWidth >> 3) == 0 || (js->sourceHeight >> 3) == 0) return false;
+
+    jpeg_stream_t pjs = *js;
+    pjs.scale = 3;
+    pjs.band_cb = preview_band;
+    pjs.arg = view;
+    view->pw = js->sourceWidth >> 3;
+    view->ph = js->sourceHeight >> 3;
+    view->preview = malloc(view->pw * view->ph * sizeof(uint16_t));
+    bool ok = view->preview && decode_jpeg_stream(&pjs) == ESP_OK;
+    if (ok) {
+        PreviewDraw(dev, view->preview, view->pw, view->pw, view->ph, view->x, view->y, w, h);
+    }
+    free(view->preview);
+    view->preview = NULL;
+    return ok;
+}
+#endif
+
+static void JPEGDisplayProgressive(TFT_t *dev, const char *file)
+{
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "파일을 찾을 수 없음: %s", file);
+        return;
+    }
+
+    // EXIF 방향에 맞춘 화면 크기로 배치
+    jpeg_exif_t exif;
+    decode_jpeg_exif(fp, 0, &exif);
+    uint8_t madctl = exif_madctl[exif.orientation];
+    int sw, sh;
+    ScreenSize(madctl, &sw, &sh);
+
+    jpeg_stream_t js = {
+        .fp           = fp,
+        .scale        = -1,
+        .screenWidth  = sw,
+        .screenHeight = sh,
+    };
+    if (decode_jpeg_info(&js) != ESP_OK) {
+        ESP_LOGE(TAG, "JPEG 헤더 오류: %s", file);
+        fclose(fp);
+        return;
+    }
+
+    int w = js.bandWidth;
+    int h = js.imageHeight < sh ? js.imageHeight : sh;
+    jpeg_view_t view = {
+        .dev = dev,
+        .x   = (sw - w) / 2,
+        .y   = (sh - h) / 2,
+    };
+    lcdSetFontDirection(dev, 0);
+    LcdSetOrientation(dev, madctl);
+    if (exif.orientation != 1) {
+        ESP_LOGI(TAG, "EXIF 방향 %d (MADCTL 0x%02x)", exif.orientation, madctl);
+    }
+
+#if CONFIG_JPEG_PREVIEW
+    int64_t start = esp_timer_get_time();
+    const char *kind = "썸네일";
+    bool drawn = ThumbnailPreview(dev, fp, &exif, &view, w, h);
+    if (!drawn) {
+        kind = "DC";
+        drawn = DCPreview(dev, &js, &view, w, h);
+    }
+    if (drawn) {
+        FillMargins(dev, view.x, view.y, w, h);
+        lcdDrawFinish(dev);
+        ESP_LOGI(TAG, "%s 미리보기 %dx%d → %dx%d (%"PRId64" ms)", kind, view.pw, view.ph, w, h,
+                 (esp_timer_get_time() - start) / 1000);
+    }
+#endif
+
+    // 전체 해상도: 밴드 단위로 화면에 덮어쓰면서 캐시에 기록
+    frame_cache_geom_t geom = cache_geom(file, madctl);
+    frame_cache_t fc;
+    if (frame_cache_create(&fc, file, &geom, view.x, view.y, w, h) == ESP_OK) {
+        view.fc = &fc;
+    }
+    // 재시작 마커가 있으면 두 코어가 MCU 줄을 나눠 디코딩 (없으면 색인은 헤더만 읽고 끝남)
+    jpeg_rst_index_t index;
+    bool indexed = decode_jpeg_index(fp, 0, &index) == ESP_OK;
+    js.band_cb = full_band;
+    js.arg = &view;
+    esp_err_t err = decode_jpeg_parallel(&js, indexed ? &index : NULL);
+    if (indexed) decode_jpeg_index_free(&index);
+    fclose(fp);
+    FillMargins(dev, view.x, view.y, w, h);
+    lcdDrawFinish(dev);
+    LcdSetOrientation(dev, LCD_MADCTL);
 
-    // decode_jpeg(): scrW, scrH 크기로 디코딩하며 imageW, imageH 반환
-    esp_err_t err = decode_jpeg(&pixels, (char *)file, scrW, scrH, &imageW, &imageH);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "JPEG 디코드 실패: %s", file);
+        if (view.fc) frame_cache_abort(view.fc);
+    } else if (view.fc) {
+        frame_cache_commit(view.fc);
+    }
+}
+
+// --------------------------------------------------
+// RLE565 (기기 전용 포맷) 출력: 행 단위로 풀어서 바로 전송, 디코딩 버퍼 불필요
+// --------------------------------------------------
+static void RLEDisplay(TFT_t *dev, const char *file)
+{
+    rle565_t rle;
+    if (rle565_open(&rle, file) != ESP_OK) {
+        ESP_LOGE(TAG, "RLE565 열기 실패: %s", file);
+        return;
+    }
+
+    // 화면보다 크면 중앙 부분만 출력
+    int w = rle.width < scrW ? rle.width : scrW;
+    int h = rle.height < scrH ? rle.height : scrH;
+    int srcX = (rle.width - w) / 2;
+    int srcY = (rle.height - h) / 2;
+    colOffset = (scrW - w) / 2;
+    rowOffset = (scrH - h) / 2;
+
+    uint16_t *row = malloc(rle.width * sizeof(uint16_t));
+    if (!row) {
+        ESP_LOGE(TAG, "행 버퍼 할당 실패");
+        rle565_close(&rle);
         return;
     }
 
-    // 화면 클리어
     lcdSetFontDirection(dev, 0);
-    lcdFillScreen(dev, BLACK);
+    for (int y = 0; y < h; y++) {
+        if (rle565_read_row(&rle, srcY + y, row) != ESP_OK) {
+            ESP_LOGE(TAG, "RLE565 행 %d 손상: %s", srcY + y, file);
+            break;
+        }
+        lcdDrawMultiPixels(dev, colOffset, rowOffset + y, w, row + srcX);
+    }
+    FillMargins(dev, colOffset, rowOffset, w, h);
+    lcdDrawFinish(dev);
 
-    // 이미지 픽셀 버퍼(pixels[y][x])를 화면 중앙에 스케일 없이 렌더링
-    // 이미 decode_jpeg() 단계에서 적절히 스케일링이 적용되었으므로 그 상태 그대로 출력
-    colOffset = (scrW - imageW) / 2;
-    rowOffset = (scrH - imageH) / 2;
-    if (colOffset < 0) colOffset = 0;
-    if (rowOffset < 0) rowOffset = 0;
+    free(row);
+    rle565_close(&rle);
+}
+
+// --------------------------------------------------
+// BMP 헤더 읽기: 구조체가 packed가 아니므로 필드 단위로 읽음
+// --------------------------------------------------
+static bool bmp_read_header(FILE *fp, bmpfile_t *bmp, uint32_t masks[3])
+{
+    if (fread(bmp->header.magic, 1, 2, fp) != 2) return false;
+    if (bmp->header.magic[0] != 'B' || bmp->header.magic[1] != 'M') return false;
+    if (fread(&bmp->header.filesz,   4, 1, fp) != 1) return false;
+    if (fread(&bmp->header.creator1, 2, 1, fp) != 1) return false;
+    if (fread(&bmp->header.creator2, 2, 1, fp) != 1) return false;
+    if (fread(&bmp->header.offset,   4, 1, fp) != 1) return false;
+
+    if (fread(&bmp->dib.header_sz,     4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.width,         4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.height,        4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.nplanes,       2, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.depth,         2, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.compress_type, 4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.bmp_bytesz,    4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.hres,          4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.vres,          4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.ncolors,       4, 1, fp) != 1) return false;
+    if (fread(&bmp->dib.nimpcolors,    4, 1, fp) != 1) return false;
+
+    // BI_BITFIELDS 마스크: v3 헤더 바로 뒤, v4/v5 헤더는 같은 위치에 포함
+    masks[0] = masks[1] = masks[2] = 0;
+    if (bmp->dib.compress_type == 3) {
+        if (fread(masks, 4, 3, fp) != 3) return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------
+// BMP 처리: 16비트(RGB565/RGB555) 및 24비트 BMP를 디코딩 없이
+// 한 줄씩 읽어서 그대로 LCD 윈도우에 전송 (스케일 없음, 중앙 정렬·잘라내기)
+// --------------------------------------------------
+static void BMPDisplaySimple(TFT_t *dev, const char *file)
+{
+    FILE *fp = fopen(file, "rb");
+    if (!fp) {
+        ESP_LOGE(TAG, "파일을 찾을 수 없음: %s", file);
+        return;
+    }
+
+    bmpfile_t bmp;
+    uint32_t masks[3];
+    if (!bmp_read_header(fp, &bmp, masks)) {
+        ESP_LOGE(TAG, "BMP 헤더 오류: %s", file);
+        fclose(fp);
+        return;
+    }
+
+    // compress_type: 0 = BI_RGB, 3 = BI_BITFIELDS
+    bool rgb565 = false;
+    if (bmp.dib.depth == 16 && bmp.dib.compress_type == 3) {
+        if (masks[0] == 0xF800 && masks[1] == 0x07E0 && masks[2] == 0x001F) {
+            rgb565 = true;
+        } else if (!(masks[0] == 0x7C00 && masks[1] == 0x03E0 && masks[2] == 0x001F)) {
+            ESP_LOGE(TAG, "지원하지 않는 16비트 마스크: %08"PRIx32" %08"PRIx32" %08"PRIx32,
+                     masks[0], masks[1], masks[2]);
+            fclose(fp);
+            return;
+        }
+    } else if (!((bmp.dib.depth == 16 || bmp.dib.depth == 24) && bmp.dib.compress_type == 0)) {
+        ESP_LOGE(TAG, "지원하지 않는 BMP 형식: depth=%d compress=%"PRIu32,
+                 bmp.dib.depth, bmp.dib.compress_type);
+        fclose(fp);
+        return;
+    }
+
+    // height가 음수면 top-down, 양수면 bottom-up 저장
+    int32_t rawH = (int32_t)bmp.dib.height;
+    bool bottomUp = rawH > 0;
+    int imageW = (int)bmp.dib.width;
+    int imageH = bottomUp ? rawH : -rawH;
+    // 각 행은 4바이트 경계로 패딩됨
+    if (imageW <= 0 || imageH <= 0) {
+        ESP_LOGE(TAG, "잘못된 BMP 크기: %dx%d", imageW, imageH);
+        fclose(fp);
+        return;
+    }
+    size_t stride = ((size_t)imageW * bmp.dib.depth + 31) / 32 * 4;
+    ESP_LOGI(TAG, "BMP %dx%d depth=%d %s", imageW, imageH, bmp.dib.depth,
+             bottomUp ? "bottom-up" : "top-down");
+
+    // 화면보다 크면 가운데를 잘라내고, 작으면 중앙 정렬
+    int drawW = imageW < scrW ? imageW : scrW;
+    int drawH = imageH < scrH ? imageH : scrH;
+    int srcX = (imageW - drawW) / 2;
+    int srcY = (imageH - drawH) / 2;
+    colOffset = (scrW - drawW) / 2;
+    rowOffset = (scrH - drawH) / 2;
+
+    uint8_t *line = malloc(stride);
+    uint16_t *colors = malloc(drawW * sizeof(uint16_t));
+    if (!line || !colors) {
+        ESP_LOGE(TAG, "BMP 라인 버퍼 할당 실패");
+        free(line);
+        free(colors);
+        fclose(fp);
+        return;
+    }
+
+    lcdSetFontDirection(dev, 0);
+
+    // 파일 순서대로 한 줄씩 읽음 (bottom-up이면 아래 줄부터)
+    fseek(fp, bmp.header.offset, SEEK_SET);
+    for (int i = 0; i < imageH; i++) {
+        int y = bottomUp ? (imageH - 1 - i) : i;
+        if (y < srcY || y >= srcY + drawH) {
+            fseek(fp, stride, SEEK_CUR);
+            continue;
+        }
+        if (fread(line, 1, stride, fp) != stride) {
+            ESP_LOGE(TAG, "BMP 데이터가 잘렸음: row=%d", i);
+            break;
+        }
+
+        if (bmp.dib.depth == 24) {
+            const uint8_t *p = line + srcX * 3;
+            for (int x = 0; x < drawW; x++, p += 3) {
+                colors[x] = rgb565(p[2], p[1], p[0]);  // BGR 순서
+            }
+        } else if (rgb565) {
+            // 사전 변환된 RGB565: 리틀엔디언 그대로 복사
+            memcpy(colors, line + srcX * 2, drawW * sizeof(uint16_t));
+        } else {
+            const uint8_t *p = line + srcX * 2;
+            for (int x = 0; x < drawW; x++, p += 2) {
+                uint16_t v = p[0] | (p[1] << 8);  // X1R5G5B5
+                colors[x] = ((v & 0x7FE0) << 1) | ((v & 0x0200) >> 4) | (v & 0x001F);
+            }
+        }
+        lcdDrawMultiPixels(dev, colOffset, rowOffset + (y - srcY), drawW, colors);
+    }
+    FillMargins(dev, colOffset, rowOffset, drawW, drawH);
+    lcdDrawFinish(dev);
+
+    free(line);
+    free(colors);
+    fclose(fp);
+}
+
+// --------------------------------------------------
+// 동영상(MJPEG) 파일인지 확장자로 판별 (".avi", ".mjpg", ".mjpeg")
+// --------------------------------------------------
+static bool IsVideoName(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+    return ext && (strcasecmp(ext, ".avi") == 0 ||
+                   strcasecmp(ext, ".mjpg") == 0 ||
+                   strcasecmp(ext, ".mjpeg") == 0);
+}
+
+// --------------------------------------------------
+// 표시 가능한 이미지 파일인지 확장자로 판별
+// (".png", ".jpg", ".jpeg", ".bmp", ".rle" 및 동영상, 대소문자 무시)
+// --------------------------------------------------
+static bool IsImageName(const char *name)
+{
+    size_t len = strlen(name);
+    if (len < 4) return false;
+    const char *ext = &name[len - 4];
+    return strcasecmp(ext, ".png") == 0 ||
+           strcasecmp(ext, ".jpg") == 0 ||
+           strcasecmp(ext, ".bmp") == 0 ||
+           strcasecmp(ext, ".rle") == 0 ||
+           (len >= 5 && strcasecmp(&name[len - 5], ".jpeg") == 0) ||
+           IsVideoName(name);
+}
+
+// --------------------------------------------------
+// 이미지 변경 이벤트: 파일 서버가 업로드/삭제할 때 큐에 넣고,
+// 디스플레이 태스크는 큐에서 기다림 (디렉토리를 주기적으로 스캔하지 않음)
+// --------------------------------------------------
+#define IMAGE_EVENT_QUEUE_LEN 8
+
+static QueueHandle_t image_events;
+static volatile bool image_events_lost;    // 큐가 넘쳐 버린 이벤트가 있음 → 디렉토리를 한 번 다시 읽음
+
+// 파일 서버 태스크에서 호출. 디스플레이가 밀려 있어도 업로드를 붙잡지 않음
+void image_event_post(image_event_type_t type, const char *path, uint32_t size)
+{
+    if (!image_events) return;
+    image_event_t ev = { .type = type, .size = size };
+    strlcpy(ev.path, path, sizeof(ev.path));
+    if (xQueueSend(image_events, &ev, 0) != pdPASS) {
+        ESP_LOGW(TAG, "이벤트 큐가 가득 참, 나중에 디렉토리를 다시 읽음: %s", path);
+        image_events_lost = true;
+    }
+}
+
+static bool ImageEventPending(void)
+{
+    return image_events_lost || uxQueueMessagesWaiting(image_events) > 0;
+}
+
+// --------------------------------------------------
+// 동영상 재생: 지정 시간(0이면 다음 이벤트가 올 때까지) 반복 재생
+// --------------------------------------------------
+typedef struct {
+    int64_t until;          // 0 = 시간 제한 없음
+    int64_t next_check;
+} video_stop_t;
+
+// 1초마다 충전 상태 갱신. 시간 제한이 없으면 이미지가 바뀔 때(이벤트 도착) 멈춤
+static bool video_should_stop(void *arg)
+{
+    video_stop_t *vs = arg;
+    int64_t now = esp_timer_get_time();
+    if (vs->until) {
+        if (now >= vs->until) return true;
+    } else if (ImageEventPending()) {
+        return true;
+    }
+    if (now < vs->next_check) return false;
+    vs->next_check = now + 1000000;
+    charging_indicator_update();
+    return false;
+}
+
+static void VideoPlay(TFT_t *dev, const char *file, uint32_t duration_ms)
+{
+    video_stop_t vs = {
+        .until = duration_ms ? esp_timer_get_time() + duration_ms * 1000LL : 0,
+    };
+    mjpeg_config_t cfg = {
+        .screenWidth  = scrW,
+        .screenHeight = scrH,
+        .fps          = CONFIG_VIDEO_FPS,
+        .scale        = -1,
+        .loop         = true,
+        .stop         = video_should_stop,
+        .stop_arg     = &vs,
+    };
+    mjpeg_stats_t stats;
+    lcdSetFontDirection(dev, 0);
+    esp_err_t err = mjpeg_play(dev, file, &cfg, &stats);
+    ESP_LOGI(TAG, "동영상 종료 %s: %s, %"PRIu32" 프레임 표시, %"PRIu32" 프레임 건너뜀",
+             file, esp_err_to_name(err), stats.frames, stats.dropped);
+}
 
-    for (int y = 0; y < imageH; y++) {
-        for (int x = 0; x < imageW; x++) {
-            int dispX = colOffset + x;
-            int dispY = rowOffset + y;
-            lcdDrawPixel(dev, dispX, dispY, pixels[y][x]);
+// --------------------------------------------------
+// 이미지 한 장 출력
+// RLE565는 확장자와 무관하게 매직 바이트로 판별,
+// 그 외에는 확장자에 따라 동영상, BMP 또는 PNG/JPEG(캐시 → 디코딩) 분기
+// 동영상은 다음 이벤트가 올 때까지 반복 재생
+// --------------------------------------------------
+static void ImageDisplay(TFT_t *dev, const char *file)
+{
+    const char *ext = strrchr(file, '.');
+    if (rle565_is_file(file)) {
+        RLEDisplay(dev, file);
+    } else if (IsVideoName(file)) {
+        VideoPlay(dev, file, 0);
+    } else if (!ext) {
+        return;
+    } else if (strcasecmp(ext, ".bmp") == 0) {
+        BMPDisplaySimple(dev, file);
+    } else if (strcasecmp(ext, ".rle") == 0) {
+        ESP_LOGE(TAG, "RLE565 헤더가 올바르지 않습니다: %s", file);
+    } else if (strcasecmp(ext, ".png") == 0) {
+        frame_t frame;
+        if (FrameLoad(file, &frame, dev) == ESP_OK) {
+            FrameFlush(dev, &frame);
+            FrameRelease(&frame);
+        }
+    } else {
+        // .jpg 또는 .jpeg: 캐시가 없으면 미리보기 후 밴드 단위로 디코딩
+        frame_t frame;
+        if (CacheLoad(file, &frame, JpegMadctl(file)) == ESP_OK) {
+            FrameFlush(dev, &frame);
+            FrameRelease(&frame);
+        } else {
+            JPEGDisplayProgressive(dev, file);
         }
     }
+}
+
+// --------------------------------------------------
+// 업로드 실시간 표시: 파일 서버가 받은 바이트를 파일에 쓰는 동시에 스트림 버퍼로 넘기면
+// 디스플레이 태스크가 도착하는 대로 디코딩해 그림 (업로드가 끝날 때 이미 화면에 있음)
+// PNG는 디코더가 입력을 기다릴 때마다 완성된 행을, JPEG는 MCU 줄마다 밴드를 출력
+// 실패하면 나머지 바이트는 버리고, 파일은 업로드 완료 이벤트에서 평소처럼 표시
+// (업로드 자체가 실패했으면 기존 파일이 그대로 있으므로 그것을 다시 표시)
+// --------------------------------------------------
+#define LIVE_BUFSIZE       (16 * 1024)  // 파일 서버 청크(8 KB) 두 개
+#define LIVE_FEED_WAIT_MS  2000         // 디스플레이가 이만큼 받아 가지 않으면 실시간 표시 포기
+#define LIVE_POLL_MS       20           // 데이터를 기다리며 업로드 종료를 확인하는 간격
+
+static struct {
+    StreamBufferHandle_t sb;
+    char path[256];
+    volatile bool busy;         // live_upload_begin() ~ 디스플레이 태스크가 정리할 때까지
+    volatile bool ended;        // live_upload_end() 호출됨
+    volatile bool ok;           // 업로드 성공 (ended 이후 유효)
+    volatile bool dropped;      // 포기: 파일 서버는 더 보내지 않고, 디코더는 끝으로 봄
+    int drawn;                  // 화면에 그린 PNG 출력 행 수
+} live;
+
+bool live_upload_begin(const char *filepath)
+{
+#if CONFIG_SLIDESHOW
+    return false;  // 슬라이드쇼는 재생 목록 순서대로 표시
+#else
+    // 직전 업로드를 디스플레이 태스크가 아직 정리 중이면 잠깐 기다림
+    for (int i = 0; live.busy && i < 10; i++) vTaskDelay(pdMS_TO_TICKS(10));
+    const char *ext = strrchr(filepath, '.');
+    if (!live.sb || live.busy || !ext || strlen(filepath) >= sizeof(live.path)) return false;
+    if (strcasecmp(ext, ".png") != 0 && strcasecmp(ext, ".jpg") != 0 &&
+        strcasecmp(ext, ".jpeg") != 0) {
+        return false;
+    }
+    strcpy(live.path, filepath);
+    xStreamBufferReset(live.sb);
+    live.ended = live.ok = live.dropped = false;
+    live.busy = true;
+
+    // 시작 이벤트를 못 넣으면 받아 갈 태스크가 없으므로 실시간 표시 안 함
+    image_event_t ev = { .type = IMAGE_EVENT_RECEIVING };
+    strlcpy(ev.path, filepath, sizeof(ev.path));
+    if (xQueueSend(image_events, &ev, 0) != pdPASS) {
+        live.busy = false;
+        return false;
+    }
+    return true;
+#endif
+}
+
+void live_upload_feed(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0 && !live.dropped) {
+        size_t n = xStreamBufferSend(live.sb, p, len, pdMS_TO_TICKS(LIVE_FEED_WAIT_MS));
+        if (n == 0) {
+            ESP_LOGW(TAG, "디스플레이가 업로드를 따라오지 못해 실시간 표시 포기");
+            live.dropped = true;
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+void live_upload_end(bool ok)
+{
+    live.ok = ok;
+    live.ended = true;
+}
+
+// 도착한 만큼 읽음 (최소 1바이트, 업로드가 끝났거나 포기했으면 0)
+static size_t live_read_some(uint8_t *buf, size_t len)
+{
+    while (!live.dropped) {
+        size_t n = xStreamBufferReceive(live.sb, buf, len, pdMS_TO_TICKS(LIVE_POLL_MS));
+        if (n > 0) return n;
+        if (live.ended && xStreamBufferIsEmpty(live.sb)) break;
+    }
+    return 0;
+}
+
+// tjpgd 입력: len 바이트를 다 채울 때까지 기다림 (buf NULL이면 건너뜀)
+static size_t live_read_jpeg(void *arg, uint8_t *buf, size_t len)
+{
+    uint8_t skip[256];
+    size_t got = 0;
+    while (got < len) {
+        size_t n = buf ? live_read_some(buf + got, len - got)
+                       : live_read_some(skip, MIN(len - got, sizeof(skip)));
+        if (n == 0) break;
+        got += n;
+    }
+    return got;
+}
+
+// 완성됐지만 아직 그리지 않은 출력 행을 그림 (처음 그릴 때 이전 그림의 여백도 지움)
+static void LiveRows(TFT_t *dev, uint16_t **rows, int w, int h, int upto)
+{
+    if (!rows || upto <= live.drawn) return;
+    if (live.drawn == 0) FillMargins(dev, colOffset, rowOffset, w, h);
+    for (; live.drawn < upto; live.drawn++) {
+        lcdDrawMultiPixels(dev, colOffset, rowOffset + live.drawn, w, rows[live.drawn]);
+    }
+    lcdDrawFinish(dev);
+}
+
+// pngle 입력: 다음 바이트를 기다리기 전에 그때까지 완성된 행을 출력
+static size_t live_read_png(void *arg, uint8_t *buf, size_t len)
+{
+    if (pngCur && pngRowsDone > 0) {
+        LiveRows(arg, pngCur->pixels, pngCur->imageWidth, pngCur->imageHeight, pngRowsDone);
+    }
+    return live_read_some(buf, len);
+}
+
+static esp_err_t LivePNG(TFT_t *dev, frame_t *f)
+{
+    live.drawn = 0;
+    esp_err_t err = PNGDecode(live_read_png, dev, true, f, dev);
+    if (err != ESP_OK) return err;
+    if (pngRowsDone < 0) {
+        FrameFlush(dev, f);  // 인터레이스: 마지막 패스는 아직 화면에 없음
+    } else {
+        LiveRows(dev, f->rows, f->w, f->h, f->h);
+    }
+    return ESP_OK;
+}
+
+// 이미지 크기는 헤더를 읽은 뒤에야 알 수 있어 첫 밴드에서 가운데 배치
+static bool live_band(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band)
+{
+    jpeg_view_t *v = js->arg;
+    if (v->w == 0) {
+        v->w = js->bandWidth;
+        v->h = js->imageHeight < js->screenHeight ? js->imageHeight : js->screenHeight;
+        v->x = (js->screenWidth - v->w) / 2;
+        v->y = (js->screenHeight - v->h) / 2;
+        FillMargins(v->dev, v->x, v->y, v->w, v->h);
+    }
+    return full_band(js, top, height, band);
+}
+
+// EXIF 방향은 다시 읽을 수 없는 스트림에서는 알 수 없어 기본 방향으로 그림
+static esp_err_t LiveJPEG(TFT_t *dev)
+{
+    jpeg_view_t view = { .dev = dev };
+    jpeg_stream_t js = {
+        .read         = live_read_jpeg,
+        .scale        = -1,
+        .screenWidth  = scrW,
+        .screenHeight = scrH,
+        .band_cb      = live_band,
+        .arg          = &view,
+    };
+    esp_err_t err = decode_jpeg_stream(&js);
     lcdDrawFinish(dev);
+    return err;
+}
+
+// 업로드가 진행 중이면 끝날 때까지 받는 대로 표시. 제대로 표시했으면 last_path 갱신,
+// 실패했으면 화면에 일부만 남았으므로 비움
+static bool LiveDisplay(TFT_t *dev, char *last_path, size_t size)
+{
+    if (!live.busy) return false;
+    ESP_LOGI(TAG, "업로드 실시간 표시: %s", live.path);
+    int64_t start = esp_timer_get_time();
+    const char *ext = strrchr(live.path, '.');
+    bool png = strcasecmp(ext, ".png") == 0;
+    frame_t frame = { 0 };
+    lcdSetFontDirection(dev, 0);
+    esp_err_t err = png ? LivePNG(dev, &frame) : LiveJPEG(dev);
+    int64_t drawn = esp_timer_get_time();
+
+    // 디코더가 읽지 않은 나머지(IEND/EOI 뒤 등)는 버리고 업로드 결과를 기다림
+    if (err != ESP_OK) live.dropped = true;
+    uint8_t skip[256];
+    while (!live.ended || !xStreamBufferIsEmpty(live.sb)) {
+        xStreamBufferReceive(live.sb, skip, sizeof(skip), pdMS_TO_TICKS(LIVE_POLL_MS));
+    }
+
+    // 스트림은 여기까지: 다음 업로드는 바로 시작할 수 있음
+    bool shown = err == ESP_OK && live.ok;
+    if (shown) {
+        ESP_LOGI(TAG, "업로드 실시간 표시 완료: %s (%"PRId64" ms, 업로드 종료까지 %"PRId64" ms)",
+                 live.path, (drawn - start) / 1000, (esp_timer_get_time() - start) / 1000);
+        strlcpy(last_path, live.path, size);
+    } else {
+        ESP_LOGW(TAG, "업로드 실시간 표시 실패: %s (%s)", live.path,
+                 err != ESP_OK ? esp_err_to_name(err) : "업로드 실패");
+        last_path[0] = '\0';
+    }
+    live.busy = false;
+
+    if (shown && png) CacheStore(last_path, &frame);
+    FrameRelease(&frame);
+    // JPEG의 EXIF 방향은 파일이 다 저장된 뒤에 읽어서, 회전이 필요하면 다시 표시
+    if (shown && !png && JpegMadctl(last_path) != LCD_MADCTL) {
+        ImageDisplay(dev, last_path);
+    }
+    return shown;
+}
+
+// --------------------------------------------------
+// 디렉토리의 첫 번째 이미지 파일을 표시 (없으면 화면을 지움)
+// 부팅 시와, 표시 중인 파일이 지워졌거나 이벤트를 놓쳤을 때만 디렉토리를 읽음
+// --------------------------------------------------
+static void ShowFirstImage(TFT_t *dev, const char *images_dir, char *last_path, size_t size)
+{
+    DIR *dir = opendir(images_dir);
+    if (!dir) {
+        ESP_LOGE(TAG, "디렉토리 열기 실패: %s", images_dir);
+        return;
+    }
+    struct dirent *entry;
+    bool found = false;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || !IsImageName(entry->d_name)) continue;
+        if (snprintf(last_path, size, "%s/%s", images_dir, entry->d_name) < size) {
+            found = true;
+            break;
+        }
+    }
+    closedir(dir);
+
+    if (found) {
+        ESP_LOGI(TAG, "New image detected: %s", last_path);
+        ImageDisplay(dev, last_path);
+    } else {
+        ESP_LOGW(TAG, "이미지 파일이 없습니다: %s", images_dir);
+        last_path[0] = '\0';
+        lcdFillScreen(dev, BLACK);
+        lcdDrawFinish(dev);
+    }
+}
+
+#if CONFIG_SLIDESHOW
+// --------------------------------------------------
+// 슬라이드쇼: /images/playlist.txt 순서(없으면 파일 이름 순)로 반복 출력
+// 현재 슬라이드가 떠 있는 동안 프리페치 태스크가 다음 장을 프레임으로 디코딩해 두고,
+// 전환 시에는 프레임 전송만 수행
+// --------------------------------------------------
+#define PLAYLIST_FILE "playlist.txt"
+#define PLAYLIST_MAX  32
+
+typedef struct {
+    char path[64];
+    uint32_t dwell_ms;
+} slide_t;
+
+static int slide_cmp(const void *a, const void *b)
+{
+    return strcmp(((const slide_t *)a)->path, ((const slide_t *)b)->path);
+}
+
+// playlist.txt 형식: 한 줄에 "파일이름 [표시 시간(초)]", '#'으로 시작하면 주석
+static int PlaylistLoad(const char *dirpath, slide_t *slides, int max)
+{
+    char path[64];
+    char line[96];
+    int n = 0;
+    struct stat st;
+
+    snprintf(path, sizeof(path), "%s/%s", dirpath, PLAYLIST_FILE);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+        while (n < max && fgets(line, sizeof(line), fp)) {
+            char name[40];
+            unsigned sec = CONFIG_SLIDESHOW_DWELL_SEC;
+            if (line[0] == '#' || sscanf(line, "%39s %u", name, &sec) < 1) continue;
+            if (!IsImageName(name)) continue;
+            snprintf(slides[n].path, sizeof(slides[n].path), "%s/%s", dirpath, name);
+            if (stat(slides[n].path, &st) != 0) {
+                ESP_LOGW(TAG, "재생 목록의 파일이 없음: %s", name);
+                continue;
+            }
+            slides[n].dwell_ms = (sec ? sec : 1) * 1000;
+            n++;
+        }
+        fclose(fp);
+        return n;
+    }
+
+    DIR *dir = opendir(dirpath);
+    if (!dir) return 0;
+    struct dirent *entry;
+    while (n < max && (entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || !IsImageName(entry->d_name)) continue;
+        if (snprintf(slides[n].path, sizeof(slides[n].path), "%s/%s",
+                     dirpath, entry->d_name) >= sizeof(slides[n].path)) continue;
+        slides[n].dwell_ms = CONFIG_SLIDESHOW_DWELL_SEC * 1000;
+        n++;
+    }
+    closedir(dir);
+    qsort(slides, n, sizeof(slide_t), slide_cmp);
+    return n;
+}
+
+static struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t done;
+    bool busy;
+    char path[64];
+    frame_t frame;
+    esp_err_t err;
+} prefetch;
+
+static void prefetch_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        prefetch.err = FrameLoad(prefetch.path, &prefetch.frame, NULL);
+        ESP_LOGI(TAG, "프리페치 %s: %s (%"PRId64" ms)", prefetch.path,
+                 esp_err_to_name(prefetch.err), (esp_timer_get_time() - start) / 1000);
+        xSemaphoreGive(prefetch.done);
+    }
+}
+
+// RLE565/BMP/동영상은 행 단위 스트리밍이라 프레임으로 준비하지 않음
+static bool IsStreamedImage(const char *file)
+{
+    const char *ext = strrchr(file, '.');
+    return rle565_is_file(file) || IsVideoName(file) ||
+           (ext && (strcasecmp(ext, ".bmp") == 0 || strcasecmp(ext, ".rle") == 0));
+}
 
-    // 메모리 해제
-    release_image(&pixels, scrW, scrH);
+static void PrefetchStart(const char *file)
+{
+    if (prefetch.busy || IsStreamedImage(file)) return;
+    strlcpy(prefetch.path, file, sizeof(prefetch.path));
+    prefetch.busy = true;
+    xTaskNotifyGive(prefetch.task);
+}
+
+// 프리페치 결과를 넘겨받음. 다른 파일이었거나 실패했으면 false
+static bool PrefetchTake(const char *file, frame_t *f)
+{
+    if (!prefetch.busy) return false;
+    xSemaphoreTake(prefetch.done, portMAX_DELAY);
+    prefetch.busy = false;
+    if (prefetch.err == ESP_OK && strcmp(prefetch.path, file) == 0) {
+        *f = prefetch.frame;
+        memset(&prefetch.frame, 0, sizeof(prefetch.frame));
+        return true;
+    }
+    FrameRelease(&prefetch.frame);
+    return false;
+}
+
+// 해당 파일을 준비 중이었으면 결과를 버림 (파일이 바뀌었거나 지워짐)
+static void PrefetchDiscard(const char *file)
+{
+    frame_t f;
+    if (prefetch.busy && strcmp(prefetch.path, file) == 0 && PrefetchTake(file, &f)) {
+        FrameRelease(&f);
+    }
+}
+
+// 표시 시간 동안 1초 단위로 충전 상태 갱신.
+// 0이면 이벤트가 올 때까지 대기 (표시 시간은 이벤트로 끊지 않음)
+static void SlideWait(uint32_t dwell_ms)
+{
+    image_event_t ev;
+    bool forever = dwell_ms == 0;
+    while (forever || dwell_ms > 0) {
+        uint32_t ms = forever || dwell_ms > 1000 ? 1000 : dwell_ms;
+        if (forever) {
+            if (image_events_lost || xQueuePeek(image_events, &ev, pdMS_TO_TICKS(ms)) == pdPASS) return;
+        } else {
+            vTaskDelay(pdMS_TO_TICKS(ms));
+            dwell_ms -= ms;
+        }
+        charging_indicator_update();
+    }
+}
+
+// 밀린 이벤트를 처리. 재생 목록을 다시 읽어야 하면 true
+// 바뀐 파일이 지금 화면에 있거나 프리페치 중이었으면 다시 표시/디코딩되도록 잊음
+static bool SlideEvents(char *shown)
+{
+    bool reload = image_events_lost;
+    image_events_lost = false;
+    image_event_t ev;
+    while (xQueueReceive(image_events, &ev, 0) == pdPASS) {
+        if (ev.type == IMAGE_EVENT_RECEIVING) continue;  // 완료/실패 이벤트가 뒤따름
+        ESP_LOGI(TAG, "이미지 변경: %s", ev.path);
+        if (strcmp(ev.path, shown) == 0) shown[0] = '\0';
+        PrefetchDiscard(ev.path);
+        reload = true;
+    }
+    return reload;
+}
+
+static void SlideShow(TFT_t *dev, const char *images_dir)
+{
+    slide_t *slides = calloc(PLAYLIST_MAX, sizeof(slide_t));
+    prefetch.done = xSemaphoreCreateBinary();
+    if (!slides || !prefetch.done ||
+        xTaskCreate(prefetch_task, "PREFETCH", 8 * 1024, NULL, 1, &prefetch.task) != pdPASS) {
+        // 화면이 비지 않도록 한 장 표시 모드로 돌아감
+        ESP_LOGE(TAG, "슬라이드쇼 초기화 실패, 한 장 표시 모드로 동작");
+        free(slides);
+        if (prefetch.done) vSemaphoreDelete(prefetch.done);
+        prefetch.done = NULL;
+        return;
+    }
+
+    char shown[64] = {0};
+    int cur = -1;
+    int n = 0;
+    bool reload = true;
+    while (1) {
+        charging_indicator_update();  // 충전 중이면 백라이트 OFF
+
+        // 재생 목록은 파일이 바뀌었을 때만 다시 읽음
+        if (SlideEvents(shown)) reload = true;
+        if (reload) {
+            n = PlaylistLoad(images_dir, slides, PLAYLIST_MAX);
+            reload = false;
+        }
+        if (n == 0) {
+            ESP_LOGW(TAG, "이미지 파일이 없습니다: %s", images_dir);
+            shown[0] = '\0';
+            SlideWait(0);
+            continue;
+        }
+
+        // 이미지가 한 장뿐이면 바뀌었을 때만 다시 출력
+        cur = (cur + 1) % n;
+        if (n == 1 && strcmp(slides[0].path, shown) == 0) {
+            SlideWait(0);
+            continue;
+        }
+
+        frame_t frame;
+        if (PrefetchTake(slides[cur].path, &frame)) {
+            FrameFlush(dev, &frame);
+            FrameRelease(&frame);
+        } else if (IsVideoName(slides[cur].path)) {
+            // 동영상은 표시 시간 동안 반복 재생. JPEG 작업 버퍼를 같이 쓰므로
+            // 재생 중에는 프리페치하지 않음
+            VideoPlay(dev, slides[cur].path, slides[cur].dwell_ms);
+            strlcpy(shown, slides[cur].path, sizeof(shown));
+            continue;
+        } else {
+            ImageDisplay(dev, slides[cur].path);
+        }
+        strlcpy(shown, slides[cur].path, sizeof(shown));
+
+        // 현재 슬라이드가 떠 있는 동안 다음 장을 준비
+        if (n > 1) {
+            PrefetchStart(slides[(cur + 1) % n].path);
+        }
+        SlideWait(slides[cur].dwell_ms);
+    }
 }
+#endif // CONFIG_SLIDESHOW
 
 // --------------------------------------------------
-// ST7789 태스크: /images에서 첫 번째 이미지 파일 찾아서 계속 갱신
+// ST7789 태스크: /images의 첫 번째 이미지 파일을 표시하고, 파일 서버 이벤트가 오면 갱신
+// (CONFIG_SLIDESHOW이면 슬라이드쇼로 동작)
 // --------------------------------------------------
 void ST7789(void *pvParameters)
 {
@@ -298,7 +1634,7 @@ void ST7789(void *pvParameters)
 
     // ① MADCTL: 90° 회전 (MV=1, MX=1, MY=0)
     spi_master_write_command(&dev, 0x36);
-    spi_master_write_data_byte(&dev, 0x60);
+    spi_master_write_data_byte(&dev, LCD_MADCTL);
 
 #if CONFIG_INVERSION
     ESP_LOGI(TAG, "디스플레이 반전 해제");
@@ -310,71 +1646,62 @@ void ST7789(void *pvParameters)
     scrH = CONFIG_WIDTH;   // 예: 240 → 320
 
     const char *images_dir = "/images";
-    DIR *dir;
-    struct dirent *entry;
-    char found_path[256];
+#if CONFIG_SLIDESHOW
+    SlideShow(&dev, images_dir);  // 초기화에 실패했을 때만 돌아옴
+#endif
+    live.sb = xStreamBufferCreate(LIVE_BUFSIZE, 1);
+    if (!live.sb) ESP_LOGW(TAG, "스트림 버퍼 할당 실패, 업로드 실시간 표시 안 함");
     char last_path[256] = {0};
+    char live_shown[64] = {0};     // 실시간으로 이미 표시한 업로드 (완료 이벤트는 건너뜀)
 
+    struct stat st;
+
+    ShowFirstImage(&dev, images_dir, last_path, sizeof(last_path));
     while (1) {
         charging_indicator_update();  // 충전 중이면 백라이트 OFF
 
-        vTaskDelay(pdMS_TO_TICKS(1000));  // 1초마다 스캔
-
-        ESP_LOGI(TAG, "Update Charging Status");
-        dir = opendir(images_dir);
-        if (!dir) {
-            ESP_LOGE(TAG, "디렉토리 열기 실패: %s", images_dir);
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            continue;
+        // 버린 이벤트가 있으면 화면이 맞는지 알 수 없으므로 디렉토리를 다시 읽음
+        if (image_events_lost && uxQueueMessagesWaiting(image_events) == 0) {
+            image_events_lost = false;
+            ShowFirstImage(&dev, images_dir, last_path, sizeof(last_path));
+        }
+        // 동영상은 다른 파일의 이벤트로 멈췄으면 이어서 재생
+        if (IsVideoName(last_path) && !ImageEventPending()) {
+            ImageDisplay(&dev, last_path);
         }
 
-        bool found = false;
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_type != DT_REG) continue;
-            const char *name = entry->d_name;
-            size_t len = strlen(name);
-            if (len < 4) continue;
-            const char *ext = &name[len - 4];
-
-            // 확장자 판별 (".png", ".jpg", ".jpeg" 대소문자 무시)
-            if (strcasecmp(ext, ".png") == 0 ||
-                strcasecmp(ext, ".jpg") == 0 ||
-                (len >= 5 && strcasecmp(&name[len - 5], ".jpeg") == 0)) {
-
-                size_t dlen = strlen(images_dir);
-                if (dlen + 1 + len + 1 <= sizeof(found_path)) {
-                    memcpy(found_path, images_dir, dlen);
-                    found_path[dlen] = '/';
-                    memcpy(found_path + dlen + 1, name, len);
-                    found_path[dlen + 1 + len] = '\0';
-                    found = true;
-                    break;
-                }
+        image_event_t ev;
+        if (xQueueReceive(image_events, &ev, pdMS_TO_TICKS(1000)) != pdPASS) continue;
+
+        switch (ev.type) {
+        case IMAGE_EVENT_RECEIVING:
+            live_shown[0] = '\0';
+            if (LiveDisplay(&dev, last_path, sizeof(last_path))) {
+                strlcpy(live_shown, last_path, sizeof(live_shown));
+            } else if (!live.ok) {
+                // 업로드 실패: 파일은 그대로이므로 그리다 만 화면을 기존 이미지로 되돌림
+                ShowFirstImage(&dev, images_dir, last_path, sizeof(last_path));
             }
-        }
-        closedir(dir);
-
-        if (found) {
-            if (strcmp(found_path, last_path) != 0) {
-                ESP_LOGI(TAG, "New image detected: %s", found_path);
-                strncpy(last_path, found_path, sizeof(last_path));
-
-                // 확장자에 따라 PNG/ JPEG 분기
-                const char *ext = strrchr(found_path, '.');
-                if (ext) {
-                    if (strcasecmp(ext, ".png") == 0) {
-                        PNGDisplaySimple(&dev, found_path);
-                    } else {
-                        // .jpg 또는 .jpeg
-                        JPEGDisplaySimple(&dev, found_path);
-                    }
-                }
+            break;
+        case IMAGE_EVENT_ADDED:
+        case IMAGE_EVENT_REPLACED:
+            if (strcmp(ev.path, live_shown) == 0) {
+                live_shown[0] = '\0';  // 업로드하면서 이미 그림
+            } else if (IsImageName(ev.path)) {
+                ESP_LOGI(TAG, "New image detected: %s (%"PRIu32" bytes)", ev.path, ev.size);
+                strlcpy(last_path, ev.path, sizeof(last_path));
+                ImageDisplay(&dev, last_path);
+            } else if (stat(last_path, &st) != 0) {
+                // 이미지가 아닌 파일의 업로드가 기존 이미지를 지움
+                ShowFirstImage(&dev, images_dir, last_path, sizeof(last_path));
             }
-        } else {
-            ESP_LOGW(TAG, "이미지 파일이 없습니다: %s", images_dir);
+            break;
+        case IMAGE_EVENT_DELETED:
+            if (strcmp(ev.path, last_path) == 0) {
+                ShowFirstImage(&dev, images_dir, last_path, sizeof(last_path));
+            }
+            break;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(2000));  // 2초마다 스캔
     }
 }
 
@@ -383,6 +1710,9 @@ void ST7789(void *pvParameters)
 // --------------------------------------------------
 void app_main(void)
 {
+    // JPEG/PNG 디코더 작업 공간: 디코딩하는 동안만 힙에서 빌리고 끝나면 반납
+    ESP_ERROR_CHECK(decode_arena_init(MAX(DECODE_JPEG_WORKSZ, sizeof(pngle_t))));
+
     power_button_init(on_power_long_press);
     wifi_event_group = xEventGroupCreate();
 
@@ -433,6 +1763,10 @@ void app_main(void)
     ESP_ERROR_CHECK(example_mount_storage(base_path));
 
 
+    /* 파일 서버 → 디스플레이 태스크 이벤트 큐 (업로드 중에도 받을 수 있게 서버보다 먼저) */
+    image_events = xQueueCreate(IMAGE_EVENT_QUEUE_LEN, sizeof(image_event_t));
+    ESP_ERROR_CHECK(image_events ? ESP_OK : ESP_ERR_NO_MEM);
+
     /* 파일 서버 시작 */
     ESP_ERROR_CHECK(example_start_file_server(base_path));
     ESP_LOGI(TAG, "File server started");
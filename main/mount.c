@@ -153,7 +153,7 @@ esp_err_t example_mount_storage(const char* base_path)
         return ret;
     }
 
-    ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    ESP_LOGI(TAG, "Partition size: total: %d, used: %d", (int)total, (int)used);
     return ESP_OK;
 }
 
@@ -0,0 +1,660 @@
+/*
+ * Host benchmark for the image decoders: tjpgd, pngle and the decode_jpeg /
+ * decode_png wrappers, built from the component sources against the stub
+ * ESP-IDF headers in tools/host/.
+ *
+ * Every input is decoded by each decoder that takes it, at each scale that
+ * decoder offers. A report row gives the time per decode, source megapixels
+ * per second, the peak heap of one decode (above what was allocated before
+ * it, the decoder arena included since it is taken per decode like on the
+ * device), its number of allocations and a CRC-32 of the output pixels.
+ *
+ *     make -C tools/bench
+ *     tools/bench/decode_bench                          # test_apps JPEGs and images/
+ *     tools/bench/decode_bench -t 1 photo.jpg icons/    # own corpus, 1 s per row
+ *     tools/bench/decode_bench --save golden.txt ...    # record output CRCs
+ *     tools/bench/decode_bench --check golden.txt ...   # compare with them
+ *
+ * Output is verified two ways. The 1/1 output of logo.jpg and
+ * usb_camera_2.jpg is compared with the RGB888 arrays in esp_jpeg's
+ * test_apps, with the tolerances its unit tests use (RGB565 outputs get the
+ * extra quantisation error). --save / --check record and compare the CRC of
+ * every row, so a decoder change can be checked for bit-exact output on any
+ * corpus. Exit status is non-zero on a decode error or any mismatch.
+ *
+ * "make -C tools/bench check" runs the PNG paths against a reference instead
+ * of a recording: png_corpus.py writes images of every color type, depth and
+ * interlace mode, and golden CRCs computed from their samples, covering
+ * pngle's rows, png_scaler, png_interlace and decode_png's fit.
+ *
+ * The numbers are for comparing builds on one machine, not for predicting the
+ * ESP32-S3: the host runs the external tjpgd R0.03 where the device uses the
+ * ROM copy, and PNG data is inflated by zlib instead of ROM miniz.
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "tjpgd.h"
+#include "decode_arena.h"
+#include "decode_jpeg.h"
+#include "decode_png.h"
+#include "pngle.h"
+#include "host_port.h"
+#include "test_logo_rgb888.h"
+#include "test_usb_camera_2_rgb888.h"
+
+#define MAX_INPUTS	256
+#define MAX_GOLDEN	4096
+#define SCALE_FIT	-1
+
+typedef struct {
+	char path[PATH_MAX];
+	const char *name;		// file name part of path
+	uint8_t *data;
+	size_t size;
+	bool png;
+	bool interlaced;
+	int width;				// source size
+	int height;
+} input_t;
+
+typedef struct {
+	int width;				// output size
+	int height;
+	int bpp;				// 3 = RGB888, 2 = RGB565 (native endian)
+	uint8_t *pixels;		// width * height * bpp, allocated before the heap is measured
+	pixel_png **rows;		// RGB565 row pointers into pixels for the PNG sinks
+} frame_t;
+
+typedef struct {
+	const char *name;
+	bool png;				// takes PNG (else JPEG) input
+	const int *scales;		// 0..3 = 1/1..1/8 or SCALE_FIT, ended by INT_MIN
+	esp_err_t (*run)(const input_t *in, int scale, frame_t *out);
+} decoder_t;
+
+static int screenWidth = 240;
+static int screenHeight = 240;
+
+static void frame_layout(frame_t *f, int width, int height, int bpp)
+{
+	f->width = width;
+	f->height = height;
+	f->bpp = bpp;
+	for (int y = 0; bpp == 2 && y < height; y++) {
+		f->rows[y] = (pixel_png *)(f->pixels + (size_t)y * width * 2);
+	}
+}
+
+// ---------------------------------------------------------------- tjpgd
+
+typedef struct {
+	const uint8_t *data;
+	size_t left;
+	frame_t *out;
+} tjpgd_dev_t;
+
+static size_t tjpgd_in(JDEC *jd, uint8_t *buf, size_t len)
+{
+	tjpgd_dev_t *dev = jd->device;
+	if (len > dev->left) len = dev->left;
+	if (buf) memcpy(buf, dev->data, len);
+	dev->data += len;
+	dev->left -= len;
+	return len;
+}
+
+static int tjpgd_out(JDEC *jd, void *bitmap, JRECT *rect)
+{
+	tjpgd_dev_t *dev = jd->device;
+	frame_t *f = dev->out;
+	size_t n = (rect->right - rect->left + 1) * 3;
+	const uint8_t *src = bitmap;
+	for (int y = rect->top; y <= rect->bottom; y++, src += n) {
+		memcpy(f->pixels + ((size_t)y * f->width + rect->left) * 3, src, n);
+	}
+	return 1;
+}
+
+// jd_prepare()/jd_decomp() straight, RGB888 out, work buffer from the arena like decode_jpeg
+static esp_err_t run_tjpgd(const input_t *in, int scale, frame_t *out)
+{
+	JDEC jd;
+	tjpgd_dev_t dev = { in->data, in->size, out };
+	void *work = decode_arena_alloc(DECODE_JPEG_WORKSZ, "bench tjpgd");
+	if (!work) return ESP_ERR_NO_MEM;
+
+	esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+	if (jd_prepare(&jd, tjpgd_in, work, DECODE_JPEG_WORKSZ, &dev) == JDR_OK) {
+		frame_layout(out, jd.width >> scale, jd.height >> scale, 3);
+		if (jd_decomp(&jd, tjpgd_out, scale) == JDR_OK) ret = ESP_OK;
+	}
+	decode_arena_free(work);
+	return ret;
+}
+
+// ---------------------------------------------------------------- decode_jpeg
+
+static bool band_copy(const jpeg_stream_t *js, int top, int height, const pixel_jpeg *band)
+{
+	frame_t *f = js->arg;
+	memcpy(f->pixels + (size_t)top * f->width * 2, band, (size_t)height * js->bandWidth * 2);
+	return true;
+}
+
+static void stream_setup(jpeg_stream_t *js, FILE *fp, int scale, frame_t *out)
+{
+	memset(js, 0, sizeof(*js));
+	js->fp = fp;
+	js->scale = scale;
+	js->screenWidth = 0xFFFF;	// no clipping: the whole scaled image
+	js->screenHeight = 0xFFFF;
+	js->band_cb = band_copy;
+	js->arg = out;
+}
+
+static esp_err_t run_jpeg_stream(const input_t *in, int scale, frame_t *out)
+{
+	FILE *fp = fmemopen(in->data, in->size, "rb");
+	if (!fp) return ESP_FAIL;
+	jpeg_stream_t js;
+	stream_setup(&js, fp, scale, out);
+	frame_layout(out, in->width >> scale, in->height >> scale, 2);
+	esp_err_t ret = decode_jpeg_stream(&js);
+	fclose(fp);
+	return ret;
+}
+
+// restart index plus the two-worker decode, as ImageDisplay does per image
+// (without restart markers decode_jpeg_parallel() decodes serially)
+static esp_err_t run_jpeg_parallel(const input_t *in, int scale, frame_t *out)
+{
+	FILE *fp = fmemopen(in->data, in->size, "rb");
+	if (!fp) return ESP_FAIL;
+	jpeg_rst_index_t index;
+	bool indexed = decode_jpeg_index(fp, 0, &index) == ESP_OK;
+	jpeg_stream_t js;
+	stream_setup(&js, fp, scale, out);
+	frame_layout(out, in->width >> scale, in->height >> scale, 2);
+	esp_err_t ret = decode_jpeg_parallel(&js, indexed ? &index : NULL);
+	if (indexed) decode_jpeg_index_free(&index);
+	fclose(fp);
+	return ret;
+}
+
+// full frame buffer of screen size, read from the file system
+static esp_err_t run_jpeg_frame(const input_t *in, int scale, frame_t *out)
+{
+	pixel_jpeg **pixels;
+	int width, height;
+	esp_err_t ret = decode_jpeg(&pixels, (char *)in->path, screenWidth, screenHeight, &width, &height);
+	if (ret != ESP_OK) return ret;
+	if (width > screenWidth) width = screenWidth;
+	if (height > screenHeight) height = screenHeight;
+	frame_layout(out, width, height, 2);
+	for (int y = 0; y < height; y++) {
+		memcpy(out->rows[y], pixels[y], width * 2);
+	}
+	release_image(&pixels, screenWidth, screenHeight);
+	return ESP_OK;
+}
+
+// ---------------------------------------------------------------- pngle
+
+typedef struct {
+	frame_t *out;
+	int scale;
+	png_scaler_t scaler;
+	png_interlace_t interlace;
+} png_sink_t;
+
+static void sink_row(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels)
+{
+	png_sink_t *sink = pngle_get_user_data(pngle);
+	const uint16_t *src = pixels;
+	uint16_t *dst = sink->out->rows[y];
+	if (step == 1) {
+		memcpy(dst + x, src, n * 2);
+		return;
+	}
+	for (uint32_t i = 0; i < n; i++, x += step) dst[x] = src[i];
+}
+
+static void sink_row_scaled(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels)
+{
+	png_sink_t *sink = pngle_get_user_data(pngle);
+	png_scaler_push(&sink->scaler, y, pixels);
+}
+
+static void sink_row_interlaced(pngle_t *pngle, uint32_t y, uint32_t x, uint32_t step, uint32_t n, const void *pixels)
+{
+	png_sink_t *sink = pngle_get_user_data(pngle);
+	png_interlace_push(&sink->interlace, pngle->interlace_pass, y, pixels, n);
+}
+
+// 1/1 rows go to the frame as they are; reductions go through the same
+// scaler (or Adam7 sink) main.c uses, composited onto black
+static void sink_init(pngle_t *pngle, uint32_t w, uint32_t h)
+{
+	png_sink_t *sink = pngle_get_user_data(pngle);
+	uint32_t dw = ((w - 1) >> sink->scale) + 1;
+	uint32_t dh = ((h - 1) >> sink->scale) + 1;
+	frame_layout(sink->out, dw, dh, 2);
+	if (sink->scale == 0) {
+		pngle_set_row_callback(pngle, sink_row, PNGLE_ROW_RGB565);
+	} else if (pngle->hdr.interlace) {
+		if (png_interlace_init(&sink->interlace, w, h, dw, dh, sink->out->rows) == ESP_OK) {
+			pngle_set_row_callback(pngle, sink_row_interlaced, PNGLE_ROW_RGB565);
+		}
+	} else if (png_scaler_init(&sink->scaler, w, h, dw, dh, sink->out->rows) == ESP_OK) {
+		pngle_set_row_callback(pngle, sink_row_scaled, PNGLE_ROW_RGBA8888);
+	}
+}
+
+static esp_err_t png_feed_all(pngle_t *pngle, const input_t *in)
+{
+	size_t done = 0;
+	while (done < in->size) {
+		int n = pngle_feed(pngle, in->data + done, in->size - done);
+		if (n < 0) {
+			fprintf(stderr, "%s: %s\n", in->name, pngle_error(pngle));
+			return ESP_FAIL;
+		}
+		if (n == 0) break;
+		done += n;
+	}
+	return ESP_OK;
+}
+
+static esp_err_t run_pngle(const input_t *in, int scale, frame_t *out)
+{
+	png_sink_t sink = { .out = out, .scale = scale };
+	pngle_t *pngle = pngle_new_unbuffered(0, 0);
+	if (!pngle) return ESP_ERR_NO_MEM;
+	pngle_set_user_data(pngle, &sink);
+	pngle_set_init_callback(pngle, sink_init);
+	pngle_set_background(pngle, 0, 0, 0);
+	esp_err_t ret = png_feed_all(pngle, in);
+	png_scaler_free(&sink.scaler);
+	png_interlace_free(&sink.interlace);
+	pngle_destroy(pngle, 0, 0);
+	return ret;
+}
+
+// decode_png callbacks into a screen-sized pngle_new() buffer
+static esp_err_t run_png_frame(const input_t *in, int scale, frame_t *out)
+{
+	pngle_t *pngle = pngle_new(screenWidth, screenHeight);
+	if (!pngle) return ESP_ERR_NO_MEM;
+	pngle_set_init_callback(pngle, png_init);
+	pngle_set_draw_callback(pngle, png_draw);
+	pngle_set_done_callback(pngle, png_finish);
+	esp_err_t ret = png_feed_all(pngle, in);
+	if (ret == ESP_OK) {
+		int width = pngle->imageWidth < screenWidth ? pngle->imageWidth : screenWidth;
+		int height = pngle->imageHeight < screenHeight ? pngle->imageHeight : screenHeight;
+		frame_layout(out, width, height, 2);
+		for (int y = 0; y < height; y++) {
+			memcpy(out->rows[y], pngle->pixels[y], width * 2);
+		}
+	}
+	pngle_destroy(pngle, screenWidth, screenHeight);
+	return ret;
+}
+
+static const int scales_all[] = { 0, 1, 2, 3, INT_MIN };
+static const int scales_one[] = { 0, INT_MIN };
+static const int scales_reduce[] = { 1, 2, 3, INT_MIN };
+static const int scales_fit[] = { SCALE_FIT, INT_MIN };
+
+static const decoder_t decoders[] = {
+	{ "tjpgd",			false,	scales_all,		run_tjpgd },
+	{ "jpeg_stream",	false,	scales_all,		run_jpeg_stream },
+	{ "jpeg_parallel",	false,	scales_all,		run_jpeg_parallel },
+	{ "decode_jpeg",	false,	scales_fit,		run_jpeg_frame },
+	{ "pngle",			true,	scales_one,		run_pngle },
+	{ "pngle_scaled",	true,	scales_reduce,	run_pngle },
+	{ "decode_png",		true,	scales_fit,		run_png_frame },
+};
+
+// ---------------------------------------------------------------- references
+
+typedef struct {
+	const char *file;
+	int width;
+	int height;
+	int tolerance;			// per channel, as in esp_jpeg's tests
+	void (*get)(int i, uint8_t rgb[3]);
+} reference_t;
+
+static void logo_get(int i, uint8_t rgb[3])
+{
+	memcpy(rgb, &logo_rgb888[i * 3], 3);
+}
+
+static void camera_2_get(int i, uint8_t rgb[3])
+{
+	// 0xRRGGBB, as written by jpg_to_rgb888_hex.py
+	uint32_t v = usb_camera_2_rgb888[i];
+	rgb[0] = v >> 16;
+	rgb[1] = v >> 8;
+	rgb[2] = v;
+}
+
+static const reference_t references[] = {
+	{ "logo.jpg",			46,		46,		2,	logo_get },
+	{ "usb_camera_2.jpg",	160,	120,	16,	camera_2_get },
+};
+
+// NULL if the output matches, else what differs
+static const char *reference_check(const reference_t *ref, const frame_t *f, char *msg, size_t len)
+{
+	if (f->width != ref->width || f->height != ref->height) {
+		snprintf(msg, len, "size %dx%d, expected %dx%d", f->width, f->height, ref->width, ref->height);
+		return msg;
+	}
+	int worst = 0, at = 0, off = 0;
+	for (int i = 0; i < f->width * f->height; i++) {
+		uint8_t want[3], got[3];
+		ref->get(i, want);
+		if (f->bpp == 3) {
+			memcpy(got, f->pixels + i * 3, 3);
+		} else {
+			uint16_t p = ((const uint16_t *)f->pixels)[i];
+			uint8_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+			got[0] = (r << 3) | (r >> 2);
+			got[1] = (g << 2) | (g >> 4);
+			got[2] = (b << 3) | (b >> 2);
+		}
+		int d = 0;
+		for (int c = 0; c < 3; c++) {
+			// RGB565 truncates: up to 7 (5 bits) or 3 (6 bits) below the 8-bit value
+			int slack = f->bpp == 3 ? 0 : (c == 1 ? 3 : 7);
+			int dc = abs(got[c] - want[c]) - slack;
+			if (dc > d) d = dc;
+		}
+		if (d > ref->tolerance) off++;
+		if (d > worst) {
+			worst = d;
+			at = i;
+		}
+	}
+	if (!off) return NULL;
+	snprintf(msg, len, "%d pixels off, worst by %d at (%d,%d)", off, worst, at % f->width, at / f->width);
+	return msg;
+}
+
+// ---------------------------------------------------------------- golden CRCs
+
+typedef struct {
+	char key[PATH_MAX + 64];
+	uint32_t crc;
+} golden_t;
+
+static golden_t *golden;
+static int goldenCount;
+
+static void golden_key(char *key, size_t len, const input_t *in, const decoder_t *dec, int scale, const frame_t *f)
+{
+	snprintf(key, len, "%s %s %d %dx%d", in->name, dec->name, scale, f->width, f->height);
+}
+
+static bool golden_load(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return false;
+	}
+	golden = calloc(MAX_GOLDEN, sizeof(golden_t));
+	char line[PATH_MAX + 128];
+	while (golden && goldenCount < MAX_GOLDEN && fgets(line, sizeof(line), fp)) {
+		char name[PATH_MAX], dec[32], size[32];
+		int scale;
+		unsigned crc;
+		if (sscanf(line, "%s %31s %d %31s %x", name, dec, &scale, size, &crc) != 5) continue;
+		golden_t *g = &golden[goldenCount];
+		if (snprintf(g->key, sizeof(g->key), "%s %s %d %s", name, dec, scale, size) >= sizeof(g->key)) continue;
+		g->crc = crc;
+		goldenCount++;
+	}
+	fclose(fp);
+	return golden != NULL;
+}
+
+static const golden_t *golden_find(const char *key)
+{
+	for (int i = 0; i < goldenCount; i++) {
+		if (strcmp(golden[i].key, key) == 0) return &golden[i];
+	}
+	return NULL;
+}
+
+// ---------------------------------------------------------------- inputs
+
+static uint32_t be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool has_suffix(const char *name, const char *suffix)
+{
+	size_t n = strlen(name), m = strlen(suffix);
+	if (n < m) return false;
+	for (size_t i = 0; i < m; i++) {
+		if (tolower((unsigned char)name[n - m + i]) != suffix[i]) return false;
+	}
+	return true;
+}
+
+// read the file and its size; false (with a note) if no decoder here takes it
+static bool input_load(input_t *in, const char *path)
+{
+	snprintf(in->path, sizeof(in->path), "%s", path);
+	const char *slash = strrchr(in->path, '/');
+	in->name = slash ? slash + 1 : in->path;
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+		perror(path);
+		return false;
+	}
+	fseek(fp, 0, SEEK_END);
+	in->size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	in->data = malloc(in->size ? in->size : 1);
+	bool ok = in->data && fread(in->data, 1, in->size, fp) == in->size;
+	fclose(fp);
+	if (!ok) return false;
+
+	static const uint8_t png_sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (in->size >= 33 && memcmp(in->data, png_sig, 8) == 0) {
+		in->png = true;
+		in->width = be32(in->data + 16);
+		in->height = be32(in->data + 20);
+		in->interlaced = in->data[28] != 0;
+		return in->width > 0 && in->height > 0;
+	}
+
+	JDEC jd;
+	tjpgd_dev_t dev = { in->data, in->size, NULL };
+	void *work = decode_arena_alloc(DECODE_JPEG_WORKSZ, "bench probe");
+	JRESULT res = work ? jd_prepare(&jd, tjpgd_in, work, DECODE_JPEG_WORKSZ, &dev) : JDR_MEM1;
+	decode_arena_free(work);
+	if (res != JDR_OK) {
+		// e.g. test_apps/usb_camera.jpg, which relies on default Huffman tables
+		printf("%-20s skipped, tjpgd cannot decode it (JRESULT %d)\n", in->name, res);
+		return false;
+	}
+	in->width = jd.width;
+	in->height = jd.height;
+	return true;
+}
+
+static int input_compare(const void *a, const void *b)
+{
+	return strcmp(((const input_t *)a)->path, ((const input_t *)b)->path);
+}
+
+static void inputs_add(input_t *inputs, int *count, const char *path)
+{
+	DIR *dir = opendir(path);
+	if (!dir) {
+		if (*count < MAX_INPUTS && input_load(&inputs[*count], path)) (*count)++;
+		return;
+	}
+	int first = *count;
+	struct dirent *de;
+	while ((de = readdir(dir)) != NULL && *count < MAX_INPUTS) {
+		if (!has_suffix(de->d_name, ".jpg") && !has_suffix(de->d_name, ".jpeg") && !has_suffix(de->d_name, ".png")) continue;
+		char file[PATH_MAX];
+		snprintf(file, sizeof(file), "%s/%s", path, de->d_name);
+		if (input_load(&inputs[*count], file)) (*count)++;
+	}
+	closedir(dir);
+	qsort(inputs + first, *count - first, sizeof(input_t), input_compare);
+	for (int i = first; i < *count; i++) {
+		// name points into path, which moved with the entry
+		inputs[i].name = strrchr(inputs[i].path, '/') + 1;
+	}
+}
+
+// ---------------------------------------------------------------- main
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-t seconds] [-s WxH] [--save FILE | --check FILE] [file|dir ...]\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	double minTime = 0.2;
+	const char *savePath = NULL, *checkPath = NULL;
+	static input_t inputs[MAX_INPUTS];
+	int count = 0;
+
+	// same arena as app_main: room for a tjpgd work buffer or a pngle_t
+	size_t arena = DECODE_JPEG_WORKSZ > sizeof(pngle_t) ? DECODE_JPEG_WORKSZ : sizeof(pngle_t);
+	if (decode_arena_init(arena) != ESP_OK) return 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			minTime = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &screenWidth, &screenHeight) != 2 || screenWidth <= 0 || screenHeight <= 0) usage(argv[0]);
+		} else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+			savePath = argv[++i];
+		} else if (strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+			checkPath = argv[++i];
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+		} else {
+			inputs_add(inputs, &count, argv[i]);
+		}
+	}
+	if (argc == 1 || count == 0) {
+		inputs_add(inputs, &count, REPO_ROOT "/managed_components/espressif__esp_jpeg/test_apps/main");
+		inputs_add(inputs, &count, REPO_ROOT "/images");
+	}
+	if (checkPath && !golden_load(checkPath)) return 1;
+	FILE *save = NULL;
+	if (savePath && !(save = fopen(savePath, "w"))) {
+		perror(savePath);
+		return 1;
+	}
+
+	printf("%-20s %-14s %5s %11s %9s %8s %8s %6s  %-8s  %s\n",
+		"file", "decoder", "scale", "output", "ms", "MP/s", "peak KB", "allocs", "crc", "check");
+
+	int failures = 0;
+	for (int i = 0; i < count; i++) {
+		input_t *in = &inputs[i];
+		frame_t frame = { 0 };
+		frame.pixels = malloc((size_t)in->width * in->height * 3);
+		frame.rows = malloc(in->height * sizeof(pixel_png *));
+		if (!frame.pixels || !frame.rows) {
+			fprintf(stderr, "%s: %dx%d too large\n", in->name, in->width, in->height);
+			return 1;
+		}
+
+		for (size_t d = 0; d < sizeof(decoders) / sizeof(decoders[0]); d++) {
+			const decoder_t *dec = &decoders[d];
+			if (dec->png != in->png) continue;
+			for (const int *s = dec->scales; *s != INT_MIN; s++) {
+				int scale = *s;
+				char label[8] = "fit";
+				if (scale != SCALE_FIT) snprintf(label, sizeof(label), "1/%d", 1 << scale);
+
+				// first run: heap and output; then repeat for the time
+				memset(frame.pixels, 0, (size_t)in->width * in->height * 3);
+				host_heap_reset();
+				size_t base = host_heap_get().live;
+				double t0 = now();
+				esp_err_t ret = dec->run(in, scale, &frame);
+				double t = now() - t0;
+				host_heap_t heap = host_heap_get();
+				if (ret != ESP_OK) {
+					printf("%-20s %-14s %5s  failed: %s\n", in->name, dec->name, label, esp_err_to_name(ret));
+					failures++;
+					continue;
+				}
+				int runs = 1;
+				while (t < minTime && runs < 1000000) {
+					dec->run(in, scale, &frame);
+					runs++;
+					t = now() - t0;
+				}
+
+				uint32_t crc = crc32(0, frame.pixels, (size_t)frame.width * frame.height * frame.bpp);
+				char key[PATH_MAX + 64], msg[96], size[24];
+				const char *check = "";
+				golden_key(key, sizeof(key), in, dec, scale, &frame);
+				if (scale == 0 || scale == SCALE_FIT) {
+					for (size_t r = 0; r < sizeof(references) / sizeof(references[0]); r++) {
+						if (strcmp(in->name, references[r].file) != 0) continue;
+						const char *err = reference_check(&references[r], &frame, msg, sizeof(msg));
+						check = err ? err : "reference ok";
+						if (err) failures++;
+					}
+				}
+				if (checkPath && !*check) {
+					const golden_t *g = golden_find(key);
+					check = !g ? "not in golden" : g->crc == crc ? "golden ok" : "golden MISMATCH";
+					if (g && g->crc != crc) failures++;
+				}
+				if (save) fprintf(save, "%s %08x\n", key, (unsigned)crc);
+
+				snprintf(size, sizeof(size), "%dx%d", frame.width, frame.height);
+				double ms = t * 1000 / runs;
+				printf("%-20s %-14s %5s %11s %9.3f %8.2f %8.1f %6u  %08x  %s\n",
+					in->name, dec->name, label, size, ms,
+					(double)in->width * in->height / (ms * 1000),
+					(double)(heap.peak - base) / 1024,
+					heap.count, (unsigned)crc, check);
+			}
+		}
+		free(frame.pixels);
+		free(frame.rows);
+		free(in->data);
+	}
+
+	if (save) fclose(save);
+	free(golden);
+	if (failures) printf("%d failure(s)\n", failures);
+	return failures ? 1 : 0;
+}
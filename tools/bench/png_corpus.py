@@ -0,0 +1,350 @@
+#!/usr/bin/env python3
+"""Generate the PNG check corpus for decode_bench and its golden CRCs.
+
+    python3 tools/bench/png_corpus.py OUTDIR
+    tools/bench/decode_bench -t 0 --check OUTDIR/golden.txt OUTDIR
+
+(or just "make -C tools/bench check"). The images cover every color type
+at every bit depth, with and without tRNS, each written plain and Adam7
+interlaced. Each row is filtered with a different filter type, and the
+sizes leave the interlace passes partly filled. A few images are larger
+than the 240x240 screen, so decode_png has to reduce them.
+
+The expected output is not recorded from the decoders. It is computed
+here from the source samples, with the rules the firmware is meant to
+follow:
+
+  - samples to 8 bits as (v * 255 + max / 2) / max, tRNS color keys
+    compared on the raw samples;
+  - RGB565 rows composited onto black with 8-bit rounding, like
+    pngle_blend8();
+  - png_scaler: an exact area average of premultiplied pixels;
+  - png_interlace: once every pass has arrived, the pixel under the
+    center of each output pixel.
+
+golden.txt has one line per decode_bench row (file, decoder, scale,
+output size, CRC-32 of the RGB565 frame), in the format of --save.
+
+Only the Python standard library is needed. The output is the same on
+every run.
+"""
+
+import os
+import struct
+import sys
+import zlib
+
+SCREEN = (240, 240)
+
+# Adam7 passes: x offset, y offset, x step, y step
+ADAM7 = [(0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4),
+         (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2)]
+
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+
+
+class Rand:
+    """xorshift32, so the corpus does not depend on the Python version."""
+
+    def __init__(self, seed):
+        self.s = seed or 1
+
+    def next(self, n):
+        s = self.s
+        s ^= (s << 13) & 0xFFFFFFFF
+        s ^= s >> 17
+        s ^= (s << 5) & 0xFFFFFFFF
+        self.s = s
+        return s % n
+
+
+# ---------------------------------------------------------------- images
+
+def make_image(ct, depth, w, h, trns, seed):
+    """Samples as rows of per-pixel tuples, plus PLTE/tRNS contents."""
+    rnd = Rand(seed)
+    top = (1 << depth) - 1
+    img = {"ct": ct, "depth": depth, "w": w, "h": h, "plte": None, "trns": None}
+
+    if ct == 3:
+        n = min(1 << depth, 3 + rnd.next(200))
+        img["plte"] = [(rnd.next(256), rnd.next(256), rnd.next(256)) for _ in range(n)]
+        if trns:
+            # shorter than the palette: the entries after it stay opaque
+            alphas = [0, 255, 128, 1, 254]
+            img["trns"] = [alphas[i] if i < len(alphas) else rnd.next(256)
+                           for i in range(max(1, n * 2 // 3))]
+        rows = [[((x + y + rnd.next(3)) % n,) for x in range(w)] for y in range(h)]
+        img["rows"] = rows
+        return img
+
+    nc = CHANNELS[ct]
+    color = nc - 1 if ct & 4 else nc
+    rows = []
+    for y in range(h):
+        row = []
+        for x in range(w):
+            px = []
+            for c in range(color):
+                # a gradient for the filters to work on, with noise in the low bits
+                v = ((x * (c + 1) * 37 + y * 23) * top // max(1, 3 * (w + h))) + rnd.next(4)
+                px.append(min(v, top))
+            if ct & 4:
+                a = (x * 7 + y * 13) % 5
+                px.append([0, top, rnd.next(top + 1), 1, top - 1][a])
+            row.append(tuple(px))
+        rows.append(row)
+    if trns:
+        # the key is a sample that occurs, and a diagonal band is set to it
+        key = rows[h // 2][w // 2][:color]
+        img["trns"] = key
+        for y in range(h):
+            for x in range(w):
+                if (x + y) % 7 == 0:
+                    rows[y][x] = key
+    img["rows"] = rows
+    return img
+
+
+# ---------------------------------------------------------------- encoder
+
+def pack_row(img, samples):
+    depth = img["depth"]
+    if depth == 16:
+        return b"".join(struct.pack(">%dH" % len(px), *px) for px in samples)
+    if depth == 8:
+        return bytes(v for px in samples for v in px)
+    bits, n, out = 0, 0, bytearray()
+    for px in samples:
+        for v in px:
+            bits = (bits << depth) | v
+            n += depth
+            if n == 8:
+                out.append(bits)
+                bits, n = 0, 0
+    if n:
+        out.append(bits << (8 - n))
+    return bytes(out)
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def filter_row(ft, line, prev, bpp):
+    out = bytearray([ft])
+    for i, x in enumerate(line):
+        a = line[i - bpp] if i >= bpp else 0
+        b = prev[i] if prev else 0
+        c = prev[i - bpp] if prev and i >= bpp else 0
+        pred = [0, a, b, (a + b) >> 1, paeth(a, b, c)][ft]
+        out.append((x - pred) & 0xFF)
+    return out
+
+
+def encode_png(img, interlace):
+    nc = CHANNELS[img["ct"]]
+    bpp = max(1, nc * img["depth"] // 8)
+    w, h = img["w"], img["h"]
+    passes = ADAM7 if interlace else [(0, 0, 1, 1)]
+
+    data = bytearray()
+    ft = 0
+    for x0, y0, dx, dy in passes:
+        xs = range(x0, w, dx)
+        prev = None  # every pass starts without a previous row
+        for y in range(y0, h, dy):
+            if not xs:
+                break
+            line = pack_row(img, [img["rows"][y][x] for x in xs])
+            data += filter_row(ft, line, prev, bpp)
+            ft = (ft + 1) % 5
+            prev = line
+
+    def chunk(tag, body):
+        return struct.pack(">I", len(body)) + tag + body + struct.pack(">I", zlib.crc32(tag + body))
+
+    out = b"\x89PNG\r\n\x1a\n"
+    out += chunk(b"IHDR", struct.pack(">IIBBBBB", w, h, img["depth"], img["ct"], 0, 0, interlace))
+    if img["plte"]:
+        out += chunk(b"PLTE", bytes(v for e in img["plte"] for v in e))
+    if img["trns"] is not None:
+        if img["ct"] == 3:
+            out += chunk(b"tRNS", bytes(img["trns"]))
+        else:
+            out += chunk(b"tRNS", struct.pack(">%dH" % len(img["trns"]), *img["trns"]))
+    # several IDATs, so the decoder sees the stream split across chunks
+    z = zlib.compress(bytes(data), 9)
+    for i in range(0, len(z), 1000):
+        out += chunk(b"IDAT", z[i:i + 1000])
+    out += chunk(b"IEND", b"")
+    return out
+
+
+# ---------------------------------------------------------------- reference
+
+def to_rgba(img):
+    """RGBA8888 rows, as the decoder should produce them."""
+    ct, depth = img["ct"], img["depth"]
+    top = 255 if ct == 3 else (1 << depth) - 1
+
+    def to8(v):
+        return (v * 255 + top // 2) // top
+
+    out = []
+    for row in img["rows"]:
+        line = []
+        for px in row:
+            if ct == 3:
+                r, g, b = img["plte"][px[0]]
+                trns = img["trns"] or []
+                a = trns[px[0]] if px[0] < len(trns) else 255
+                line.append((r, g, b, a))
+                continue
+            color = px[:3] if ct & 2 else px[:1] * 3
+            if ct & 4:
+                a = to8(px[-1])
+            else:
+                a = 0 if img["trns"] is not None and px == img["trns"] else 255
+            line.append((to8(color[0]), to8(color[1]), to8(color[2]), a))
+        out.append(line)
+    return out
+
+
+def mul8(a, b):
+    t = a * b + 128
+    return (t + (t >> 8)) >> 8
+
+
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def on_black(rgba):
+    """Full size RGB565 composited onto black."""
+    return [[rgb565(mul8(r, a), mul8(g, a), mul8(b, a)) for r, g, b, a in row] for row in rgba]
+
+
+def center_map(src, dst):
+    return [(2 * i + 1) * src // (2 * dst) for i in range(dst)]
+
+
+def nearest(full, dw, dh):
+    mx = center_map(len(full[0]), dw)
+    my = center_map(len(full), dh)
+    return [[full[y][x] for x in mx] for y in my]
+
+
+def overlaps(src, dst):
+    """For each output index, the (source index, weight) pairs it covers. Source
+    i spans [i * dst, (i + 1) * dst) and output j spans [j * src, (j + 1) * src)."""
+    out = []
+    for j in range(dst):
+        lo, hi = j * src, (j + 1) * src
+        out.append([(i, min(hi, (i + 1) * dst) - max(lo, i * dst))
+                    for i in range(lo // dst, (hi - 1) // dst + 1)])
+    return out
+
+
+def area(rgba, dw, dh):
+    """Premultiplied area average, 8.8 fixed point between the two passes."""
+    sw, sh = len(rgba[0]), len(rgba)
+    ox, oy = overlaps(sw, dw), overlaps(sh, dh)
+    hsum = []
+    for row in rgba:
+        pre = [(mul8(r, a), mul8(g, a), mul8(b, a), a) for r, g, b, a in row]
+        hsum.append([[((sum(pre[i][c] * w for i, w in ox[j]) << 8) + (sw >> 1)) // sw
+                      for c in range(4)] for j in range(dw)])
+    out = []
+    for o in range(dh):
+        line = []
+        for j in range(dw):
+            v = [(sum(hsum[y][j][c] * w for y, w in oy[o]) + (sh << 7)) // (sh << 8) for c in range(3)]
+            line.append(rgb565(*(min(c, 255) for c in v)))
+        out.append(line)
+    return out
+
+
+def frame_crc(frame):
+    return zlib.crc32(b"".join(struct.pack("<%dH" % len(row), *row) for row in frame))
+
+
+def expected(img, interlace):
+    """(decoder, scale, frame) for every decode_bench row this image gets."""
+    w, h = img["w"], img["h"]
+    rgba = to_rgba(img)
+    full = on_black(rgba)
+    rows = [("pngle", 0, full)]
+
+    # pngle_scaled: png_interlace for Adam7 images, else png_scaler
+    for scale in (1, 2, 3):
+        dw, dh = ((w - 1) >> scale) + 1, ((h - 1) >> scale) + 1
+        rows.append(("pngle_scaled", scale, nearest(full, dw, dh) if interlace else area(rgba, dw, dh)))
+
+    # decode_png: fit the screen with png_init()'s double arithmetic
+    fw, fh = w, h
+    if SCREEN[0] < w or SCREEN[1] < h:
+        f = min(SCREEN[0] / w, SCREEN[1] / h)
+        fw, fh = int(w * f), int(h * f)
+    if interlace:
+        fit = nearest(full, fw, fh)
+    elif (fw, fh) != (w, h):
+        fit = area(rgba, fw, fh)
+    else:
+        fit = full
+    rows.append(("decode_png", -1, fit))
+    return rows
+
+
+# ---------------------------------------------------------------- corpus
+
+def corpus():
+    """(name, color type, depth, width, height, tRNS)"""
+    sets = []
+    for ct, depths in ((0, (1, 2, 4, 8, 16)), (2, (8, 16)), (3, (1, 2, 4, 8)), (4, (8, 16)), (6, (8, 16))):
+        for depth in depths:
+            sets.append((ct, depth, False))
+            if ct in (0, 2, 3):
+                sets.append((ct, depth, True))
+    out = []
+    for n, (ct, depth, trns) in enumerate(sets):
+        # odd sizes, a different one per set, so the passes end part way
+        w, h = 29 + (n * 11) % 37, 23 + (n * 17) % 41
+        out.append(("c%d_%d%s" % (ct, depth, "t" if trns else ""), ct, depth, w, h, trns))
+    # the Adam7 corner cases: passes with no columns or no rows
+    for w, h in ((1, 1), (1, 9), (9, 1), (2, 2), (5, 3), (3, 5)):
+        out.append(("tiny_%dx%d" % (w, h), 6, 8, w, h, False))
+        out.append(("tinyp_%dx%d" % (w, h), 3, 2, w, h, True))
+    # larger than the screen: decode_png reduces them
+    for ct, depth, w, h in ((2, 8, 320, 200), (6, 8, 250, 330), (3, 4, 481, 241), (0, 16, 241, 960)):
+        out.append(("big%d_%d_%dx%d" % (ct, depth, w, h), ct, depth, w, h, ct != 6))
+    return out
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: png_corpus.py OUTDIR")
+    outdir = sys.argv[1]
+    os.makedirs(outdir, exist_ok=True)
+
+    golden = []
+    for seed, (name, ct, depth, w, h, trns) in enumerate(corpus(), 1):
+        img = make_image(ct, depth, w, h, trns, seed * 2654435761 & 0xFFFFFFFF)
+        for interlace in (0, 1):
+            file = "%s%s.png" % (name, "_i" if interlace else "")
+            with open(os.path.join(outdir, file), "wb") as fp:
+                fp.write(encode_png(img, interlace))
+            for dec, scale, frame in expected(img, interlace):
+                golden.append("%s %s %d %dx%d %08x" % (file, dec, scale, len(frame[0]), len(frame), frame_crc(frame)))
+
+    with open(os.path.join(outdir, "golden.txt"), "w") as fp:
+        fp.write("\n".join(golden) + "\n")
+    print("%s: %d images, %d golden rows" % (outdir, len(golden) // 5, len(golden)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,10 @@
+#pragma once
+// Host build configuration: external tjpgd with its Kconfig defaults
+// (the ROM decoder the device uses is not available off target).
+#define CONFIG_JD_USE_ROM 0
+#define CONFIG_JD_SZBUF 512
+#define CONFIG_JD_FORMAT 0
+#define CONFIG_JD_USE_SCALE 1
+#define CONFIG_JD_TBLCLIP 1
+#define CONFIG_JD_FASTDECODE 1
+#define CONFIG_JD_DEFAULT_HUFFMAN 0
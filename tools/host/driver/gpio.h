@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+// Levels are remembered so the virtual panel can follow DC and the backlight.
+typedef int gpio_num_t;
+typedef enum {
+	GPIO_MODE_DISABLE,
+	GPIO_MODE_INPUT,
+	GPIO_MODE_OUTPUT,
+	GPIO_MODE_INPUT_OUTPUT,
+} gpio_mode_t;
+
+#define GPIO_NUM_MAX 49
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio);
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+int gpio_get_level(gpio_num_t gpio);
+void gpio_pad_select_gpio(uint32_t gpio);
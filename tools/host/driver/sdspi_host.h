@@ -0,0 +1,2 @@
+#pragma once
+// SD card support is not simulated (CONFIG_EXAMPLE_MOUNT_SD_CARD is off)
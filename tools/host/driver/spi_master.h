@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/spi_common.h"
+
+// The one device on the bus is the ST7789 model of tools/sim/sim_panel.c.
+#define SPI_MASTER_FREQ_8M	(80 * 1000 * 1000 / 10)
+#define SPI_MASTER_FREQ_10M	(80 * 1000 * 1000 / 8)
+#define SPI_MASTER_FREQ_20M	(80 * 1000 * 1000 / 4)
+#define SPI_MASTER_FREQ_26M	(80 * 1000 * 1000 / 3)
+#define SPI_MASTER_FREQ_40M	(80 * 1000 * 1000 / 2)
+#define SPI_MASTER_FREQ_80M	(80 * 1000 * 1000 / 1)
+
+#define SPI_DEVICE_NO_DUMMY	(1 << 6)
+#define SPI_TRANS_USE_TXDATA	(1 << 3)
+
+typedef struct {
+	uint8_t command_bits;
+	uint8_t address_bits;
+	uint8_t dummy_bits;
+	uint8_t mode;
+	int clock_speed_hz;
+	int spics_io_num;
+	uint32_t flags;
+	int queue_size;
+} spi_device_interface_config_t;
+
+typedef struct {
+	uint32_t flags;
+	uint16_t cmd;
+	uint64_t addr;
+	size_t length;		// bits
+	size_t rxlength;
+	void *user;
+	union {
+		const void *tx_buffer;
+		uint8_t tx_data[4];
+	};
+	union {
+		void *rx_buffer;
+		uint8_t rx_data[4];
+	};
+} spi_transaction_t;
+
+typedef struct spi_device_t *spi_device_handle_t;
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+	spi_device_handle_t *handle);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans);
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans);
@@ -0,0 +1,28 @@
+#pragma once
+// the C headers IDF's esp_err.h brings along, which sources rely on
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK					0
+#define ESP_FAIL				-1
+#define ESP_ERR_NO_MEM			0x101
+#define ESP_ERR_INVALID_ARG		0x102
+#define ESP_ERR_INVALID_STATE	0x103
+#define ESP_ERR_INVALID_SIZE	0x104
+#define ESP_ERR_NOT_FOUND		0x105
+#define ESP_ERR_NOT_SUPPORTED	0x106
+#define ESP_ERR_TIMEOUT			0x107
+#define ESP_ERR_INVALID_CRC		0x109
+
+const char *esp_err_to_name(esp_err_t code);
+
+// aborts like the device (which would reset) when expr is not ESP_OK
+void host_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr);
+#define ESP_ERROR_CHECK(x) do { \
+		esp_err_t err_rc_ = (x); \
+		if (err_rc_ != ESP_OK) host_error_check_failed(err_rc_, __FILE__, __LINE__, #x); \
+	} while (0)
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+// No network stack on the host: registrations are accepted and never fire.
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+typedef void *esp_event_handler_instance_t;
+
+extern esp_event_base_t const IP_EVENT;
+typedef enum {
+	IP_EVENT_STA_GOT_IP,
+	IP_EVENT_STA_LOST_IP,
+} ip_event_t;
+
+esp_err_t esp_event_loop_create_default(void);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id,
+	esp_event_handler_t handler, void *arg, esp_event_handler_instance_t *instance);
@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_SPIRAM	(1 << 10)
+#define MALLOC_CAP_INTERNAL	(1 << 11)
+#define MALLOC_CAP_DEFAULT	(1 << 12)
+#define MALLOC_CAP_8BIT		(1 << 2)
+#define MALLOC_CAP_DMA		(1 << 3)
+
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
+// what the device would have left: HOST_HEAP_SIZE minus the live bytes of host_port.h
+size_t heap_caps_get_free_size(uint32_t caps);
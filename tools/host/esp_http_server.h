@@ -0,0 +1,101 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// The subset of esp_http_server the file server uses, served from a plain
+// TCP socket by tools/sim/sim_httpd.c: one connection at a time, every
+// response closes it.
+typedef void *httpd_handle_t;
+
+typedef enum {
+	HTTP_DELETE = 0,
+	HTTP_GET = 1,
+	HTTP_HEAD = 2,
+	HTTP_POST = 3,
+	HTTP_PUT = 4,
+} httpd_method_t;
+
+typedef enum {
+	HTTPD_400_BAD_REQUEST,
+	HTTPD_404_NOT_FOUND,
+	HTTPD_408_REQ_TIMEOUT,
+	HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+#define HTTPD_MAX_URI_LEN		512
+#define HTTPD_SOCK_ERR_FAIL		-1
+#define HTTPD_SOCK_ERR_INVALID	-2
+#define HTTPD_SOCK_ERR_TIMEOUT	-3
+
+#define ESP_ERR_HTTPD_BASE				0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL		(ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_INVALID_REQ		(ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESP_SEND			(ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_TASK				(ESP_ERR_HTTPD_BASE + 8)
+
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+typedef struct {
+	uint16_t server_port;
+	uint16_t max_uri_handlers;
+	uint16_t recv_wait_timeout;	// seconds
+	uint16_t send_wait_timeout;
+	BaseType_t core_id;			// ignored, like task cores in host_port.c
+	httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {	\
+	.server_port = 80,				\
+	.max_uri_handlers = 8,			\
+	.recv_wait_timeout = 5,			\
+	.send_wait_timeout = 5,			\
+	.core_id = tskNO_AFFINITY,		\
+	.uri_match_fn = NULL,			\
+}
+
+typedef struct httpd_req {
+	httpd_handle_t handle;
+	int method;
+	const char uri[HTTPD_MAX_URI_LEN + 1];
+	size_t content_len;
+	void *aux;
+	void *user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+	const char *uri;
+	httpd_method_t method;
+	esp_err_t (*handler)(httpd_req_t *r);
+	void *user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto);
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len);
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg);
+
+#define HTTPD_RESP_USE_STRLEN -1
+
+static inline esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str)
+{
+	return httpd_resp_send(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
+
+static inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str)
+{
+	return httpd_resp_send_chunk(r, str, str ? HTTPD_RESP_USE_STRLEN : 0);
+}
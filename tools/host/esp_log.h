@@ -0,0 +1,21 @@
+#pragma once
+#include <stdio.h>
+#include "sdkconfig.h"
+
+// Lines go to stderr as "I (ms) TAG: message", like the device console.
+// HOST_LOG_LEVEL picks what is printed: 1 errors, 2 + warnings, 3 + info,
+// 4 + debug, 5 + verbose (default 3, CONFIG_LOG_DEFAULT_LEVEL_INFO).
+#ifndef HOST_LOG_LEVEL
+#define HOST_LOG_LEVEL 3
+#endif
+
+void host_log(char level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define HOST_LOG(n, c, tag, format, ...) \
+	do { if (HOST_LOG_LEVEL >= (n)) host_log(c, tag, format, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, format, ...)	HOST_LOG(1, 'E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)	HOST_LOG(2, 'W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...)	HOST_LOG(3, 'I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)	HOST_LOG(4, 'D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)	HOST_LOG(5, 'V', tag, format, ##__VA_ARGS__)
@@ -0,0 +1,2 @@
+#pragma once
+// no ROM on the host; CONFIG_JD_USE_ROM is 0 so tjpgd is built from source
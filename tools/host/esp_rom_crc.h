@@ -0,0 +1,6 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// same value as the ROM routine: zlib/miniz CRC-32, continued from crc
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
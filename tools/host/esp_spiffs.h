@@ -0,0 +1,18 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Mounted partitions are host directories (tools/sim/sim_vfs.c): paths under
+// base_path are redirected to the directory given for partition_label.
+typedef struct {
+	const char *base_path;
+	const char *partition_label;
+	size_t max_files;
+	bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label);
+// total is the partition size from partitions.csv, used the bytes of the files in the directory
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
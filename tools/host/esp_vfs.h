@@ -0,0 +1,6 @@
+#pragma once
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+// longest VFS mount prefix, as in IDF
+#define ESP_VFS_PATH_MAX 15
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#ifdef CONFIG_FREERTOS_HZ
+#define configTICK_RATE_HZ	CONFIG_FREERTOS_HZ
+#else
+#define configTICK_RATE_HZ	100
+#endif
+
+#define pdFALSE			0
+#define pdTRUE			1
+#define pdPASS			1
+#define pdFAIL			0
+#define portMAX_DELAY	((TickType_t)0xffffffff)
+#define portTICK_PERIOD_MS	((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)	((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+#ifndef BIT0
+#define BIT7	0x00000080
+#define BIT6	0x00000040
+#define BIT5	0x00000020
+#define BIT4	0x00000010
+#define BIT3	0x00000008
+#define BIT2	0x00000004
+#define BIT1	0x00000002
+#define BIT0	0x00000001
+#endif
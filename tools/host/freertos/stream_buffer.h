@@ -0,0 +1,15 @@
+#pragma once
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_stream *StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger);
+// waits for room for min(len, size) bytes, then writes what fits
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t wait);
+// waits for trigger bytes, then reads what is there
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *data, size_t len, TickType_t wait);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb);
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t sb);
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb);
+void vStreamBufferDelete(StreamBufferHandle_t sb);
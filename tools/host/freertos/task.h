@@ -0,0 +1,24 @@
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskIDLE_PRIORITY	((UBaseType_t)0)
+#define tskNO_AFFINITY		((BaseType_t)0x7FFFFFFF)
+
+// tasks are detached pthreads; priority and core only matter to the caller's bookkeeping
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+	UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+	UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelete(TaskHandle_t task); // NULL only: ends the calling thread
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xPortGetCoreID(void);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+
+// direct-to-task notification, counting semaphore flavour
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
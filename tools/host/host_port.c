@@ -0,0 +1,717 @@
+/*
+ * Host implementations of the ESP-IDF, FreeRTOS and miniz functions the
+ * decoders and the application call: tasks, semaphores, notifications,
+ * event groups, queues and stream buffers on pthreads, heap_caps on malloc,
+ * tinfl and the ROM CRC on zlib, the console log on stderr. Plus the heap
+ * accounting of host_port.h.
+ *
+ * Timeouts are honoured; priorities and cores are not (every task is a
+ * plain thread and the host scheduler decides).
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+#include "miniz.h"
+#include "host_port.h"
+
+// internal RAM left to the application after boot, for heap_caps_get_free_size()
+#ifndef HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE (300 * 1024)
+#endif
+
+// ---------------------------------------------------------------- heap
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_heap_t heap;
+
+static void heap_count(void *old, size_t old_size, void *ptr)
+{
+	pthread_mutex_lock(&heap_lock);
+	if (old) heap.live -= old_size;
+	if (ptr) {
+		heap.live += malloc_usable_size(ptr);
+		heap.count++;
+		if (heap.live > heap.peak) heap.peak = heap.live;
+	}
+	pthread_mutex_unlock(&heap_lock);
+}
+
+void *__wrap_malloc(size_t size)
+{
+	void *ptr = __real_malloc(size);
+	heap_count(NULL, 0, ptr);
+	return ptr;
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+	void *ptr = __real_calloc(n, size);
+	heap_count(NULL, 0, ptr);
+	return ptr;
+}
+
+void *__wrap_realloc(void *old, size_t size)
+{
+	size_t old_size = old ? malloc_usable_size(old) : 0;
+	void *ptr = __real_realloc(old, size);
+	// a failed realloc leaves the old block allocated
+	if (ptr || !size) heap_count(old, old_size, ptr);
+	return ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+	if (!ptr) return;
+	heap_count(ptr, malloc_usable_size(ptr), NULL);
+	__real_free(ptr);
+}
+
+void host_heap_reset(void)
+{
+	pthread_mutex_lock(&heap_lock);
+	heap.peak = heap.live;
+	heap.count = 0;
+	pthread_mutex_unlock(&heap_lock);
+}
+
+host_heap_t host_heap_get(void)
+{
+	pthread_mutex_lock(&heap_lock);
+	host_heap_t h = heap;
+	pthread_mutex_unlock(&heap_lock);
+	return h;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+	return malloc(size);
+}
+
+void heap_caps_free(void *ptr)
+{
+	free(ptr);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+	switch (code) {
+	case ESP_OK: return "ESP_OK";
+	case ESP_FAIL: return "ESP_FAIL";
+	case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+	case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+	case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+	case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+	case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+	case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+	case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+	case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+	default: return "UNKNOWN ERROR";
+	}
+}
+
+// ---------------------------------------------------------------- FreeRTOS
+
+static struct timespec ticks_deadline(TickType_t wait)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	uint64_t ns = (uint64_t)ts.tv_nsec + (uint64_t)wait * portTICK_PERIOD_MS * 1000000;
+	ts.tv_sec += ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+	return ts;
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+// waits on cond until ready() or wait ticks pass; called with lock held
+static bool cond_wait_ticks(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t wait,
+	bool (*ready)(void *), void *arg)
+{
+	if (wait == portMAX_DELAY) {
+		while (!ready(arg)) pthread_cond_wait(cond, lock);
+		return true;
+	}
+	struct timespec deadline = ticks_deadline(wait);
+	while (!ready(arg)) {
+		if (pthread_cond_timedwait(cond, lock, &deadline) == ETIMEDOUT) return ready(arg);
+	}
+	return true;
+}
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int count;
+} host_sem_t;
+
+static bool sem_ready(void *arg)
+{
+	return ((host_sem_t *)arg)->count > 0;
+}
+
+static SemaphoreHandle_t sem_new(int count)
+{
+	host_sem_t *s = malloc(sizeof(host_sem_t));
+	if (!s) return NULL;
+	pthread_mutex_init(&s->lock, NULL);
+	cond_init(&s->cond);
+	s->count = count;
+	return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	return sem_new(1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+	return sem_new(0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+	host_sem_t *s = sem;
+	pthread_mutex_lock(&s->lock);
+	bool taken = cond_wait_ticks(&s->cond, &s->lock, wait, sem_ready, s);
+	if (taken) s->count = 0;
+	pthread_mutex_unlock(&s->lock);
+	return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	host_sem_t *s = sem;
+	pthread_mutex_lock(&s->lock);
+	s->count = 1;
+	pthread_cond_signal(&s->cond);
+	pthread_mutex_unlock(&s->lock);
+	return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	host_sem_t *s = sem;
+	pthread_cond_destroy(&s->cond);
+	pthread_mutex_destroy(&s->lock);
+	free(s);
+}
+
+// Handles live as long as the process: a deleted task's handle may still be
+// notified by someone who has not heard about it yet.
+struct host_task {
+	TaskFunction_t task;
+	void *arg;
+	UBaseType_t priority;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint32_t notified;
+};
+
+static __thread struct host_task *current_task;
+
+static void *task_main(void *p)
+{
+	current_task = p;
+	current_task->task(current_task->arg);
+	return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+	UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+	struct host_task *t = __real_calloc(1, sizeof(struct host_task));
+	pthread_t thread;
+	if (!t) return pdFALSE;
+	t->task = task;
+	t->arg = arg;
+	t->priority = priority;
+	pthread_mutex_init(&t->lock, NULL);
+	cond_init(&t->cond);
+	if (pthread_create(&thread, NULL, task_main, t) != 0) {
+		__real_free(t);
+		return pdFALSE;
+	}
+	pthread_detach(thread);
+	if (handle) *handle = t;
+	return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack, void *arg,
+	UBaseType_t priority, TaskHandle_t *handle)
+{
+	return xTaskCreatePinnedToCore(task, name, stack, arg, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if (!task) pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec ts = {
+		.tv_sec = (time_t)ticks * portTICK_PERIOD_MS / 1000,
+		.tv_nsec = (long)((uint64_t)ticks * portTICK_PERIOD_MS % 1000) * 1000000,
+	};
+	while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return current_task;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+	return 0;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+	if (!task) task = current_task;
+	return task ? task->priority : 1;
+}
+
+static bool task_notified(void *arg)
+{
+	return ((struct host_task *)arg)->notified > 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+	struct host_task *t = current_task;
+	if (!t) return 0; // not a task of ours (main thread)
+	pthread_mutex_lock(&t->lock);
+	uint32_t n = 0;
+	if (cond_wait_ticks(&t->cond, &t->lock, wait, task_notified, t)) {
+		n = t->notified;
+		t->notified = clear ? 0 : n - 1;
+	}
+	pthread_mutex_unlock(&t->lock);
+	return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	pthread_mutex_lock(&task->lock);
+	task->notified++;
+	pthread_cond_signal(&task->cond);
+	pthread_mutex_unlock(&task->lock);
+	return pdPASS;
+}
+
+struct host_event_group {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	EventBits_t bits;
+	EventBits_t want;
+	bool all;
+};
+
+static bool group_ready(void *arg)
+{
+	struct host_event_group *g = arg;
+	EventBits_t hit = g->bits & g->want;
+	return g->all ? hit == g->want : hit != 0;
+}
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+	struct host_event_group *g = calloc(1, sizeof(struct host_event_group));
+	if (!g) return NULL;
+	pthread_mutex_init(&g->lock, NULL);
+	cond_init(&g->cond);
+	return g;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t g, EventBits_t bits)
+{
+	pthread_mutex_lock(&g->lock);
+	g->bits |= bits;
+	EventBits_t now = g->bits;
+	pthread_cond_broadcast(&g->cond);
+	pthread_mutex_unlock(&g->lock);
+	return now;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t g, EventBits_t bits)
+{
+	pthread_mutex_lock(&g->lock);
+	EventBits_t before = g->bits;
+	g->bits &= ~bits;
+	pthread_mutex_unlock(&g->lock);
+	return before;
+}
+
+// one waiter at a time, which is all the application has
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t g, EventBits_t bits, BaseType_t clear,
+	BaseType_t all, TickType_t wait)
+{
+	pthread_mutex_lock(&g->lock);
+	g->want = bits;
+	g->all = all;
+	bool met = cond_wait_ticks(&g->cond, &g->lock, wait, group_ready, g);
+	EventBits_t now = g->bits;
+	if (met && clear) g->bits &= ~bits;
+	pthread_mutex_unlock(&g->lock);
+	return now;
+}
+
+void vEventGroupDelete(EventGroupHandle_t g)
+{
+	pthread_cond_destroy(&g->cond);
+	pthread_mutex_destroy(&g->lock);
+	free(g);
+}
+
+struct host_queue {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint8_t *items;
+	UBaseType_t length;
+	UBaseType_t size;
+	UBaseType_t head;
+	UBaseType_t count;
+};
+
+static bool queue_has_room(void *arg)
+{
+	struct host_queue *q = arg;
+	return q->count < q->length;
+}
+
+static bool queue_has_item(void *arg)
+{
+	return ((struct host_queue *)arg)->count > 0;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+	struct host_queue *q = calloc(1, sizeof(struct host_queue));
+	if (!q) return NULL;
+	q->items = malloc((size_t)length * item_size);
+	if (!q->items) {
+		free(q);
+		return NULL;
+	}
+	pthread_mutex_init(&q->lock, NULL);
+	cond_init(&q->cond);
+	q->length = length;
+	q->size = item_size;
+	return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+	pthread_mutex_lock(&q->lock);
+	bool room = cond_wait_ticks(&q->cond, &q->lock, wait, queue_has_room, q);
+	if (room) {
+		memcpy(q->items + (size_t)((q->head + q->count) % q->length) * q->size, item, q->size);
+		q->count++;
+		pthread_cond_broadcast(&q->cond);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return room ? pdPASS : pdFAIL;
+}
+
+static BaseType_t queue_take(QueueHandle_t q, void *item, TickType_t wait, bool remove)
+{
+	pthread_mutex_lock(&q->lock);
+	bool have = cond_wait_ticks(&q->cond, &q->lock, wait, queue_has_item, q);
+	if (have) {
+		memcpy(item, q->items + (size_t)q->head * q->size, q->size);
+		if (remove) {
+			q->head = (q->head + 1) % q->length;
+			q->count--;
+			pthread_cond_broadcast(&q->cond);
+		}
+	}
+	pthread_mutex_unlock(&q->lock);
+	return have ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+	return queue_take(q, item, wait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t q, void *item, TickType_t wait)
+{
+	return queue_take(q, item, wait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+	pthread_mutex_lock(&q->lock);
+	UBaseType_t n = q->count;
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+	pthread_cond_destroy(&q->cond);
+	pthread_mutex_destroy(&q->lock);
+	free(q->items);
+	free(q);
+}
+
+// one sender and one receiver, like FreeRTOS assumes
+struct host_stream {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint8_t *data;
+	size_t size;
+	size_t trigger;
+	size_t head;		// next byte to read
+	size_t used;
+	size_t want;		// bytes of room the sender waits for
+};
+
+static bool stream_has_room(void *arg)
+{
+	struct host_stream *sb = arg;
+	return sb->size - sb->used >= sb->want;
+}
+
+static bool stream_has_data(void *arg)
+{
+	struct host_stream *sb = arg;
+	return sb->used >= sb->trigger;
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger)
+{
+	struct host_stream *sb = calloc(1, sizeof(struct host_stream));
+	if (!sb) return NULL;
+	sb->data = malloc(size);
+	if (!sb->data) {
+		free(sb);
+		return NULL;
+	}
+	pthread_mutex_init(&sb->lock, NULL);
+	cond_init(&sb->cond);
+	sb->size = size;
+	sb->trigger = trigger ? trigger : 1;
+	return sb;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t sb, const void *data, size_t len, TickType_t wait)
+{
+	pthread_mutex_lock(&sb->lock);
+	sb->want = len < sb->size ? len : sb->size;
+	cond_wait_ticks(&sb->cond, &sb->lock, wait, stream_has_room, sb);
+	size_t n = sb->size - sb->used;
+	if (n > len) n = len;
+	for (size_t i = 0; i < n; i++) {
+		sb->data[(sb->head + sb->used + i) % sb->size] = ((const uint8_t *)data)[i];
+	}
+	sb->used += n;
+	if (n) pthread_cond_broadcast(&sb->cond);
+	pthread_mutex_unlock(&sb->lock);
+	return n;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t sb, void *data, size_t len, TickType_t wait)
+{
+	pthread_mutex_lock(&sb->lock);
+	cond_wait_ticks(&sb->cond, &sb->lock, wait, stream_has_data, sb);
+	size_t n = sb->used < len ? sb->used : len;
+	for (size_t i = 0; i < n; i++) {
+		((uint8_t *)data)[i] = sb->data[(sb->head + i) % sb->size];
+	}
+	sb->head = (sb->head + n) % sb->size;
+	sb->used -= n;
+	if (n) pthread_cond_broadcast(&sb->cond);
+	pthread_mutex_unlock(&sb->lock);
+	return n;
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t sb)
+{
+	pthread_mutex_lock(&sb->lock);
+	sb->head = sb->used = 0;
+	pthread_cond_broadcast(&sb->cond);
+	pthread_mutex_unlock(&sb->lock);
+	return pdPASS;
+}
+
+size_t xStreamBufferBytesAvailable(StreamBufferHandle_t sb)
+{
+	pthread_mutex_lock(&sb->lock);
+	size_t n = sb->used;
+	pthread_mutex_unlock(&sb->lock);
+	return n;
+}
+
+BaseType_t xStreamBufferIsEmpty(StreamBufferHandle_t sb)
+{
+	return xStreamBufferBytesAvailable(sb) == 0 ? pdTRUE : pdFALSE;
+}
+
+void vStreamBufferDelete(StreamBufferHandle_t sb)
+{
+	pthread_cond_destroy(&sb->cond);
+	pthread_mutex_destroy(&sb->lock);
+	free(sb->data);
+	free(sb);
+}
+
+// ---------------------------------------------------------------- esp_system, esp_timer, esp_log
+
+static struct timespec start_time;
+
+__attribute__((constructor)) static void start_clock(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+int64_t esp_timer_get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)(ts.tv_sec - start_time.tv_sec) * 1000000 + (ts.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void host_log(char level, const char *tag, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	pthread_mutex_lock(&log_lock);
+	fprintf(stderr, "%c (%lld) %s: ", level, (long long)(esp_timer_get_time() / 1000), tag);
+	vfprintf(stderr, format, ap);
+	fputc('\n', stderr);
+	pthread_mutex_unlock(&log_lock);
+	va_end(ap);
+}
+
+void host_error_check_failed(esp_err_t rc, const char *file, int line, const char *expr)
+{
+	fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\nexpression: %s\n",
+		rc, esp_err_to_name(rc), file, line, expr);
+	abort();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+	if (caps & MALLOC_CAP_SPIRAM) return 0; // no PSRAM on the board
+	size_t live = host_heap_get().live;
+	return live < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - live : 0;
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+	return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+
+void esp_restart(void)
+{
+	fprintf(stderr, "esp_restart()\n");
+	exit(0);
+}
+
+// ---------------------------------------------------------------- miniz
+
+// zlib state from the real allocator: on the device it is part of pngle_t
+static voidpf zalloc_real(voidpf opaque, uInt n, uInt size)
+{
+	return __real_calloc(n, size);
+}
+
+static void zfree_real(voidpf opaque, voidpf ptr)
+{
+	__real_free(ptr);
+}
+
+enum { INFLATE_NEW, INFLATE_RUNNING, INFLATE_DONE };
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+	mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags)
+{
+	if (r->m_state == INFLATE_NEW) {
+		// tinfl_init() on a stream that never finished (an error path) leaks
+		// its zlib state; acceptable for a benchmark
+		z_stream *z = __real_calloc(1, sizeof(z_stream));
+		if (!z) return TINFL_STATUS_FAILED;
+		z->zalloc = zalloc_real;
+		z->zfree = zfree_real;
+		if (inflateInit2(z, (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? MAX_WBITS : -MAX_WBITS) != Z_OK) {
+			__real_free(z);
+			return TINFL_STATUS_FAILED;
+		}
+		r->stream = z;
+		r->m_state = INFLATE_RUNNING;
+	}
+	if (r->m_state == INFLATE_DONE) {
+		*pIn_buf_size = 0;
+		*pOut_buf_size = 0;
+		return TINFL_STATUS_DONE;
+	}
+
+	z_stream *z = r->stream;
+	z->next_in = (Bytef *)pIn_buf_next;
+	z->avail_in = *pIn_buf_size;
+	z->next_out = pOut_buf_next;
+	z->avail_out = *pOut_buf_size;
+	int ret = inflate(z, Z_NO_FLUSH);
+	*pIn_buf_size -= z->avail_in;
+	*pOut_buf_size -= z->avail_out;
+	if (ret == Z_STREAM_END) {
+		inflateEnd(z);
+		__real_free(z);
+		r->stream = NULL;
+		r->m_state = INFLATE_DONE;
+		return TINFL_STATUS_DONE;
+	}
+	if (ret != Z_OK && ret != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+	return z->avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+mz_ulong mz_crc32(mz_ulong crc, const unsigned char *ptr, size_t buf_len)
+{
+	return crc32(crc, ptr, buf_len);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+	return crc32(crc, buf, len);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stddef.h>
+
+/*
+ * Heap accounting for the host builds. They are linked with
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free, so every
+ * allocation made by the decoders (and the harness around them) passes
+ * through the counters below. Allocations made inside libc or zlib are not seen; the
+ * zlib inflate state stands in for tinfl, which lives inside pngle_t on the
+ * device, and is kept out of the numbers on purpose.
+ */
+typedef struct {
+	size_t live;		// bytes currently allocated
+	size_t peak;		// highest live since host_heap_reset()
+	unsigned count;		// malloc/calloc/realloc calls since host_heap_reset()
+} host_heap_t;
+
+void host_heap_reset(void); // peak = live, count = 0
+host_heap_t host_heap_get(void);
@@ -0,0 +1,33 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// The tinfl subset pngle uses, implemented over zlib in host_port.c. The
+// decompressor keeps miniz's size so pngle_t is laid out as on the device.
+typedef unsigned long mz_ulong;
+typedef uint8_t mz_uint8;
+typedef uint32_t mz_uint32;
+
+#define MZ_CRC32_INIT					0
+#define TINFL_LZ_DICT_SIZE				32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER	1
+#define TINFL_FLAG_HAS_MORE_INPUT		2
+
+typedef enum {
+	TINFL_STATUS_FAILED = -1,
+	TINFL_STATUS_DONE = 0,
+	TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+	TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+	mz_uint32 m_state;
+	void *stream;
+	uint8_t reserved[11000 - 16];
+} tinfl_decompressor;
+
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const mz_uint8 *pIn_buf_next, size_t *pIn_buf_size,
+	mz_uint8 *pOut_buf_start, mz_uint8 *pOut_buf_next, size_t *pOut_buf_size, const mz_uint32 decomp_flags);
+mz_ulong mz_crc32(mz_ulong crc, const unsigned char *ptr, size_t buf_len);
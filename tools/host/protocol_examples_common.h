@@ -0,0 +1,5 @@
+#pragma once
+#include "esp_err.h"
+
+// the host is already on the network: always ESP_OK
+esp_err_t example_connect(void);
@@ -0,0 +1,2 @@
+#pragma once
+#define SOC_SDMMC_HOST_SUPPORTED 0
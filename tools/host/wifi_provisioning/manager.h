@@ -0,0 +1,2 @@
+#pragma once
+// provisioning is never needed on the host (example_connect() succeeds)
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Add restart markers to JPEGs so the device can decode them on both cores.
+
+The device splits the image at restart (RSTn) markers: one marker per MCU
+row lets two decoders work on alternating rows (decode_jpeg_parallel) and
+lets a viewport skip rows it does not show (decode_jpeg_viewport). The
+conversion is lossless, jpegtran only re-packs the entropy-coded data.
+
+    python3 tools/jpeg_restart.py photo.jpg -o photo_rst.jpg
+    python3 tools/jpeg_restart.py --blocks 4 *.jpg -o out/
+
+Every positional argument is a source image. The output is only ever
+given with -o: a file for a single input, otherwise a directory. Without
+-o each result is written next to its source as name_rst.jpg, and nothing
+is written over a source image.
+
+Progressive JPEGs are turned into baseline, which the device needs anyway.
+Requires jpegtran (libjpeg-turbo-progs / libjpeg-progs).
+"""
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+
+def restart_interval(path):
+    """Return the DRI interval of a JPEG, 0 if it has none."""
+    with open(path, "rb") as f:
+        if f.read(2) != b"\xff\xd8":
+            raise ValueError("not a JPEG")
+        while True:
+            head = f.read(4)
+            if len(head) < 4 or head[0] != 0xFF:
+                return 0
+            marker, length = head[1], struct.unpack(">H", head[2:])[0]
+            if marker == 0xDD:
+                return struct.unpack(">H", f.read(2))[0]
+            if marker == 0xDA:
+                return 0
+            f.seek(length - 2, os.SEEK_CUR)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("inputs", nargs="+", help="source JPEG files")
+    ap.add_argument("-o", "--output", help="output file, or directory for several inputs")
+    ap.add_argument("--blocks", type=int,
+                    help="restart every N MCUs instead of every MCU row (N must divide the row "
+                         "so viewports can also skip columns)")
+    args = ap.parse_args()
+
+    jpegtran = shutil.which("jpegtran")
+    if not jpegtran:
+        print("jpegtran not found", file=sys.stderr)
+        return 1
+
+    # every positional argument is a source: the output only ever comes from -o
+    sources = {os.path.abspath(src) for src in args.inputs}
+
+    restart = "%dB" % args.blocks if args.blocks else "1"
+    for src in args.inputs:
+        if args.output and len(args.inputs) == 1 and not os.path.isdir(args.output):
+            dst = args.output
+        else:
+            base, ext = os.path.splitext(os.path.basename(src))
+            dst = os.path.join(args.output or os.path.dirname(src), base + "_rst" + ext)
+        if os.path.abspath(dst) in sources:
+            print("%s: output would overwrite a source image" % dst, file=sys.stderr)
+            return 1
+        subprocess.run([jpegtran, "-copy", "all", "-optimize", "-restart", restart,
+                        "-outfile", dst, src], check=True)
+        print("%s -> %s restart interval %d MCUs, %d -> %d bytes"
+              % (src, dst, restart_interval(dst), os.path.getsize(src), os.path.getsize(dst)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
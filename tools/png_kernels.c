@@ -0,0 +1,375 @@
+/*
+ * Host check and benchmark for the pngle row kernels (components/pngle/pngle_filter.c).
+ *
+ * Every kernel is compared with a byte-wise reference written straight from
+ * the PNG specification, first on random rows for each filter type and
+ * bytes-per-pixel, then on the real scanlines of any PNG files given on the
+ * command line (all passes of interlaced files included). Then each kernel is
+ * timed against its reference.
+ *
+ *     cc -O2 -Icomponents/pngle tools/png_kernels.c components/pngle/pngle_filter.c -lz -o png_kernels
+ *     ./png_kernels photo.png icons.png
+ *
+ * Exit status is non-zero on any mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <zlib.h>
+#include "pngle_filter.h"
+
+#define MAX_ROW		(8 * 4096)
+#define BENCH_BYTES	(64u << 20)
+
+static const char *filter_names[5] = { "none", "sub", "up", "average", "paeth" };
+
+// ---------------------------------------------------------------- reference
+
+static int ref_paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+static void ref_unfilter(int type, uint8_t *cur, const uint8_t *prev, size_t len, int bpp)
+{
+	for (size_t i = 0; i < len; i++) {
+		int a = i >= (size_t)bpp ? cur[i - bpp] : 0;
+		int b = prev[i];
+		int c = i >= (size_t)bpp ? prev[i - bpp] : 0;
+		switch (type) {
+		case 1: cur[i] += a; break;
+		case 2: cur[i] += b; break;
+		case 3: cur[i] += (a + b) / 2; break;
+		case 4: cur[i] += ref_paeth(a, b, c); break;
+		}
+	}
+}
+
+static void ref_unpack_bits(uint8_t *dst, const uint8_t *src, size_t n, int depth)
+{
+	for (size_t i = 0; i < n; i++) {
+		size_t bit = i * depth;
+		dst[i] = (src[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+	}
+}
+
+static void ref_rgb565(uint16_t *dst, const uint8_t *rgba, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		const uint8_t *p = rgba + i * 4;
+		dst[i] = ((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3);
+	}
+}
+
+static void ref_blend565(uint16_t *dst, const uint8_t *rgba, size_t n, const uint8_t bg[3])
+{
+	for (size_t i = 0; i < n; i++) {
+		const uint8_t *p = rgba + i * 4;
+		uint8_t c[3];
+		for (int k = 0; k < 3; k++) {
+			c[k] = (2 * (p[k] * p[3] + bg[k] * (255 - p[3])) + 255) / 510;
+		}
+		dst[i] = ((c[0] & 0xF8) << 8) | ((c[1] & 0xFC) << 3) | (c[2] >> 3);
+	}
+}
+
+// ---------------------------------------------------------------- row buffers
+
+// rows laid out the way pngle keeps them: word aligned, zero padding in front
+typedef struct {
+	uint8_t mem[PNGLE_ROW_PAD + MAX_ROW] __attribute__((aligned(8)));
+} row_t;
+
+static row_t prev_row, cur_row, ref_row;
+
+static uint8_t *row(row_t *r)
+{
+	return r->mem + PNGLE_ROW_PAD;
+}
+
+static int failures;
+
+static void check_row(const char *what, int type, int bpp, const uint8_t *filtered, const uint8_t *prev, size_t len)
+{
+	memcpy(row(&cur_row), filtered, len);
+	memcpy(row(&ref_row), filtered, len);
+	memcpy(row(&prev_row), prev, len);
+	pngle_unfilter_row(type, row(&cur_row), row(&prev_row), len, bpp);
+	ref_unfilter(type, row(&ref_row), row(&prev_row), len, bpp);
+	if (memcmp(row(&cur_row), row(&ref_row), len) != 0) {
+		if (failures++ < 10) {
+			printf("MISMATCH %s: filter %s bpp %d len %zu\n", what, filter_names[type], bpp, len);
+		}
+	}
+}
+
+static uint32_t rng = 2463534242u;
+
+static uint8_t rnd8(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return (uint8_t)rng;
+}
+
+static void check_random(void)
+{
+	static uint8_t filtered[MAX_ROW], prev[MAX_ROW];
+	static const size_t lens[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 63, 64, 65, 720, 961, 1920, MAX_ROW };
+	int rows = 0;
+
+	for (int type = 0; type < 5; type++) {
+		for (int bpp = 1; bpp <= 8; bpp++) {
+			for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+				for (int k = 0; k < 4; k++) {
+					for (size_t i = 0; i < lens[l]; i++) {
+						filtered[i] = rnd8();
+						prev[i] = k == 0 ? 0 : rnd8();
+					}
+					check_row("random", type, bpp, filtered, prev, lens[l]);
+					rows++;
+				}
+			}
+		}
+	}
+
+	static uint8_t packed[MAX_ROW / 8 + 1], a[MAX_ROW], b[MAX_ROW];
+	static uint8_t rgba[MAX_ROW * 4] __attribute__((aligned(4)));
+	static uint16_t x[MAX_ROW], y[MAX_ROW];
+	for (int depth = 1; depth <= 4; depth *= 2) {
+		for (size_t n = 1; n < 70; n++) {
+			for (size_t i = 0; i < sizeof(packed); i++) packed[i] = rnd8();
+			pngle_unpack_bits(a, packed, n, depth);
+			ref_unpack_bits(b, packed, n, depth);
+			if (memcmp(a, b, n) != 0 && failures++ < 10) printf("MISMATCH unpack depth %d n %zu\n", depth, n);
+			rows++;
+		}
+	}
+	for (size_t n = 1; n < 300; n += 7) {
+		for (size_t i = 0; i < n * 4; i++) rgba[i] = rnd8();
+		ref_rgb565(y, rgba, n);
+		pngle_rgba_to_rgb565(x, rgba, n);
+		pngle_rgba_to_rgb565((uint16_t *)rgba, rgba, n);	// in place, as pngle uses it
+		if ((memcmp(x, y, n * 2) != 0 || memcmp(rgba, y, n * 2) != 0) && failures++ < 10) printf("MISMATCH rgb565 n %zu\n", n);
+		rows++;
+	}
+	for (size_t n = 1; n < 300; n += 7) {
+		// alpha mostly 0 or 255 in runs, like real artwork, plus partial edges
+		uint8_t bg[3] = { rnd8(), rnd8(), rnd8() }, alpha = 255;
+		for (size_t i = 0; i < n * 4; i++) rgba[i] = rnd8();
+		for (size_t i = 0; i < n; i++) {
+			uint8_t r = rnd8();
+			if (r < 40) alpha = r & 1 ? 0 : 255;
+			rgba[i * 4 + 3] = r < 80 ? r * 3 : alpha;
+		}
+		ref_blend565(y, rgba, n, bg);
+		pngle_rgba_blend_rgb565(x, rgba, n, bg);
+		pngle_rgba_blend_rgb565((uint16_t *)rgba, rgba, n, bg);
+		if ((memcmp(x, y, n * 2) != 0 || memcmp(rgba, y, n * 2) != 0) && failures++ < 10) printf("MISMATCH blend565 n %zu\n", n);
+		rows++;
+	}
+	printf("random rows: %d checked\n", rows);
+}
+
+// ---------------------------------------------------------------- PNG corpus
+
+static uint32_t be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static int check_png(const char *path)
+{
+	static const int off_x[7] = { 0, 4, 0, 2, 0, 1, 0 }, off_y[7] = { 0, 0, 4, 0, 2, 0, 1 };
+	static const int div_x[7] = { 8, 8, 4, 4, 2, 2, 1 }, div_y[7] = { 8, 8, 8, 4, 4, 2, 2 };
+	static const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+
+	FILE *fp = fopen(path, "rb");
+	if (!fp) {
+		printf("%s: cannot open\n", path);
+		return -1;
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	rewind(fp);
+	uint8_t *file = malloc(size);
+	if (fread(file, 1, size, fp) != (size_t)size) size = 0;
+	fclose(fp);
+
+	// concatenate IDAT, inflate
+	uint8_t *idat = malloc(size);
+	size_t idat_len = 0;
+	uint32_t width = 0, height = 0;
+	int depth = 0, color = 0, interlace = 0;
+	for (long pos = 8; pos + 12 <= size;) {
+		uint32_t len = be32(file + pos);
+		const uint8_t *type = file + pos + 4, *data = file + pos + 8;
+		if (pos + 12 + (long)len > size) break;
+		if (!memcmp(type, "IHDR", 4)) {
+			width = be32(data);
+			height = be32(data + 4);
+			depth = data[8];
+			color = data[9];
+			interlace = data[12];
+		} else if (!memcmp(type, "IDAT", 4)) {
+			memcpy(idat + idat_len, data, len);
+			idat_len += len;
+		}
+		pos += 12 + len;
+	}
+	free(file);
+	if (!width || color > 6 || !channels[color]) {
+		printf("%s: not a PNG\n", path);
+		free(idat);
+		return -1;
+	}
+
+	int bpp = (channels[color] * depth + 7) / 8;
+	size_t raw_cap = 0;
+	for (int p = 0; p < 7; p++) {
+		raw_cap += (size_t)((height + div_y[p] - 1) / div_y[p]) * (1 + ((size_t)(width + div_x[p] - 1) / div_x[p] * channels[color] * depth + 7) / 8);
+	}
+	raw_cap += (size_t)height * (1 + ((size_t)width * channels[color] * depth + 7) / 8);
+	uint8_t *raw = malloc(raw_cap);
+	uLongf raw_len = raw_cap;
+	if (uncompress(raw, &raw_len, idat, idat_len) != Z_OK) {
+		printf("%s: inflate failed\n", path);
+		free(idat);
+		free(raw);
+		return -1;
+	}
+	free(idat);
+
+	static uint8_t prev[MAX_ROW];
+	const uint8_t *p = raw, *end = raw + raw_len;
+	int rows = 0, passes = interlace ? 7 : 1;
+	for (int pass = 0; pass < passes; pass++) {
+		uint32_t ox = interlace ? off_x[pass] : 0, oy = interlace ? off_y[pass] : 0;
+		uint32_t dx = interlace ? div_x[pass] : 1, dy = interlace ? div_y[pass] : 1;
+		if (ox >= width || oy >= height) continue;
+		size_t len = ((size_t)(width - ox + dx - 1) / dx * channels[color] * depth + 7) / 8;
+		if (len > MAX_ROW) {
+			printf("%s: rows wider than %d bytes are skipped\n", path, MAX_ROW);
+			break;
+		}
+		memset(prev, 0, len);
+		for (uint32_t y = oy; y < height && p + 1 + len <= end; y += dy, p += 1 + len) {
+			if (p[0] > 4) {
+				printf("%s: bad filter type %d\n", path, p[0]);
+				free(raw);
+				return -1;
+			}
+			check_row(path, p[0], bpp, p + 1, prev, len);
+			memcpy(prev, row(&ref_row), len);
+			rows++;
+		}
+	}
+	free(raw);
+	printf("%s: %ux%u depth %d color %d%s, %d rows checked\n", path, width, height, depth, color, interlace ? " interlaced" : "", rows);
+	return 0;
+}
+
+// ---------------------------------------------------------------- benchmark
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(void)
+{
+	const size_t len = 1920;	// a 480-pixel RGBA row
+	const int iters = BENCH_BYTES / len;
+
+	for (size_t i = 0; i < len; i++) {
+		row(&cur_row)[i] = rnd8();
+		row(&prev_row)[i] = rnd8();
+	}
+
+	printf("\n%-10s %3s %12s %12s %8s\n", "kernel", "bpp", "ref MB/s", "fast MB/s", "speedup");
+	for (int type = 1; type < 5; type++) {
+		static const int bpps[] = { 1, 3, 4 };
+		for (size_t b = 0; b < sizeof(bpps) / sizeof(bpps[0]); b++) {
+			int bpp = bpps[b];
+			double t0 = now();
+			for (int i = 0; i < iters; i++) ref_unfilter(type, row(&cur_row), row(&prev_row), len, bpp);
+			double t1 = now();
+			for (int i = 0; i < iters; i++) pngle_unfilter_row(type, row(&cur_row), row(&prev_row), len, bpp);
+			double t2 = now();
+			double mb = (double)iters * len / 1e6;
+			printf("%-10s %3d %12.0f %12.0f %7.1fx\n", filter_names[type], bpp, mb / (t1 - t0), mb / (t2 - t1), (t1 - t0) / (t2 - t1));
+		}
+	}
+
+	static uint8_t packed[MAX_ROW], idx[MAX_ROW * 8];
+	static uint8_t rgba[MAX_ROW * 4] __attribute__((aligned(4)));
+	static uint16_t out[MAX_ROW];
+	for (size_t i = 0; i < sizeof(packed); i++) packed[i] = rnd8();
+	for (int depth = 1; depth <= 4; depth *= 2) {
+		size_t n = 480;
+		int reps = BENCH_BYTES / 4 / n;
+		double t0 = now();
+		for (int i = 0; i < reps; i++) ref_unpack_bits(idx, packed + (i & 63), n, depth);
+		double t1 = now();
+		for (int i = 0; i < reps; i++) pngle_unpack_bits(idx, packed + (i & 63), n, depth);
+		double t2 = now();
+		double mp = (double)reps * n / 1e6;
+		printf("%-8s%d %3s %9.0f Mpx %9.0f Mpx %7.1fx\n", "unpack", depth, "-", mp / (t1 - t0), mp / (t2 - t1), (t1 - t0) / (t2 - t1));
+	}
+	{
+		size_t n = 480;
+		int reps = BENCH_BYTES / 4 / n;
+		for (size_t i = 0; i < n * 4; i++) rgba[i] = rnd8();
+		double t0 = now();
+		for (int i = 0; i < reps; i++) ref_rgb565(out, rgba + (i & 3) * 4, n);
+		double t1 = now();
+		for (int i = 0; i < reps; i++) pngle_rgba_to_rgb565(out, rgba + (i & 3) * 4, n);
+		double t2 = now();
+		double mp = (double)reps * n / 1e6;
+		printf("%-10s %3s %9.0f Mpx %9.0f Mpx %7.1fx\n", "rgb565", "-", mp / (t1 - t0), mp / (t2 - t1), (t1 - t0) / (t2 - t1));
+	}
+	// blend: fully opaque rows (the common case, compare with rgb565), then
+	// a logo-like row of transparent surround, opaque body and soft edges
+	for (int mixed = 0; mixed < 2; mixed++) {
+		size_t n = 480;
+		int reps = BENCH_BYTES / 4 / n;
+		uint8_t bg[3] = { 0x20, 0x40, 0x60 };
+		for (size_t i = 0; i < (n + 4) * 4; i++) rgba[i] = rnd8();
+		for (size_t i = 0; i < n + 4; i++) {
+			int edge = (int)(i % 120);
+			rgba[i * 4 + 3] = !mixed || (edge >= 40 && edge < 80) ? 255 : edge < 30 || edge >= 90 ? 0 : rnd8();
+		}
+		double t0 = now();
+		for (int i = 0; i < reps; i++) ref_blend565(out, rgba + (i & 3) * 4, n, bg);
+		double t1 = now();
+		for (int i = 0; i < reps; i++) pngle_rgba_blend_rgb565(out, rgba + (i & 3) * 4, n, bg);
+		double t2 = now();
+		double mp = (double)reps * n / 1e6;
+		printf("%-10s %3s %9.0f Mpx %9.0f Mpx %7.1fx\n", mixed ? "blend mix" : "blend opq", "-", mp / (t1 - t0), mp / (t2 - t1), (t1 - t0) / (t2 - t1));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	check_random();
+	for (int i = 1; i < argc; i++) {
+		if (check_png(argv[i]) < 0) failures++;
+	}
+	if (failures) {
+		printf("FAILED: %d mismatches\n", failures);
+		return 1;
+	}
+	printf("all kernels bit-exact\n");
+	bench();
+	return 0;
+}
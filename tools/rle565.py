@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Convert images to the device-native RLE565 format (see decode_rle.h).
+
+The image is scaled to fit the screen (aspect ratio kept, never enlarged),
+converted to RGB565 and packed row by row, so the device only has to
+unpack and push pixels to the panel.
+
+    python3 tools/rle565.py photo.jpg -o photo.rle
+    python3 tools/rle565.py --width 240 --height 240 *.png -o out/
+
+Every positional argument is a source image. The output is only ever
+given with -o: a file for a single input, otherwise a directory. Without
+-o each result is written next to its source as name.rle, and nothing is
+written over a source image.
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+from PIL import Image
+
+MAGIC = b"R565"
+VERSION = 1
+
+
+def to_rgb565(img):
+    rgb = img.convert("RGB")
+    w, h = rgb.size
+    data = rgb.tobytes()
+    rows = []
+    for y in range(h):
+        row = []
+        base = y * w * 3
+        for x in range(w):
+            r, g, b = data[base + x * 3: base + x * 3 + 3]
+            row.append(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3))
+        rows.append(row)
+    return rows
+
+
+def pack_row(row):
+    """PackBits over 16-bit pixels: runs of 2..129, literals of 1..128."""
+    out = bytearray()
+    literal = []
+
+    def flush():
+        while literal:
+            chunk = literal[:128]
+            del literal[:128]
+            out.append(len(chunk) - 1)
+            out.extend(struct.pack("<%dH" % len(chunk), *chunk))
+
+    i, n = 0, len(row)
+    while i < n:
+        run = 1
+        while i + run < n and run < 129 and row[i + run] == row[i]:
+            run += 1
+        if run >= 2:
+            flush()
+            out.append(run + 126)
+            out.extend(struct.pack("<H", row[i]))
+            i += run
+        else:
+            literal.append(row[i])
+            i += 1
+    flush()
+    return bytes(out)
+
+
+def encode(img, width, height):
+    scale = min(width / img.width, height / img.height, 1.0)
+    if scale < 1.0:
+        size = (max(1, int(img.width * scale)), max(1, int(img.height * scale)))
+        img = img.resize(size, Image.LANCZOS)
+    rows = [pack_row(r) for r in to_rgb565(img)]
+
+    header = MAGIC + struct.pack("<BBHHH", VERSION, 0, img.width, img.height, 0)
+    offset = len(header) + (len(rows) + 1) * 4
+    index = []
+    for r in rows:
+        index.append(offset)
+        offset += len(r)
+    index.append(offset)
+    return header + struct.pack("<%dI" % len(index), *index) + b"".join(rows), img.size
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("inputs", nargs="+", help="source images (any format Pillow reads)")
+    ap.add_argument("-o", "--output", help="output file, or directory for several inputs")
+    ap.add_argument("--width", type=int, default=240, help="screen width (default 240)")
+    ap.add_argument("--height", type=int, default=240, help="screen height (default 240)")
+    args = ap.parse_args()
+
+    # every positional argument is a source: the output only ever comes from -o
+    sources = {os.path.abspath(src) for src in args.inputs}
+
+    for src in args.inputs:
+        if args.output and len(args.inputs) == 1 and not os.path.isdir(args.output):
+            dst = args.output
+        else:
+            name = os.path.splitext(os.path.basename(src))[0] + ".rle"
+            dst = os.path.join(args.output or os.path.dirname(src), name)
+        if os.path.abspath(dst) in sources:
+            print("%s: output would overwrite a source image" % dst, file=sys.stderr)
+            return 1
+        data, size = encode(Image.open(src), args.width, args.height)
+        with open(dst, "wb") as f:
+            f.write(data)
+        raw = size[0] * size[1] * 2
+        print("%s -> %s %dx%d %d bytes (%.0f%% of raw RGB565)"
+              % (src, dst, size[0], size[1], len(data), 100.0 * len(data) / raw))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
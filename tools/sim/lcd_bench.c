@@ -0,0 +1,309 @@
+/*
+ * SPI bus time of canonical ST7789 workloads, estimated with the cost model
+ * in spi_cost.h from the transactions components/st7789 makes against the
+ * virtual panel (sim_panel.c).
+ *
+ *     make -C tools/sim lcd_bench
+ *     tools/sim/lcd_bench [--fps N] [--screen DIR] [--save FILE | --check FILE]
+ *                         [--tolerance PCT] [model options]
+ *
+ * Workloads, drawn on the panel as main.c sets it up (MADCTL 0x60):
+ *   full_clear    lcdFillScreen
+ *   image_blit    a full screen of lcdDrawMultiPixels rows, like a decoded image
+ *   labels_100    100 short labels with lcdDrawString (ILGH16XB.FNT)
+ *   gauge_redraw  one update of a needle gauge: old needle erased, new needle
+ *                 and hub drawn, value label repainted over a filled box
+ *
+ * Each workload prints its transactions, bytes and DC changes per st7789 API
+ * and the estimated bus time against a frame budget of 1000 / --fps ms.
+ * --screen DIR writes DIR/<workload>.ppm to check what was drawn.
+ *
+ * --save FILE stores the transaction counts as a baseline; --check FILE
+ * prices both the baseline and this run with the current model options and
+ * fails (exit 1) if a workload got slower by more than --tolerance percent
+ * (default 1). Counts are stored rather than times so a baseline stays
+ * valid when the model is recalibrated. The committed baseline is
+ * tools/sim/lcd_bench.baseline:
+ *
+ *     make -C tools/sim check
+ *
+ * The model options are the simulator's: --spi-clock HZ, --spi-queued-us US,
+ * --spi-polling-us US, --spi-dc-us US.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "st7789.h"
+#include "fontx.h"
+#include "sim.h"
+
+#define GAUGE_X		(CONFIG_HEIGHT / 2)
+#define GAUGE_Y		(CONFIG_WIDTH / 2 + 10)
+#define GAUGE_R		100
+#define GAUGE_FACE	BLACK
+
+typedef struct {
+	const char *name;
+	void (*setup)(TFT_t *dev);	// not measured: what is on the screen before
+	void (*draw)(TFT_t *dev);
+} workload_t;
+
+static FontxFile fx16[2];
+static FontxFile fx24[2];
+static uint16_t scrW = CONFIG_HEIGHT;	// 0x60 exchanges rows and columns
+static uint16_t scrH = CONFIG_WIDTH;
+
+// ---------------------------------------------------------------- workloads
+
+static void clear_black(TFT_t *dev)
+{
+	lcdFillScreen(dev, BLACK);
+}
+
+static void full_clear(TFT_t *dev)
+{
+	lcdFillScreen(dev, BLUE);
+}
+
+static void image_blit(TFT_t *dev)
+{
+	uint16_t row[CONFIG_HEIGHT > CONFIG_WIDTH ? CONFIG_HEIGHT : CONFIG_WIDTH];
+	for (int y = 0; y < scrH; y++) {
+		for (int x = 0; x < scrW; x++) {
+			row[x] = rgb565(x * 255 / scrW, y * 255 / scrH, 128);
+		}
+		lcdDrawMultiPixels(dev, 0, y, scrW, row);
+	}
+}
+
+static void labels_100(TFT_t *dev)
+{
+	uint8_t text[8];
+	for (int i = 0; i < 100; i++) {
+		int x = (i % 10) * (scrW / 10);
+		int y = (i / 10) * (scrH / 10) + 16;
+		snprintf((char *)text, sizeof(text), "%02d", i);
+		lcdDrawString(dev, fx16, x, y, text, WHITE);
+	}
+}
+
+static void needle(TFT_t *dev, int value, uint16_t color)
+{
+	// 0..100 over the upper 270 degrees
+	double a = (225.0 - value * 2.7) * M_PI / 180.0;
+	int x = GAUGE_X + (int)lround(cos(a) * (GAUGE_R - 15));
+	int y = GAUGE_Y - (int)lround(sin(a) * (GAUGE_R - 15));
+	for (int d = -1; d <= 1; d++) {
+		lcdDrawLine(dev, GAUGE_X + d, GAUGE_Y, x + d, y, color);
+	}
+}
+
+static void gauge_label(TFT_t *dev, int value)
+{
+	uint8_t text[8];
+	snprintf((char *)text, sizeof(text), "%3d", value);
+	lcdSetFontFill(dev, GAUGE_FACE);
+	lcdDrawString(dev, fx24, GAUGE_X - 18, GAUGE_Y + 50, text, YELLOW);
+	lcdUnsetFontFill(dev);
+}
+
+static void gauge_face(TFT_t *dev)
+{
+	lcdFillScreen(dev, GAUGE_FACE);
+	lcdDrawCircle(dev, GAUGE_X, GAUGE_Y, GAUGE_R, WHITE);
+	for (int v = 0; v <= 100; v += 10) {
+		double a = (225.0 - v * 2.7) * M_PI / 180.0;
+		lcdDrawLine(dev,
+			GAUGE_X + (int)lround(cos(a) * (GAUGE_R - 10)), GAUGE_Y - (int)lround(sin(a) * (GAUGE_R - 10)),
+			GAUGE_X + (int)lround(cos(a) * GAUGE_R), GAUGE_Y - (int)lround(sin(a) * GAUGE_R), WHITE);
+	}
+	needle(dev, 30, RED);
+	lcdDrawFillCircle(dev, GAUGE_X, GAUGE_Y, 6, WHITE);
+	gauge_label(dev, 30);
+}
+
+static void gauge_redraw(TFT_t *dev)
+{
+	needle(dev, 30, GAUGE_FACE);
+	needle(dev, 70, RED);
+	lcdDrawFillCircle(dev, GAUGE_X, GAUGE_Y, 6, WHITE);
+	gauge_label(dev, 70);
+}
+
+static const workload_t workloads[] = {
+	{ "full_clear", clear_black, full_clear },
+	{ "image_blit", clear_black, image_blit },
+	{ "labels_100", clear_black, labels_100 },
+	{ "gauge_redraw", gauge_face, gauge_redraw },
+};
+#define WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+// ---------------------------------------------------------------- baseline
+
+typedef struct {
+	char workload[32];
+	char api[48];
+	spi_cost_line_t line;
+} baseline_t;
+
+static baseline_t *base;
+static int base_n;
+
+// "workload api queued polled dc_changes bytes" per line, '#' comments
+static bool load_baseline(const char *path)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		perror(path);
+		return false;
+	}
+	char text[256];
+	while (fgets(text, sizeof(text), fp)) {
+		if (text[0] == '#' || text[0] == '\n') continue;
+		baseline_t b = { 0 };
+		unsigned long long bytes;
+		if (sscanf(text, "%31s %47s %u %u %u %llu", b.workload, b.api,
+				&b.line.queued, &b.line.polled, &b.line.dc_changes, &bytes) != 6) {
+			fprintf(stderr, "%s: bad line: %s", path, text);
+			fclose(fp);
+			return false;
+		}
+		b.line.bytes = bytes;
+		base = realloc(base, (base_n + 1) * sizeof(*base));
+		base[base_n++] = b;
+	}
+	fclose(fp);
+	for (int i = 0; i < base_n; i++) base[i].line.api = base[i].api;
+	return true;
+}
+
+static const spi_cost_line_t *baseline(const char *workload, const char *api)
+{
+	for (int i = 0; i < base_n; i++) {
+		if (strcmp(base[i].workload, workload) == 0 && strcmp(base[i].api, api) == 0) {
+			return &base[i].line;
+		}
+	}
+	return NULL;
+}
+
+// ---------------------------------------------------------------- report
+
+static double ms(const spi_cost_model_t *m, int clock_hz, const spi_cost_line_t *l)
+{
+	return spi_cost_ns(m, clock_hz, l) / 1e6;
+}
+
+static void print_line(const spi_cost_model_t *m, int clock_hz, const char *workload,
+	const spi_cost_line_t *l)
+{
+	printf("  %-22s %7u %7u %9llu %6u %9.3f", l->api, l->queued, l->polled,
+		(unsigned long long)l->bytes, l->dc_changes, ms(m, clock_hz, l));
+	const spi_cost_line_t *b = base ? baseline(workload, l->api) : NULL;
+	if (b) {
+		double was = ms(m, clock_hz, b);
+		printf(" %9.3f %+7.1f%%", was, was > 0 ? (ms(m, clock_hz, l) - was) * 100 / was : 0.0);
+	} else if (base) {
+		printf(" %9s", "new");
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	spi_cost_model_t model = SPI_COST_MODEL_DEFAULT;
+	const char *save = NULL, *check = NULL, *screen = NULL;
+	double fps = 30, tolerance = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+		if (val && spi_cost_option(&model, argv[i], val)) i++;
+		else if (val && strcmp(argv[i], "--fps") == 0) fps = atof(argv[++i]);
+		else if (val && strcmp(argv[i], "--screen") == 0) screen = argv[++i];
+		else if (val && strcmp(argv[i], "--save") == 0) save = argv[++i];
+		else if (val && strcmp(argv[i], "--check") == 0) check = argv[++i];
+		else if (val && strcmp(argv[i], "--tolerance") == 0) tolerance = atof(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [--fps N] [--screen DIR] [--save FILE | --check FILE] "
+				"[--tolerance PCT] " SPI_COST_OPTIONS "\n", argv[0]);
+			return 2;
+		}
+	}
+	if (check && !load_baseline(check)) return 2;
+	FILE *out = NULL;
+	if (save && !(out = fopen(save, "w"))) {
+		perror(save);
+		return 2;
+	}
+
+	InitFontx(fx16, REPO_ROOT "/fonts/ILGH16XB.FNT", "");
+	InitFontx(fx24, REPO_ROOT "/fonts/ILGH24XB.FNT", "");
+
+	TFT_t dev;
+	sim_panel_set_model(&model);
+	sim_panel_set_report(true);
+	spi_master_init(&dev, CONFIG_MOSI_GPIO, CONFIG_SCLK_GPIO, CONFIG_CS_GPIO,
+		CONFIG_DC_GPIO, CONFIG_RESET_GPIO, CONFIG_BL_GPIO);
+	lcdInit(&dev, CONFIG_WIDTH, CONFIG_HEIGHT, CONFIG_OFFSETX, CONFIG_OFFSETY);
+	spi_master_write_command(&dev, 0x36);
+	spi_master_write_data_byte(&dev, 0x60);
+
+	spi_cost_t cost;
+	sim_panel_cost_take(&cost);
+	double budget = 1000 / fps;
+	printf("SPI at %.1f MHz, %.1f us per queued / %.1f us per polled transaction, "
+		"%.1f us per DC change; frame budget %.1f ms (%g fps)\n",
+		(model.clock_hz ? model.clock_hz : cost.clock_hz) / 1e6,
+		model.queued_ns / 1e3, model.polling_ns / 1e3, model.dc_ns / 1e3, budget, fps);
+	if (out) fprintf(out, "# workload api queued polled dc_changes bytes\n");
+
+	int failed = 0;
+	for (size_t w = 0; w < WORKLOADS; w++) {
+		const workload_t *wl = &workloads[w];
+		wl->setup(&dev);
+		sim_panel_cost_take(&cost);
+		wl->draw(&dev);
+		sim_panel_cost_take(&cost);
+
+		printf("\n%s\n  %-22s %7s %7s %9s %6s %9s%s\n", wl->name, "api", "queued", "polled",
+			"bytes", "dc", "ms", base ? "  baseline  change" : "");
+		for (int i = 0; i < cost.n; i++) {
+			print_line(&model, cost.clock_hz, wl->name, &cost.line[i]);
+			if (out) {
+				const spi_cost_line_t *l = &cost.line[i];
+				fprintf(out, "%s %s %u %u %u %llu\n", wl->name, l->api, l->queued, l->polled,
+					l->dc_changes, (unsigned long long)l->bytes);
+			}
+		}
+		spi_cost_line_t total = spi_cost_total(&cost);
+		print_line(&model, cost.clock_hz, wl->name, &total);
+
+		double now = ms(&model, cost.clock_hz, &total);
+		printf("  %.1f%% of the frame budget%s\n", now * 100 / budget, now > budget ? ", OVER" : "");
+		if (out) {
+			fprintf(out, "%s total %u %u %u %llu\n", wl->name, total.queued, total.polled,
+				total.dc_changes, (unsigned long long)total.bytes);
+		}
+		if (base) {
+			const spi_cost_line_t *b = baseline(wl->name, "total");
+			if (!b) {
+				printf("  not in the baseline\n");
+			} else if (now > ms(&model, cost.clock_hz, b) * (1 + tolerance / 100)) {
+				printf("  REGRESSION: %.3f ms, baseline %.3f ms\n", now, ms(&model, cost.clock_hz, b));
+				failed++;
+			}
+		}
+		if (screen) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s/%s.ppm", screen, wl->name);
+			sim_panel_save(path);
+		}
+	}
+
+	if (out) fclose(out);
+	if (base) printf("\n%s\n", failed ? "slower than the baseline" : "no regressions");
+	return failed ? 1 : 0;
+}
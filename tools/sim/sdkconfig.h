@@ -0,0 +1,14 @@
+#pragma once
+// The project configuration (build/sdkconfig_project.h is generated from the
+// sdkconfig at the repository root), with the component's tjpgd sources in
+// place of the ROM decoder, which is not available off target.
+#include "sdkconfig_project.h"
+
+#undef CONFIG_JD_USE_ROM
+#define CONFIG_JD_USE_ROM 0
+#define CONFIG_JD_SZBUF 512
+#define CONFIG_JD_FORMAT 0
+#define CONFIG_JD_USE_SCALE 1
+#define CONFIG_JD_TBLCLIP 1
+#define CONFIG_JD_FASTDECODE 1
+#define CONFIG_JD_DEFAULT_HUFFMAN 0
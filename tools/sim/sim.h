@@ -0,0 +1,36 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "spi_cost.h"
+
+/*
+ * Pieces of the host simulator (see sim_main.c) that are configured from
+ * the command line or talk to each other.
+ */
+
+// ---------------------------------------------------------------- sim_vfs.c
+
+// Directory that holds one subdirectory per SPIFFS partition (default "sim_flash").
+void sim_vfs_set_flash_dir(const char *dir);
+// Serve partition label from dir as it is, instead of from the flash directory.
+bool sim_vfs_set_partition_dir(const char *label, const char *dir);
+
+// ---------------------------------------------------------------- sim_panel.c
+
+// Write a PPM of the visible area to path whenever the picture settles.
+void sim_panel_set_screen(const char *path);
+// Start of the next time-to-display measurement (an upload just finished).
+void sim_panel_mark(void);
+void sim_panel_start(void);
+void sim_panel_set_model(const spi_cost_model_t *model);
+// Charge transactions to the driver API that made them, and list them per settled picture.
+void sim_panel_set_report(bool per_api);
+// Transactions since the last call (or the last settled picture); starts over.
+void sim_panel_cost_take(spi_cost_t *cost);
+// Write the visible picture to path now (PPM).
+void sim_panel_save(const char *path);
+
+// ---------------------------------------------------------------- sim_httpd.c
+
+// TCP port the file server listens on instead of 80.
+void sim_httpd_set_port(uint16_t port);
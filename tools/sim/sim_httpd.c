@@ -0,0 +1,394 @@
+/*
+ * esp_http_server on a TCP socket, enough of it for main/file_server.c.
+ *
+ * Like the IDF server, one task serves requests one at a time and handlers
+ * are matched in registration order. Unlike it, connections are not kept
+ * alive: every response carries "Connection: close". Request bodies are
+ * handed to httpd_req_recv() as they arrive, so uploads see the same chunk
+ * sizes and timeouts they would see from lwIP.
+ *
+ * Each request is logged with its status and duration; a finished upload
+ * starts a time-to-display measurement in the panel (sim_panel_mark()).
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+static const char *TAG = "sim_httpd";
+
+#define HEADER_MAX		8192
+#define MAX_RESP_HDRS	8
+
+typedef struct {
+	httpd_config_t config;
+	httpd_uri_t *handlers;
+	int nhandlers;
+	int listen_fd;
+} server_t;
+
+typedef struct {
+	int fd;
+	char head[HEADER_MAX];
+	size_t pending_off, pending_len;	// body bytes read along with the headers
+	size_t body_left;					// body bytes not yet handed out
+	bool closed;
+
+	const char *status;
+	const char *type;
+	const char *hdr[MAX_RESP_HDRS][2];
+	int nhdr;
+	bool started;						// status line and headers sent
+	bool chunked;
+	bool failed;
+} conn_t;
+
+static uint16_t port = 8080;
+
+void sim_httpd_set_port(uint16_t p)
+{
+	port = p;
+}
+
+// ---------------------------------------------------------------- sockets
+
+static bool send_all(conn_t *c, const void *buf, size_t len)
+{
+	const char *p = buf;
+	while (!c->failed && len > 0) {
+		ssize_t n = send(c->fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) {
+			c->failed = true;
+			break;
+		}
+		p += n;
+		len -= n;
+	}
+	return !c->failed;
+}
+
+static bool send_str(conn_t *c, const char *s)
+{
+	return send_all(c, s, strlen(s));
+}
+
+static bool send_headers(conn_t *c, ssize_t content_len)
+{
+	char line[256];
+	c->started = true;
+	snprintf(line, sizeof(line), "HTTP/1.1 %s\r\nContent-Type: %s\r\n", c->status, c->type);
+	send_str(c, line);
+	for (int i = 0; i < c->nhdr; i++) {
+		snprintf(line, sizeof(line), "%s: %s\r\n", c->hdr[i][0], c->hdr[i][1]);
+		send_str(c, line);
+	}
+	if (content_len >= 0) {
+		snprintf(line, sizeof(line), "Content-Length: %zd\r\n", content_len);
+		send_str(c, line);
+	} else {
+		send_str(c, "Transfer-Encoding: chunked\r\n");
+	}
+	return send_str(c, "Connection: close\r\n\r\n");
+}
+
+// ---------------------------------------------------------------- request
+
+static conn_t *conn_of(httpd_req_t *r)
+{
+	return r->aux;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+	conn_t *c = conn_of(r);
+	if (buf_len > c->body_left) buf_len = c->body_left;
+	if (buf_len == 0) return 0;
+	if (c->pending_len) {
+		size_t n = buf_len < c->pending_len ? buf_len : c->pending_len;
+		memcpy(buf, c->head + c->pending_off, n);
+		c->pending_off += n;
+		c->pending_len -= n;
+		c->body_left -= n;
+		return n;
+	}
+	if (c->closed) return HTTPD_SOCK_ERR_FAIL;
+	ssize_t n;
+	do {
+		n = recv(c->fd, buf, buf_len, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return HTTPD_SOCK_ERR_TIMEOUT;
+	if (n <= 0) {
+		c->closed = true;
+		return HTTPD_SOCK_ERR_FAIL;
+	}
+	c->body_left -= n;
+	return n;
+}
+
+// ---------------------------------------------------------------- response
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+	conn_of(r)->status = status;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+	conn_of(r)->type = type;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+	conn_t *c = conn_of(r);
+	if (strcasecmp(field, "Connection") == 0) return ESP_OK; // always close
+	if (c->nhdr == MAX_RESP_HDRS) return ESP_ERR_HTTPD_RESP_SEND;
+	c->hdr[c->nhdr][0] = field;
+	c->hdr[c->nhdr][1] = value;
+	c->nhdr++;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+	conn_t *c = conn_of(r);
+	if (c->started) return ESP_ERR_HTTPD_RESP_SEND;
+	if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+	send_headers(c, buf_len);
+	if (buf_len) send_all(c, buf, buf_len);
+	return c->failed ? ESP_ERR_HTTPD_RESP_SEND : ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+	conn_t *c = conn_of(r);
+	char size[16];
+	if (buf_len == HTTPD_RESP_USE_STRLEN) buf_len = buf ? strlen(buf) : 0;
+	if (!c->started) {
+		send_headers(c, -1);
+		c->chunked = true;
+	}
+	if (!c->chunked) return ESP_ERR_HTTPD_RESP_SEND;
+	snprintf(size, sizeof(size), "%zx\r\n", buf_len);
+	send_str(c, size);
+	if (buf_len) send_all(c, buf, buf_len);
+	send_str(c, "\r\n");
+	if (!buf_len) c->chunked = false; // last chunk sent
+	return c->failed ? ESP_ERR_HTTPD_RESP_SEND : ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+	conn_t *c = conn_of(req);
+	switch (error) {
+	case HTTPD_400_BAD_REQUEST: c->status = "400 Bad Request"; break;
+	case HTTPD_404_NOT_FOUND: c->status = "404 Not Found"; break;
+	case HTTPD_408_REQ_TIMEOUT: c->status = "408 Request Timeout"; break;
+	default: c->status = "500 Internal Server Error"; break;
+	}
+	c->type = "text/html";
+	return httpd_resp_send(req, msg, HTTPD_RESP_USE_STRLEN);
+}
+
+// ---------------------------------------------------------------- matching
+
+bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t len)
+{
+	// a trailing '*' takes any rest, a trailing '?' makes the character before it optional
+	size_t n = strlen(tpl);
+	char last = n > 0 ? tpl[n - 1] : 0, prev = n > 1 ? tpl[n - 2] : 0;
+	bool asterisk = last == '*' || (prev == '*' && last == '?');
+	bool quest = last == '?' || (prev == '?' && last == '*');
+	if (n < (size_t)(asterisk + quest * 2)) return false;
+	n -= asterisk + quest * 2;
+	if (len < n) return false;
+	if (!quest) return (asterisk || len == n) && strncmp(tpl, uri, n) == 0;
+	if (len > n && tpl[n] != uri[n]) return false;
+	return strncmp(tpl, uri, n) == 0 && (asterisk || len <= n + 1);
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+	server_t *s = handle;
+	if (s->nhandlers == s->config.max_uri_handlers) return ESP_ERR_HTTPD_HANDLERS_FULL;
+	s->handlers[s->nhandlers++] = *uri_handler;
+	return ESP_OK;
+}
+
+static const httpd_uri_t *find_handler(server_t *s, int method, const char *uri, bool *other_method)
+{
+	size_t len = strcspn(uri, "?");
+	*other_method = false;
+	for (int i = 0; i < s->nhandlers; i++) {
+		const httpd_uri_t *h = &s->handlers[i];
+		bool match = s->config.uri_match_fn ? s->config.uri_match_fn(h->uri, uri, len)
+			: strlen(h->uri) == len && strncmp(h->uri, uri, len) == 0;
+		if (!match) continue;
+		if ((int)h->method == method) return h;
+		*other_method = true;
+	}
+	return NULL;
+}
+
+// ---------------------------------------------------------------- server
+
+static const char *method_name(int method)
+{
+	static const char *names[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+	return method >= 0 && method < 5 ? names[method] : "?";
+}
+
+// reads up to the blank line; false if the request is malformed or the peer left
+static bool read_head(conn_t *c, httpd_req_t *req)
+{
+	size_t have = 0;
+	char *end = NULL;
+	while (!end) {
+		if (have == sizeof(c->head) - 1) return false;
+		ssize_t n = recv(c->fd, c->head + have, sizeof(c->head) - 1 - have, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		have += n;
+		c->head[have] = '\0';
+		end = strstr(c->head, "\r\n\r\n");
+	}
+	*end = '\0';
+	c->pending_off = end + 4 - c->head;
+	c->pending_len = have - c->pending_off;
+
+	char method[8], uri[HTTPD_MAX_URI_LEN + 1];
+	if (sscanf(c->head, "%7s %512s HTTP/1.%*d", method, uri) != 2) return false;
+	req->method = -1;
+	for (int m = 0; m < 5; m++) {
+		if (strcmp(method, method_name(m)) == 0) req->method = m;
+	}
+	strcpy((char *)req->uri, uri);
+
+	for (char *line = strstr(c->head, "\r\n"); line; line = strstr(line, "\r\n")) {
+		line += 2;
+		if (strncasecmp(line, "Content-Length:", 15) == 0) req->content_len = strtoul(line + 15, NULL, 10);
+		if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) return false; // chunked bodies are not supported
+	}
+	c->body_left = req->content_len;
+	if (c->pending_len > c->body_left) c->pending_len = c->body_left;
+	return true;
+}
+
+static void serve(server_t *s, int fd)
+{
+	static conn_t c;
+	static httpd_req_t req;
+	struct timeval tv = { .tv_sec = s->config.recv_wait_timeout };
+	int64_t start = esp_timer_get_time();
+
+	memset(&c, 0, sizeof(c));
+	memset(&req, 0, sizeof(req));
+	c.fd = fd;
+	c.status = "200 OK";
+	c.type = "text/html";
+	req.handle = s;
+	req.aux = &c;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	if (!read_head(&c, &req)) {
+		c.status = "400 Bad Request";
+		httpd_resp_send(&req, "Bad Request", HTTPD_RESP_USE_STRLEN);
+		return;
+	}
+
+	bool other_method;
+	const httpd_uri_t *h = find_handler(s, req.method, req.uri, &other_method);
+	esp_err_t ret = ESP_FAIL;
+	if (h) {
+		req.user_ctx = h->user_ctx;
+		ret = h->handler(&req);
+	} else if (other_method) {
+		c.status = "405 Method Not Allowed";
+		httpd_resp_send(&req, "Request method for this URI is not handled by server", HTTPD_RESP_USE_STRLEN);
+	} else {
+		httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, "This URI does not exist");
+	}
+
+	// unread body bytes would turn the close into a reset the client may
+	// see before the response
+	char discard[1024];
+	while (c.body_left && httpd_req_recv(&req, discard, sizeof(discard)) > 0) {}
+
+	ESP_LOGI(TAG, "%s %s %.3s %zu B in %lld ms", method_name(req.method), req.uri,
+		c.started ? c.status : "---", req.content_len, (long long)(esp_timer_get_time() - start) / 1000);
+	if (h && ret == ESP_OK && req.method == HTTP_POST && strncmp(req.uri, "/upload/", 8) == 0) sim_panel_mark();
+}
+
+static void *server_task(void *arg)
+{
+	server_t *s = arg;
+	while (1) {
+		int fd = accept(s->listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+			ESP_LOGE(TAG, "accept: %s", strerror(errno));
+			break;
+		}
+		serve(s, fd);
+		shutdown(fd, SHUT_WR);
+		close(fd);
+	}
+	return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+	server_t *s = calloc(1, sizeof(server_t));
+	if (!s) return ESP_ERR_NO_MEM;
+	s->config = *config;
+	s->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+	s->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (!s->handlers || s->listen_fd < 0) goto fail;
+
+	// loopback only: the simulator is not meant to be reachable from the network
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	int on = 1;
+	setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s->listen_fd, 8) != 0) {
+		ESP_LOGE(TAG, "port %u: %s", port, strerror(errno));
+		goto fail;
+	}
+
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, server_task, s) != 0) goto fail;
+	pthread_detach(thread);
+	ESP_LOGI(TAG, "http://127.0.0.1:%u/ (device port %u)", port, config->server_port);
+	*handle = s;
+	return ESP_OK;
+
+fail:
+	if (s->listen_fd >= 0) close(s->listen_fd);
+	free(s->handlers);
+	free(s);
+	return ESP_ERR_HTTPD_TASK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+	server_t *s = handle;
+	shutdown(s->listen_fd, SHUT_RDWR);
+	return ESP_OK;
+}
@@ -0,0 +1,15 @@
+#pragma once
+// Included ahead of every source: newlib functions the application uses
+// that older glibc does not have (defined in sim_main.c). newlib declares
+// its extensions by default; glibc wants _GNU_SOURCE (sim_panel.c: dladdr).
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stddef.h>
+#include <features.h>
+
+#if !__GLIBC_PREREQ(2, 38)
+#define SIM_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Host simulator of the DoingTV application: main/main.c, main/file_server.c
+ * and main/mount.c with the components they use, built for Linux against
+ * the stub ESP-IDF headers in tools/host/.
+ *
+ *     make -C tools/sim
+ *     tools/sim/doingtv_sim [options]
+ *
+ * What stands in for the board:
+ *   - SPIFFS partitions are directories (sim_vfs.c). By default they live
+ *     in ./sim_flash/<label>, created on first start from fonts/ and images/
+ *     the way the partition images are built; delete the directory to
+ *     "reflash". -p label=DIR uses DIR directly instead.
+ *   - The ST7789 is a model behind the SPI driver (sim_panel.c). With
+ *     --screen FILE it writes the visible picture to FILE (PPM) whenever
+ *     it settles, and logs how long the picture took, how much went over
+ *     SPI with the bus time spi_cost.h estimates for it, and how long
+ *     after the last upload it appeared.
+ *   - The file server listens on 127.0.0.1:--port (default 8080) instead
+ *     of port 80 on Wi-Fi (sim_httpd.c).
+ *   - Wi-Fi is always connected, the battery never charging, and the power
+ *     button never pressed.
+ *
+ * Options:
+ *   -p label=DIR   serve SPIFFS partition label from DIR
+ *   --flash DIR    where partitions without -p live (default sim_flash)
+ *   --port N       HTTP port (default 8080)
+ *   --screen FILE  write the settled picture to FILE
+ *   --spi-report   break the bus time of each picture down by st7789 API
+ *   --spi-clock HZ, --spi-queued-us US, --spi-polling-us US, --spi-dc-us US
+ *                  cost model parameters (see spi_cost.h)
+ *   -t SECONDS     exit after SECONDS (default: run until killed)
+ *
+ * A load test, for instance:
+ *
+ *     tools/sim/doingtv_sim --screen /tmp/screen.ppm &
+ *     curl --data-binary @images/DoingObject.jpg http://127.0.0.1:8080/upload/a.jpg
+ *
+ * Tasks run as plain threads on the host scheduler and decoding runs at
+ * host speed, so times are for comparing changes, not device predictions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "nvs_flash.h"
+#include "protocol_examples_common.h"
+#include "power_button.h"
+#include "wifi_provision.h"
+#include "charging_indicator.h"
+#include "sim.h"
+
+static const char *TAG = "sim";
+
+void app_main(void);
+
+// ---------------------------------------------------------------- board
+
+esp_event_base_t const IP_EVENT = "IP_EVENT";
+
+esp_err_t esp_event_loop_create_default(void)
+{
+	return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id,
+	esp_event_handler_t handler, void *arg, esp_event_handler_instance_t *instance)
+{
+	return ESP_OK;
+}
+
+esp_err_t esp_netif_init(void)
+{
+	return ESP_OK;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+	return ESP_OK;
+}
+
+esp_err_t example_connect(void)
+{
+	ESP_LOGI(TAG, "Wi-Fi: using the host network");
+	return ESP_OK;
+}
+
+esp_err_t wifi_provision_init(bool force_prov)
+{
+	return ESP_ERR_NOT_SUPPORTED; // unreachable, example_connect() never fails
+}
+
+void power_button_init(power_button_cb_t on_press_cb)
+{
+}
+
+void charging_indicator_init(void)
+{
+}
+
+void charging_indicator_update(void)
+{
+}
+
+#if SIM_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t len = strlen(src);
+	if (size) {
+		size_t n = len < size - 1 ? len : size - 1;
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return len;
+}
+
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+	size_t used = strnlen(dst, size);
+	if (used == size) return size + strlen(src);
+	return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+// ---------------------------------------------------------------- main
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-p label=DIR]... [--flash DIR] [--port N] [--screen FILE] [-t SECONDS]\n"
+		"       [--spi-report] " SPI_COST_OPTIONS "\n", prog);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = 0;
+	spi_cost_model_t model = SPI_COST_MODEL_DEFAULT;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+		if (strcmp(arg, "--spi-report") == 0) {
+			sim_panel_set_report(true);
+			continue;
+		}
+		if (!val) usage(argv[0]);
+		i++;
+		if (strcmp(arg, "-p") == 0) {
+			char label[32];
+			const char *eq = strchr(val, '=');
+			if (!eq || eq - val >= (int)sizeof(label)) usage(argv[0]);
+			memcpy(label, val, eq - val);
+			label[eq - val] = '\0';
+			if (!sim_vfs_set_partition_dir(label, eq + 1)) {
+				fprintf(stderr, "unknown partition %s\n", label);
+				return 2;
+			}
+		} else if (strcmp(arg, "--flash") == 0) {
+			sim_vfs_set_flash_dir(val);
+		} else if (strcmp(arg, "--port") == 0) {
+			sim_httpd_set_port(atoi(val));
+		} else if (strcmp(arg, "--screen") == 0) {
+			sim_panel_set_screen(val);
+		} else if (strcmp(arg, "-t") == 0) {
+			seconds = atoi(val);
+		} else if (!spi_cost_option(&model, arg, val)) {
+			usage(argv[0]);
+		}
+	}
+
+	sim_panel_set_model(&model);
+	sim_panel_start();
+	app_main();
+
+	// app_main() returns once its tasks are running, as on the device
+	if (seconds > 0) {
+		sleep(seconds);
+		return 0;
+	}
+	while (1) pause();
+}
@@ -0,0 +1,446 @@
+/*
+ * Virtual ST7789 behind the driver/gpio.h and driver/spi_master.h stubs.
+ *
+ * The st7789 component runs unchanged: DC low means the bytes of a
+ * transaction are commands, DC high means parameters or pixels. The model
+ * keeps the controller state that decides where pixels land (column/row
+ * window, MADCTL, write cursor) and a frame memory of RGB565 pixels.
+ *
+ * Frame memory is the visible area plus the configured offsets on both
+ * sides, the layout main.c assumes when it changes MADCTL, and MADCTL works
+ * as main.c describes it: rows and columns are exchanged first (MV), then
+ * columns (MX) and rows (MY) are mirrored. The visible area is read back
+ * through the LCD_MADCTL (0x60) mapping, so a picture drawn the normal way
+ * comes out upright.
+ *
+ * Once writes stop for SETTLE_MS the picture counts as displayed: it is
+ * logged with what it cost on the bus (the spi_cost.h estimate), timed
+ * against the last upload, and written to the --screen file.
+ *
+ * With attribution on, each transaction is charged to the st7789 API the
+ * application called, found by walking the call stack up to the outermost
+ * lcd*() or spi_master_*() frame (the binary is linked with -rdynamic and
+ * built without sibling-call optimization so those frames are there).
+ */
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <driver/gpio.h>
+#include <driver/spi_master.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "sim.h"
+#include "spi_cost.h"
+
+static const char *TAG = "sim_panel";
+
+#define SETTLE_MS	100
+#define LCD_MADCTL	0x60	// main.c's mapping for an upright picture
+#define MADCTL_MY	0x80
+#define MADCTL_MX	0x40
+#define MADCTL_MV	0x20
+
+// visible area under LCD_MADCTL and the frame memory around it
+#define VIS_W	CONFIG_HEIGHT
+#define VIS_H	CONFIG_WIDTH
+#define MEM_COLS	(CONFIG_WIDTH + 2 * CONFIG_OFFSETY)
+#define MEM_ROWS	(CONFIG_HEIGHT + 2 * CONFIG_OFFSETX)
+
+struct spi_device_t {
+	int clock_speed_hz;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	uint8_t gpio[GPIO_NUM_MAX];
+	struct spi_device_t device;
+	bool bus_ready;
+
+	// controller
+	uint16_t mem[MEM_ROWS][MEM_COLS];
+	uint8_t madctl;
+	uint16_t xs, xe, ys, ye;	// window, in MADCTL coordinates
+	uint16_t cx, cy;			// write cursor
+	uint8_t cmd;
+	uint8_t param[4];
+	int nparam;
+	int pixel_hi;				// first byte of a pixel split across transactions, -1 if none
+	bool display_on;
+	bool sleeping;
+
+	// what happened since the picture last settled
+	bool dirty;
+	int64_t first_us, last_us;
+	uint32_t pixels;
+	spi_cost_t cost;
+	int64_t mark_us;			// end of the last upload, 0 if none pending
+
+	const char *screen;
+	spi_cost_model_t model;
+	bool attribute;
+	bool report;
+} panel = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.pixel_hi = -1,
+	.sleeping = true,
+	.cost.dc = -1,
+	.model = SPI_COST_MODEL_DEFAULT,
+};
+
+void sim_panel_set_screen(const char *path)
+{
+	panel.screen = path;
+}
+
+void sim_panel_set_model(const spi_cost_model_t *model)
+{
+	panel.model = *model;
+}
+
+void sim_panel_set_report(bool per_api)
+{
+	panel.report = per_api;
+	panel.attribute = per_api;
+}
+
+void sim_panel_cost_take(spi_cost_t *cost)
+{
+	pthread_mutex_lock(&panel.lock);
+	*cost = panel.cost;
+	spi_cost_reset(&panel.cost);
+	panel.pixels = 0;
+	pthread_mutex_unlock(&panel.lock);
+}
+
+void sim_panel_mark(void)
+{
+	pthread_mutex_lock(&panel.lock);
+	panel.mark_us = esp_timer_get_time();
+	pthread_mutex_unlock(&panel.lock);
+}
+
+// ---------------------------------------------------------------- gpio
+
+esp_err_t gpio_reset_pin(gpio_num_t gpio)
+{
+	if (gpio < 0 || gpio >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	return gpio_set_level(gpio, 0);
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode)
+{
+	return gpio < 0 || gpio >= GPIO_NUM_MAX ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+void gpio_pad_select_gpio(uint32_t gpio)
+{
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+	if (gpio < 0 || gpio >= GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	pthread_mutex_lock(&panel.lock);
+	if (gpio == CONFIG_BL_GPIO && panel.gpio[gpio] != !!level) {
+		panel.dirty = true;
+		panel.last_us = esp_timer_get_time();
+		if (!panel.first_us) panel.first_us = panel.last_us;
+	}
+	panel.gpio[gpio] = !!level;
+	pthread_mutex_unlock(&panel.lock);
+	return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+	return gpio >= 0 && gpio < GPIO_NUM_MAX ? panel.gpio[gpio] : 0;
+}
+
+// ---------------------------------------------------------------- ST7789
+
+// frame memory cell for (x, y) under madctl, NULL outside it
+static uint16_t *cell(uint8_t madctl, int x, int y)
+{
+	int col = madctl & MADCTL_MV ? y : x;
+	int row = madctl & MADCTL_MV ? x : y;
+	if (col < 0 || col >= MEM_COLS || row < 0 || row >= MEM_ROWS) return NULL;
+	if (madctl & MADCTL_MX) col = MEM_COLS - 1 - col;
+	if (madctl & MADCTL_MY) row = MEM_ROWS - 1 - row;
+	return &panel.mem[row][col];
+}
+
+static void pixel(uint16_t color)
+{
+	uint16_t *p = cell(panel.madctl, panel.cx, panel.cy);
+	if (p) *p = color;
+	panel.pixels++;
+	if (++panel.cx > panel.xe) {
+		panel.cx = panel.xs;
+		if (++panel.cy > panel.ye) panel.cy = panel.ys;
+	}
+}
+
+static void command(uint8_t cmd)
+{
+	panel.cmd = cmd;
+	panel.nparam = 0;
+	panel.pixel_hi = -1;
+	switch (cmd) {
+	case 0x01: // SWRESET
+		panel.madctl = 0;
+		panel.display_on = false;
+		panel.sleeping = true;
+		panel.xs = panel.ys = 0;
+		panel.xe = MEM_COLS - 1;
+		panel.ye = MEM_ROWS - 1;
+		break;
+	case 0x10: panel.sleeping = true; break;
+	case 0x11: panel.sleeping = false; break;
+	case 0x28: panel.display_on = false; break;
+	case 0x29: panel.display_on = true; break;
+	case 0x2C: // RAMWR
+		panel.cx = panel.xs;
+		panel.cy = panel.ys;
+		break;
+	case 0x3C: // RAMWRC: carry on from the cursor
+		break;
+	default:
+		// inversion (0x20/0x21), pixel format, gamma and the rest do not
+		// change where pixels go; colours are kept as sent
+		break;
+	}
+}
+
+static void data(uint8_t b)
+{
+	if (panel.cmd == 0x2C || panel.cmd == 0x3C) {
+		if (panel.pixel_hi < 0) {
+			panel.pixel_hi = b;
+		} else {
+			pixel(panel.pixel_hi << 8 | b);
+			panel.pixel_hi = -1;
+		}
+		return;
+	}
+	if (panel.nparam < (int)sizeof(panel.param)) panel.param[panel.nparam] = b;
+	panel.nparam++;
+	const uint8_t *p = panel.param;
+	switch (panel.cmd) {
+	case 0x2A: // CASET
+		if (panel.nparam == 4) {
+			panel.xs = p[0] << 8 | p[1];
+			panel.xe = p[2] << 8 | p[3];
+		}
+		break;
+	case 0x2B: // RASET
+		if (panel.nparam == 4) {
+			panel.ys = p[0] << 8 | p[1];
+			panel.ye = p[2] << 8 | p[3];
+		}
+		break;
+	case 0x36: // MADCTL
+		if (panel.nparam == 1) panel.madctl = p[0];
+		break;
+	}
+}
+
+// ---------------------------------------------------------------- spi
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, int dma_chan)
+{
+	if (panel.bus_ready) return ESP_ERR_INVALID_STATE;
+	panel.bus_ready = true;
+	return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config,
+	spi_device_handle_t *handle)
+{
+	if (!panel.bus_ready) return ESP_ERR_INVALID_STATE;
+	panel.device.clock_speed_hz = config->clock_speed_hz;
+	*handle = &panel.device;
+	return ESP_OK;
+}
+
+static bool is_driver_api(const char *name)
+{
+	return strncmp(name, "lcd", 3) == 0 || strncmp(name, "spi_master_", 11) == 0 || strcmp(name, "delayMS") == 0;
+}
+
+// function name at a return address, cached: the same few call sites repeat
+static const char *symbol(void *addr)
+{
+	static struct { void *addr; const char *name; } cache[1024];
+	size_t h = ((uintptr_t)addr >> 2) % 1024;
+	for (size_t i = 0; i < 1024; i++, h = (h + 1) % 1024) {
+		if (cache[h].addr == addr) return cache[h].name;
+		if (!cache[h].addr) {
+			Dl_info info;
+			cache[h].addr = addr;
+			cache[h].name = dladdr(addr, &info) && info.dli_sname ? info.dli_sname : NULL;
+			return cache[h].name;
+		}
+	}
+	Dl_info info;
+	return dladdr(addr, &info) ? info.dli_sname : NULL;
+}
+
+// the outermost driver function on the stack: what the application called
+static const char *caller_api(void)
+{
+	void *frames[32];
+	int n = backtrace(frames, 32);
+	const char *api = NULL;
+	for (int i = 1; i < n; i++) {
+		const char *name = symbol(frames[i]);
+		bool driver = name && is_driver_api(name);
+		if (driver) api = name;
+		else if (api) break;
+	}
+	return api;
+}
+
+static esp_err_t transmit(spi_device_handle_t handle, spi_transaction_t *trans, bool polling)
+{
+	if (!handle || !trans || trans->length % 8) return ESP_ERR_INVALID_ARG;
+	const uint8_t *buf = trans->flags & SPI_TRANS_USE_TXDATA ? trans->tx_data : trans->tx_buffer;
+	size_t len = trans->length / 8;
+	if (len && !buf) return ESP_ERR_INVALID_ARG;
+
+	const char *api = panel.attribute ? caller_api() : "all";
+
+	pthread_mutex_lock(&panel.lock);
+	bool dc = panel.gpio[CONFIG_DC_GPIO];
+	uint32_t before = panel.pixels;
+	bool shown = panel.display_on && !panel.sleeping;
+	for (size_t i = 0; i < len; i++) {
+		if (dc) data(buf[i]);
+		else command(buf[i]);
+	}
+	panel.cost.clock_hz = handle->clock_speed_hz;
+	spi_cost_add(&panel.cost, api, len, dc, polling);
+	// only what changes the picture starts or extends a measurement
+	if (panel.pixels != before || shown != (panel.display_on && !panel.sleeping)) {
+		panel.dirty = true;
+		panel.last_us = esp_timer_get_time();
+		if (!panel.first_us) panel.first_us = panel.last_us;
+	}
+	pthread_mutex_unlock(&panel.lock);
+	return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+	return transmit(handle, trans, false);
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans)
+{
+	return transmit(handle, trans, true);
+}
+
+// ---------------------------------------------------------------- settle
+
+// the visible area as the viewer sees it, RGB888; dark without backlight
+static void snapshot(uint8_t *rgb)
+{
+	bool lit = panel.gpio[CONFIG_BL_GPIO] && panel.display_on && !panel.sleeping;
+	for (int y = 0; y < VIS_H; y++) {
+		for (int x = 0; x < VIS_W; x++, rgb += 3) {
+			uint16_t *p = cell(LCD_MADCTL, x + CONFIG_OFFSETX, y + CONFIG_OFFSETY);
+			uint16_t v = lit && p ? *p : 0;
+			uint8_t r = v >> 11 & 0x1F, g = v >> 5 & 0x3F, b = v & 0x1F;
+			rgb[0] = r << 3 | r >> 2;
+			rgb[1] = g << 2 | g >> 4;
+			rgb[2] = b << 3 | b >> 2;
+		}
+	}
+}
+
+static void write_screen(const char *path, const uint8_t *rgb)
+{
+	char tmp[4096];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	FILE *fp = fopen(tmp, "wb");
+	if (!fp) {
+		ESP_LOGE(TAG, "Can't write %s", tmp);
+		return;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", VIS_W, VIS_H);
+	bool ok = fwrite(rgb, 3, VIS_W * VIS_H, fp) == VIS_W * VIS_H;
+	if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+		ESP_LOGE(TAG, "Can't write %s", path);
+		remove(tmp);
+	}
+}
+
+void sim_panel_save(const char *path)
+{
+	static uint8_t rgb[VIS_W * VIS_H * 3];
+	pthread_mutex_lock(&panel.lock);
+	snapshot(rgb);
+	pthread_mutex_unlock(&panel.lock);
+	write_screen(path, rgb);
+}
+
+static void *panel_task(void *arg)
+{
+	static uint8_t rgb[VIS_W * VIS_H * 3];
+	const struct timespec poll = { .tv_nsec = 10 * 1000000 };
+
+	while (1) {
+		nanosleep(&poll, NULL);
+		pthread_mutex_lock(&panel.lock);
+		int64_t now = esp_timer_get_time();
+		if (!panel.dirty || now - panel.last_us < SETTLE_MS * 1000) {
+			pthread_mutex_unlock(&panel.lock);
+			continue;
+		}
+		int64_t first = panel.first_us, last = panel.last_us;
+		// a picture started before the upload finished is not its result
+		int64_t mark = panel.mark_us && first >= panel.mark_us ? panel.mark_us : 0;
+		uint32_t pixels = panel.pixels;
+		spi_cost_t cost = panel.cost;
+		if (panel.screen) snapshot(rgb);
+		panel.dirty = false;
+		panel.first_us = panel.last_us = 0;
+		if (mark) panel.mark_us = 0;
+		panel.pixels = 0;
+		spi_cost_reset(&panel.cost);
+		pthread_mutex_unlock(&panel.lock);
+
+		if (panel.screen) write_screen(panel.screen, rgb);
+		spi_cost_line_t total = spi_cost_total(&cost);
+		int hz = panel.model.clock_hz ? panel.model.clock_hz : cost.clock_hz;
+		long long bus_ms = spi_cost_ns(&panel.model, cost.clock_hz, &total) / 1000000;
+		long long wire_ms = spi_cost_wire_ns(&panel.model, cost.clock_hz, &total) / 1000000;
+		char drawn[64];
+		if (mark) {
+			snprintf(drawn, sizeof(drawn), "drawn %lld..%lld ms after upload",
+				(long long)(first - mark) / 1000, (long long)(last - mark) / 1000);
+		} else {
+			snprintf(drawn, sizeof(drawn), "drawn in %lld ms", (long long)(last - first) / 1000);
+		}
+		ESP_LOGI(TAG, "settled: %"PRIu32" px, %"PRIu64" B in %"PRIu32" transactions, "
+			"bus ~%lld ms at %d MHz (wire %lld ms), %s",
+			pixels, total.bytes, total.queued + total.polled, bus_ms, hz / 1000000, wire_ms, drawn);
+		for (int i = 0; panel.report && i < cost.n; i++) {
+			const spi_cost_line_t *l = &cost.line[i];
+			ESP_LOGI(TAG, "  %-28s %8"PRIu32" transactions %9"PRIu64" B  ~%.1f ms", l->api,
+				l->queued + l->polled, l->bytes, spi_cost_ns(&panel.model, cost.clock_hz, l) / 1e6);
+		}
+	}
+	return NULL;
+}
+
+void sim_panel_start(void)
+{
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, panel_task, NULL) == 0) pthread_detach(thread);
+}
@@ -0,0 +1,301 @@
+/*
+ * SPIFFS on the host. Each partition is a directory; paths under the mount
+ * point given to esp_vfs_spiffs_register() are rewritten to it by wrapping
+ * the libc calls the application makes (the binary is linked with
+ * -Wl,--wrap=fopen,--wrap=opendir,...). Everything else passes through,
+ * except that directory listings leave out "." and "..".
+ *
+ * By default a partition lives in <flash dir>/<label> and is filled on
+ * first mount from the repository directory that the build turns into its
+ * image (the spiffs_create_partition_image() calls in CMakeLists.txt), so
+ * uploads and deletes never touch the sources. Like SPIFFS the namespace is
+ * flat and names are limited to CONFIG_SPIFFS_OBJ_NAME_LEN.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "esp_spiffs.h"
+#include "esp_vfs.h"
+#include "sdkconfig.h"
+#include "sim.h"
+
+static const char *TAG = "sim_vfs";
+
+typedef struct {
+	const char *label;
+	const char *image;		// repository directory the partition image is built from
+	char dir[PATH_MAX];		// host directory, set by -p or derived from the flash directory
+	bool ready;
+} partition_t;
+
+// in partitions.csv order: a mount without a label gets the first one
+static partition_t partitions[] = {
+	{ .label = "storage1", .image = REPO_ROOT "/fonts" },
+	{ .label = "storage2", .image = REPO_ROOT "/images" },
+};
+
+// Registered mounts, looked up in this order like the VFS does for equal
+// prefixes: a second mount on a taken path is shadowed by the first.
+typedef struct {
+	partition_t *partition;
+	char base[ESP_VFS_PATH_MAX + 1];
+	bool by_label;
+} mount_t;
+
+static mount_t mounts[3]; // CONFIG_SPIFFS_MAX_PARTITIONS
+static int nmounts;
+
+static const char *flash_dir = "sim_flash";
+
+#define PARTITION_COUNT (sizeof(partitions) / sizeof(partitions[0]))
+
+static partition_t *find_label(const char *label)
+{
+	for (size_t i = 0; i < PARTITION_COUNT; i++) {
+		if (strcmp(partitions[i].label, label) == 0) return &partitions[i];
+	}
+	return NULL;
+}
+
+void sim_vfs_set_flash_dir(const char *dir)
+{
+	flash_dir = dir;
+}
+
+bool sim_vfs_set_partition_dir(const char *label, const char *dir)
+{
+	partition_t *p = find_label(label);
+	if (!p || strlen(dir) >= sizeof(p->dir)) return false;
+	strcpy(p->dir, dir);
+	return true;
+}
+
+// partition size from the partition table, like the real mount reads it
+static size_t partition_size(const char *label)
+{
+	FILE *fp = fopen(REPO_ROOT "/partitions.csv", "r");
+	char line[256];
+	size_t size = 0;
+	if (!fp) return 0;
+	while (!size && fgets(line, sizeof(line), fp)) {
+		char *field[5];
+		int n = 0;
+		if (line[0] == '#') continue;
+		for (char *tok = strtok(line, ","); tok && n < 5; tok = strtok(NULL, ",")) {
+			char *end = tok + strlen(tok);
+			while (*tok == ' ' || *tok == '\t') tok++;
+			while (end > tok && strchr(" \t\r\n", end[-1])) *--end = '\0';
+			field[n++] = tok;
+		}
+		if (n == 5 && strcmp(field[0], label) == 0) size = strtoul(field[4], NULL, 0);
+	}
+	fclose(fp);
+	return size;
+}
+
+static esp_err_t copy_file(const char *src, const char *dst)
+{
+	FILE *in = fopen(src, "rb");
+	FILE *out = in ? fopen(dst, "wb") : NULL;
+	char buf[8192];
+	size_t n;
+	esp_err_t ret = ESP_OK;
+	if (!out) ret = ESP_FAIL;
+	while (ret == ESP_OK && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+		if (fwrite(buf, 1, n, out) != n) ret = ESP_FAIL;
+	}
+	if (in) fclose(in);
+	if (out && fclose(out) != 0) ret = ESP_FAIL;
+	return ret;
+}
+
+// "flashing" the partition image: the regular files of the image directory
+static esp_err_t partition_create(partition_t *p)
+{
+	if (mkdir(flash_dir, 0755) != 0 && errno != EEXIST) return ESP_FAIL;
+	if (mkdir(p->dir, 0755) != 0) return ESP_FAIL;
+	DIR *dir = opendir(p->image);
+	if (!dir) return ESP_OK; // an empty partition
+	struct dirent *e;
+	char src[PATH_MAX], dst[PATH_MAX];
+	esp_err_t ret = ESP_OK;
+	while (ret == ESP_OK && (e = readdir(dir)) != NULL) {
+		if (e->d_type != DT_REG) continue;
+		if (snprintf(src, sizeof(src), "%s/%s", p->image, e->d_name) >= sizeof(src) ||
+			snprintf(dst, sizeof(dst), "%s/%s", p->dir, e->d_name) >= sizeof(dst)) continue;
+		ret = copy_file(src, dst);
+	}
+	closedir(dir);
+	ESP_LOGI(TAG, "Flashed %s from %s", p->dir, p->image);
+	return ret;
+}
+
+static esp_err_t partition_prepare(partition_t *p)
+{
+	struct stat st;
+	if (p->ready) return ESP_OK;
+	if (!p->dir[0]) {
+		snprintf(p->dir, sizeof(p->dir), "%s/%s", flash_dir, p->label);
+		if (stat(p->dir, &st) != 0 && partition_create(p) != ESP_OK) {
+			ESP_LOGE(TAG, "Can't create %s", p->dir);
+			return ESP_FAIL;
+		}
+	}
+	if (stat(p->dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		ESP_LOGE(TAG, "%s is not a directory", p->dir);
+		return ESP_FAIL;
+	}
+	p->ready = true;
+	return ESP_OK;
+}
+
+// the mount registered with this label (NULL: the one registered without)
+static mount_t *find_mount(const char *label)
+{
+	for (int i = 0; i < nmounts; i++) {
+		mount_t *m = &mounts[i];
+		if (label ? m->by_label && strcmp(m->partition->label, label) == 0 : !m->by_label) return m;
+	}
+	return NULL;
+}
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf)
+{
+	if (!conf || !conf->base_path) return ESP_ERR_INVALID_ARG;
+	if (strlen(conf->base_path) > ESP_VFS_PATH_MAX) return ESP_ERR_INVALID_ARG;
+	partition_t *p = conf->partition_label ? find_label(conf->partition_label) : &partitions[0];
+	if (!p) return ESP_ERR_NOT_FOUND;
+	if (find_mount(conf->partition_label)) return ESP_ERR_INVALID_STATE;
+	if (nmounts == sizeof(mounts) / sizeof(mounts[0])) return ESP_ERR_NO_MEM;
+	if (partition_prepare(p) != ESP_OK) return ESP_FAIL;
+
+	mount_t *m = &mounts[nmounts++];
+	m->partition = p;
+	m->by_label = conf->partition_label != NULL;
+	strcpy(m->base, conf->base_path);
+	ESP_LOGI(TAG, "%s (%s) -> %s", m->base, p->label, p->dir);
+	return ESP_OK;
+}
+
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label)
+{
+	mount_t *m = find_mount(partition_label);
+	if (!m) return ESP_ERR_INVALID_STATE;
+	memmove(m, m + 1, (char *)&mounts[nmounts] - (char *)(m + 1));
+	nmounts--;
+	return ESP_OK;
+}
+
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes)
+{
+	mount_t *m = find_mount(partition_label);
+	if (!m) return ESP_ERR_INVALID_STATE;
+	partition_t *p = m->partition;
+	DIR *dir = opendir(p->dir);
+	if (!dir) return ESP_FAIL;
+	struct dirent *e;
+	char path[PATH_MAX];
+	size_t used = 0;
+	while ((e = readdir(dir)) != NULL) {
+		struct stat st;
+		if (snprintf(path, sizeof(path), "%s/%s", p->dir, e->d_name) >= sizeof(path)) continue;
+		if (e->d_type == DT_REG && stat(path, &st) == 0) used += st.st_size;
+	}
+	closedir(dir);
+	*total_bytes = partition_size(p->label);
+	*used_bytes = used;
+	return ESP_OK;
+}
+
+// ---------------------------------------------------------------- path rewriting
+
+// host path for a path under a mount point, path itself otherwise; NULL (errno
+// set) for what SPIFFS would refuse
+static const char *host_path(const char *path, char *buf, size_t size)
+{
+	for (int i = 0; i < nmounts; i++) {
+		const mount_t *m = &mounts[i];
+		size_t n = strlen(m->base);
+		if (strncmp(path, m->base, n) != 0) continue;
+		const char *name = path + n;
+		if (*name != '/' && *name != '\0') continue;
+		if (strlen(name) + 1 > CONFIG_SPIFFS_OBJ_NAME_LEN) {
+			errno = ENAMETOOLONG;
+			return NULL;
+		}
+		if (snprintf(buf, size, "%s%s", m->partition->dir, name) >= (int)size) {
+			errno = ENAMETOOLONG;
+			return NULL;
+		}
+		return buf;
+	}
+	return path;
+}
+
+FILE *__real_fopen(const char *path, const char *mode);
+DIR *__real_opendir(const char *path);
+struct dirent *__real_readdir(DIR *dir);
+int __real_stat(const char *path, struct stat *st);
+int __real_unlink(const char *path);
+int __real_rename(const char *from, const char *to);
+int __real_remove(const char *path);
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+	char buf[PATH_MAX];
+	path = host_path(path, buf, sizeof(buf));
+	return path ? __real_fopen(path, mode) : NULL;
+}
+
+DIR *__wrap_opendir(const char *path)
+{
+	char buf[PATH_MAX];
+	path = host_path(path, buf, sizeof(buf));
+	return path ? __real_opendir(path) : NULL;
+}
+
+// SPIFFS has no directories, so no "." and ".." either
+struct dirent *__wrap_readdir(DIR *dir)
+{
+	struct dirent *e;
+	do {
+		e = __real_readdir(dir);
+	} while (e && (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0));
+	return e;
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+	char buf[PATH_MAX];
+	path = host_path(path, buf, sizeof(buf));
+	return path ? __real_stat(path, st) : -1;
+}
+
+int __wrap_unlink(const char *path)
+{
+	char buf[PATH_MAX];
+	path = host_path(path, buf, sizeof(buf));
+	return path ? __real_unlink(path) : -1;
+}
+
+int __wrap_remove(const char *path)
+{
+	char buf[PATH_MAX];
+	path = host_path(path, buf, sizeof(buf));
+	return path ? __real_remove(path) : -1;
+}
+
+int __wrap_rename(const char *from, const char *to)
+{
+	char buf_from[PATH_MAX], buf_to[PATH_MAX];
+	from = host_path(from, buf_from, sizeof(buf_from));
+	to = from ? host_path(to, buf_to, sizeof(buf_to)) : NULL;
+	return to ? __real_rename(from, to) : -1;
+}
@@ -0,0 +1,69 @@
+#include <stdlib.h>
+#include <string.h>
+#include "spi_cost.h"
+
+bool spi_cost_option(spi_cost_model_t *m, const char *arg, const char *val)
+{
+	if (strcmp(arg, "--spi-clock") == 0) m->clock_hz = atoi(val);
+	else if (strcmp(arg, "--spi-queued-us") == 0) m->queued_ns = atof(val) * 1000;
+	else if (strcmp(arg, "--spi-polling-us") == 0) m->polling_ns = atof(val) * 1000;
+	else if (strcmp(arg, "--spi-dc-us") == 0) m->dc_ns = atof(val) * 1000;
+	else return false;
+	return true;
+}
+
+void spi_cost_reset(spi_cost_t *c)
+{
+	int clock_hz = c->clock_hz;
+	memset(c, 0, sizeof(*c));
+	c->clock_hz = clock_hz;
+	c->dc = -1;
+}
+
+static spi_cost_line_t *line_for(spi_cost_t *c, const char *api)
+{
+	if (!api) api = "?";
+	for (int i = 0; i < c->n; i++) {
+		if (strcmp(c->line[i].api, api) == 0) return &c->line[i];
+	}
+	if (c->n == SPI_COST_APIS) {
+		c->line[SPI_COST_APIS - 1].api = "(other)";
+		return &c->line[SPI_COST_APIS - 1];
+	}
+	c->line[c->n].api = api;
+	return &c->line[c->n++];
+}
+
+void spi_cost_add(spi_cost_t *c, const char *api, uint32_t bytes, bool dc, bool polling)
+{
+	spi_cost_line_t *l = line_for(c, api);
+	if (polling) l->polled++;
+	else l->queued++;
+	if (c->dc >= 0 && c->dc != dc) l->dc_changes++;
+	l->bytes += bytes;
+	c->dc = dc;
+}
+
+spi_cost_line_t spi_cost_total(const spi_cost_t *c)
+{
+	spi_cost_line_t t = { .api = "total" };
+	for (int i = 0; i < c->n; i++) {
+		t.queued += c->line[i].queued;
+		t.polled += c->line[i].polled;
+		t.dc_changes += c->line[i].dc_changes;
+		t.bytes += c->line[i].bytes;
+	}
+	return t;
+}
+
+uint64_t spi_cost_wire_ns(const spi_cost_model_t *m, int clock_hz, const spi_cost_line_t *l)
+{
+	int hz = m->clock_hz ? m->clock_hz : clock_hz;
+	return hz > 0 ? l->bytes * 8 * 1000000000ULL / hz : 0;
+}
+
+uint64_t spi_cost_ns(const spi_cost_model_t *m, int clock_hz, const spi_cost_line_t *l)
+{
+	return spi_cost_wire_ns(m, clock_hz, l) + (uint64_t)l->queued * m->queued_ns +
+		(uint64_t)l->polled * m->polling_ns + (uint64_t)l->dc_changes * m->dc_ns;
+}
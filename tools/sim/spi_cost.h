@@ -0,0 +1,60 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Bus time of ST7789 drawing, estimated from the transactions the virtual
+ * panel (sim_panel.c) sees. A transaction costs its bytes at the SPI clock
+ * plus a fixed setup time, which depends on whether the driver queued it
+ * (spi_device_transmit) or polled it (spi_device_polling_transmit). Every
+ * change of the DC line between transactions adds dc_ns, since the next
+ * transaction has to wait for the previous one to drain.
+ *
+ * The defaults follow the transaction intervals in the ESP-IDF SPI master
+ * documentation; measure on the board and pass better values when the
+ * margin matters.
+ */
+
+typedef struct {
+	int clock_hz;			// 0: the clock_speed_hz the driver configured
+	uint32_t queued_ns;		// setup per spi_device_transmit()
+	uint32_t polling_ns;	// setup per spi_device_polling_transmit()
+	uint32_t dc_ns;			// per DC level change
+} spi_cost_model_t;
+
+#define SPI_COST_MODEL_DEFAULT { \
+	.clock_hz = 0, \
+	.queued_ns = 25000, \
+	.polling_ns = 8000, \
+	.dc_ns = 1000, \
+}
+
+// transactions of one driver API (or all of them)
+typedef struct {
+	const char *api;
+	uint32_t queued;
+	uint32_t polled;
+	uint32_t dc_changes;
+	uint64_t bytes;
+} spi_cost_line_t;
+
+#define SPI_COST_APIS 32
+
+typedef struct {
+	spi_cost_line_t line[SPI_COST_APIS];	// first use order; the last one takes any overflow
+	int n;
+	int clock_hz;							// from the driver, for clock_hz 0
+	int dc;									// level of the last transaction, -1 before the first
+} spi_cost_t;
+
+// --spi-clock HZ, --spi-queued-us US, --spi-polling-us US, --spi-dc-us US;
+// false if arg is none of them
+bool spi_cost_option(spi_cost_model_t *m, const char *arg, const char *val);
+#define SPI_COST_OPTIONS "[--spi-clock HZ] [--spi-queued-us US] [--spi-polling-us US] [--spi-dc-us US]"
+
+void spi_cost_reset(spi_cost_t *c);
+void spi_cost_add(spi_cost_t *c, const char *api, uint32_t bytes, bool dc, bool polling);
+spi_cost_line_t spi_cost_total(const spi_cost_t *c);
+uint64_t spi_cost_ns(const spi_cost_model_t *m, int clock_hz, const spi_cost_line_t *l);
+// the wire time alone
+uint64_t spi_cost_wire_ns(const spi_cost_model_t *m, int clock_hz, const spi_cost_line_t *l);